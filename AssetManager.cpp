@@ -1,46 +1,229 @@
 #include "AssetManager.h"
+#include "ContentHash.h"
 #include <fstream>
 #include <iostream>
 
-void AssetManager::setActiveDirectories(const std::vector<std::filesystem::path>& dataDirs, const std::filesystem::path& cacheDir) {
-    activeDataDirectories = dataDirs;
+bool AssetManager::setActiveDirectories(const std::vector<std::filesystem::path>& dataDirs, const std::filesystem::path& cacheDir) {
+    std::lock_guard<std::mutex> lock(configureMutex);
+    // The renderer re-applies its directory list on every model load; keep the current
+    // snapshot (and its location memo) when nothing actually changed.
+    auto current = std::atomic_load(&snapshot);
+    if (current && current->dataDirectories == dataDirs && bsaCacheDirectory == cacheDir) {
+        return false;
+    }
     bsaCacheDirectory = cacheDir;
 
-    for (const auto& dir : activeDataDirectories) {
+    auto next = std::make_shared<DirectorySnapshot>();
+    next->dataDirectories = dataDirs;
+    for (const auto& dir : dataDirs) {
         std::string dirStr = dir.string();
         if (bsaManagers.find(dirStr) == bsaManagers.end()) {
             std::cout << "--- Initializing BSA Manager for: " << dirStr << " ---" << std::endl;
-            auto manager = std::make_unique<BsaManager>();
+            auto manager = std::make_shared<BsaManager>();
             manager->loadArchives(dirStr, bsaCacheDirectory);
             bsaManagers[dirStr] = std::move(manager);
         }
+        next->managers.push_back(bsaManagers[dirStr]);
     }
+
+    std::atomic_store(&snapshot, std::shared_ptr<const DirectorySnapshot>(std::move(next)));
+    return true;
 }
 
-std::vector<char> AssetManager::extractFile(const std::string& relativePath) {
-    std::vector<char> fileData;
+std::shared_ptr<const AssetManager::DirectorySnapshot> AssetManager::currentSnapshot() const {
+    auto current = std::atomic_load(&snapshot);
+    if (!current) {
+        static const auto empty = std::make_shared<const DirectorySnapshot>();
+        return empty;
+    }
+    return current;
+}
+
+bool AssetManager::ArchiveLocationCache::find(const PathKey& key, int& directory) const {
+    const Shard& shard = shards[key.hash() % kShardCount];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.locations.find(key);
+    if (it == shard.locations.end()) {
+        return false;
+    }
+    directory = it->second;
+    return true;
+}
 
-    // 1. Search for loose files in all active directories, from highest priority to lowest.
-    for (auto it = activeDataDirectories.rbegin(); it != activeDataDirectories.rend(); ++it) {
+void AssetManager::ArchiveLocationCache::store(const PathKey& key, int directory) {
+    Shard& shard = shards[key.hash() % kShardCount];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.locations[key] = directory;
+}
+
+// Searches for a loose file in all active directories, from highest priority to lowest.
+std::filesystem::path AssetManager::findLooseFile(const DirectorySnapshot& snapshot, const std::string& relativePath) {
+    const auto& dirs = snapshot.dataDirectories;
+    for (auto it = dirs.rbegin(); it != dirs.rend(); ++it) {
         std::filesystem::path loosePath = *it / relativePath;
-        if (std::filesystem::exists(loosePath)) {
-            std::ifstream file(loosePath, std::ios::binary);
-            fileData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
-            return fileData;
+        std::error_code ec;
+        if (std::filesystem::exists(loosePath, ec)) {
+            return loosePath;
         }
     }
+    return {};
+}
 
-    // 2. If no loose file was found, search the BSAs for each directory.
-    for (auto it = activeDataDirectories.rbegin(); it != activeDataDirectories.rend(); ++it) {
-        std::string dirStr = it->string();
-        auto managerIt = bsaManagers.find(dirStr);
-        if (managerIt != bsaManagers.end()) {
-            fileData = managerIt->second->extractFile(relativePath);
+// Searches the BSAs for each directory, from highest priority to lowest.
+std::vector<char> AssetManager::extractFromArchives(const DirectorySnapshot& snapshot, const PathKey& internalPath, std::string* resolvedFrom) {
+    if (internalPath.empty()) {
+        return {};
+    }
+
+    int known = 0;
+    if (snapshot.archiveLocations.find(internalPath, known)) {
+        if (known < 0) {
+            return {}; // Already known to be missing from every archive.
+        }
+        if (const auto& manager = snapshot.managers[known]) {
+            std::vector<char> fileData = extractFromManager(*manager, internalPath);
             if (!fileData.empty()) {
+                if (resolvedFrom) *resolvedFrom = archiveSource(snapshot.dataDirectories[known]);
                 return fileData;
             }
         }
     }
 
+    for (int i = static_cast<int>(snapshot.managers.size()) - 1; i >= 0; --i) {
+        if (const auto& manager = snapshot.managers[i]) {
+            std::vector<char> fileData = extractFromManager(*manager, internalPath);
+            if (!fileData.empty()) {
+                snapshot.archiveLocations.store(internalPath, i);
+                if (resolvedFrom) *resolvedFrom = archiveSource(snapshot.dataDirectories[i]);
+                return fileData;
+            }
+        }
+    }
+    snapshot.archiveLocations.store(internalPath, -1);
     return {}; // Return empty vector if not found.
-}
\ No newline at end of file
+}
+
+// Checks the shared cache before touching the archive, and publishes what it extracts.
+std::vector<char> AssetManager::extractFromManager(const BsaManager& manager, const PathKey& internalPath) {
+    uint64_t archiveFingerprint = 0;
+    const bool cacheable = sharedCache.isOpen() && manager.locateFile(internalPath, archiveFingerprint);
+
+    std::vector<char> fileData;
+    if (cacheable && sharedCache.lookup(archiveFingerprint, internalPath, fileData)) {
+        return fileData;
+    }
+    fileData = manager.extractFile(internalPath);
+    if (cacheable && !fileData.empty()) {
+        sharedCache.insert(archiveFingerprint, internalPath, fileData);
+    }
+    return fileData;
+}
+
+bool AssetManager::enableSharedCache(const std::string& name, size_t capacityBytes) {
+    if (capacityBytes == 0) {
+        sharedCache.close();
+        return false;
+    }
+    return sharedCache.open(name, capacityBytes);
+}
+
+std::string AssetManager::archiveSource(const std::filesystem::path& dataDirectory) {
+    return "archive:" + dataDirectory.string();
+}
+
+std::string AssetManager::resolveSource(const std::string& relativePath) const {
+    auto dirs = currentSnapshot();
+    std::filesystem::path loosePath = findLooseFile(*dirs, relativePath);
+    if (!loosePath.empty()) {
+        return loosePath.string();
+    }
+    PathKey internalPath(relativePath);
+    for (size_t i = dirs->managers.size(); i-- > 0;) {
+        uint64_t archiveFingerprint = 0;
+        if (dirs->managers[i] && dirs->managers[i]->locateFile(internalPath, archiveFingerprint)) {
+            return archiveSource(dirs->dataDirectories[i]);
+        }
+    }
+    return "";
+}
+
+uint64_t AssetManager::sourceFingerprint(const std::string& relativePath, std::string* resolvedFrom) const {
+    if (resolvedFrom) resolvedFrom->clear();
+    auto dirs = currentSnapshot();
+
+    std::filesystem::path loosePath = findLooseFile(*dirs, relativePath);
+    if (!loosePath.empty()) {
+        std::error_code ec;
+        uint64_t stamp[2] = { std::filesystem::file_size(loosePath, ec), 0 };
+        if (!ec) stamp[1] = static_cast<uint64_t>(std::filesystem::last_write_time(loosePath, ec).time_since_epoch().count());
+        if (ec) return 0;
+        std::string source = loosePath.string();
+        uint64_t fingerprint = contentHash64(stamp, sizeof(stamp), contentHash64(source.data(), source.size()));
+        if (resolvedFrom) *resolvedFrom = std::move(source);
+        return fingerprint;
+    }
+
+    PathKey internalPath(relativePath);
+    for (size_t i = dirs->managers.size(); i-- > 0;) {
+        uint64_t archiveFingerprint = 0;
+        if (dirs->managers[i] && dirs->managers[i]->locateFile(internalPath, archiveFingerprint)) {
+            if (resolvedFrom) *resolvedFrom = archiveSource(dirs->dataDirectories[i]);
+            return contentHash64(internalPath.view().data(), internalPath.size(), archiveFingerprint);
+        }
+    }
+    return 0;
+}
+
+std::vector<char> AssetManager::extractFile(const std::string& relativePath, std::string* resolvedFrom) {
+    auto dirs = currentSnapshot();
+    if (resolvedFrom) resolvedFrom->clear();
+
+    // 1. Loose files take priority over archived ones.
+    std::filesystem::path loosePath = findLooseFile(*dirs, relativePath);
+    if (!loosePath.empty()) {
+        std::vector<FileReadRequest> request(1);
+        request[0].path = loosePath;
+        fileReader.readAll(request);
+        if (resolvedFrom) *resolvedFrom = loosePath.string();
+        return std::move(request[0].data);
+    }
+
+    // 2. If no loose file was found, search the BSAs for each directory.
+    return extractFromArchives(*dirs, PathKey(relativePath), resolvedFrom);
+}
+
+std::vector<std::vector<char>> AssetManager::extractFiles(const std::vector<std::string>& relativePaths, std::vector<std::string>* resolvedFrom) {
+    std::vector<std::vector<char>> results(relativePaths.size());
+    if (resolvedFrom) resolvedFrom->assign(relativePaths.size(), std::string());
+    auto dirs = currentSnapshot(); // One snapshot for the whole batch.
+
+    // 1. Resolve every loose file first so the whole set can be submitted as one batch.
+    std::vector<FileReadRequest> looseReads;
+    std::vector<size_t> looseIndices;
+    std::vector<size_t> archiveIndices;
+    for (size_t i = 0; i < relativePaths.size(); ++i) {
+        std::filesystem::path loosePath = findLooseFile(*dirs, relativePaths[i]);
+        if (!loosePath.empty()) {
+            FileReadRequest request;
+            request.path = std::move(loosePath);
+            looseReads.push_back(std::move(request));
+            looseIndices.push_back(i);
+        }
+        else {
+            archiveIndices.push_back(i);
+        }
+    }
+
+    fileReader.readAll(looseReads);
+    for (size_t i = 0; i < looseReads.size(); ++i) {
+        if (resolvedFrom && looseReads[i].succeeded) (*resolvedFrom)[looseIndices[i]] = looseReads[i].path.string();
+        results[looseIndices[i]] = std::move(looseReads[i].data);
+    }
+
+    // 2. Archived files still go through libbsarch, which does its own reads.
+    for (size_t index : archiveIndices) {
+        results[index] = extractFromArchives(*dirs, PathKey(relativePaths[index]), resolvedFrom ? &(*resolvedFrom)[index] : nullptr);
+    }
+
+    return results;
+}
@@ -1,21 +1,91 @@
 #pragma once
 
 #include "BsaManager.h"
+#include "AsyncFileReader.h"
+#include "PathKey.h"
+#include "SharedAssetCache.h"
 #include <string>
 #include <vector>
 #include <filesystem>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
+// Thread safety: extractFile()/extractFiles() may be called from any number of threads.
+// They read an immutable snapshot of the active directories and their archive managers,
+// which setActiveDirectories() replaces atomically; in-flight extractions keep using the
+// snapshot they started with.
 class AssetManager {
 public:
     AssetManager() = default;
 
-    void setActiveDirectories(const std::vector<std::filesystem::path>& dataDirs, const std::filesystem::path& cacheDir);
-    std::vector<char> extractFile(const std::string& relativePath);
+    // Returns true if the directory list actually changed.
+    bool setActiveDirectories(const std::vector<std::filesystem::path>& dataDirs, const std::filesystem::path& cacheDir);
+
+    // 'resolvedFrom', when given, receives where the file was found: the loose file's path,
+    // "archive:<data directory>" for archived files, or an empty string if it was not found.
+    std::vector<char> extractFile(const std::string& relativePath, std::string* resolvedFrom = nullptr);
+
+    // Extracts a batch of files. Loose files are read concurrently through the async reader;
+    // results are returned in the same order as the requested paths (empty when not found).
+    std::vector<std::vector<char>> extractFiles(const std::vector<std::string>& relativePaths, std::vector<std::string>* resolvedFrom = nullptr);
+
+    // Where extractFile() would currently find a path, in the same form as 'resolvedFrom',
+    // without extracting anything. Used to tell whether a directory change affects a file.
+    std::string resolveSource(const std::string& relativePath) const;
+
+    // Identifies the exact file extractFile() would currently return (its location, size and
+    // modification time) without reading it, so derived data can be cached across runs.
+    // Returns 0 when the path does not resolve. 'resolvedFrom' is filled as for extractFile().
+    uint64_t sourceFingerprint(const std::string& relativePath, std::string* resolvedFrom = nullptr) const;
+
+    // Returns a buffer obtained from extractFile(s) so its allocation can be reused.
+    void recycleBuffer(std::vector<char>&& buffer) { fileReader.recycleBuffer(std::move(buffer)); }
+
+    // Opts in to the cross-process cache of extracted archive files. Call before any
+    // extraction starts; a capacity of 0 leaves it disabled.
+    bool enableSharedCache(const std::string& name, size_t capacityBytes);
+    const SharedAssetCache& getSharedCache() const { return sharedCache; }
 
 private:
-    std::vector<std::filesystem::path> activeDataDirectories;
-    std::map<std::string, std::unique_ptr<BsaManager>> bsaManagers;
+    // Remembers which directory's archives served a path (-1 when none of them hold it), so
+    // repeat lookups skip the per-directory probing and the brute-force fallback search.
+    // Sharded so concurrent loaders rarely contend on the same lock.
+    class ArchiveLocationCache {
+    public:
+        bool find(const PathKey& key, int& directory) const;
+        void store(const PathKey& key, int directory);
+
+    private:
+        static constexpr size_t kShardCount = 16;
+        struct Shard {
+            mutable std::shared_mutex mutex;
+            std::unordered_map<PathKey, int> locations;
+        };
+        Shard shards[kShardCount];
+    };
+
+    struct DirectorySnapshot {
+        std::vector<std::filesystem::path> dataDirectories;      // Lowest priority first.
+        std::vector<std::shared_ptr<const BsaManager>> managers; // Parallel to dataDirectories.
+        mutable ArchiveLocationCache archiveLocations;           // Dropped along with the snapshot.
+    };
+
+    std::shared_ptr<const DirectorySnapshot> currentSnapshot() const;
+    static std::filesystem::path findLooseFile(const DirectorySnapshot& snapshot, const std::string& relativePath);
+    std::vector<char> extractFromArchives(const DirectorySnapshot& snapshot, const PathKey& internalPath, std::string* resolvedFrom);
+    static std::string archiveSource(const std::filesystem::path& dataDirectory);
+    std::vector<char> extractFromManager(const BsaManager& manager, const PathKey& internalPath);
+
+    std::shared_ptr<const DirectorySnapshot> snapshot; // Only accessed through std::atomic_load/atomic_store.
+
+    // Writer-side state, only touched by setActiveDirectories().
+    std::mutex configureMutex;
+    std::map<std::string, std::shared_ptr<BsaManager>> bsaManagers;
     std::filesystem::path bsaCacheDirectory;
-};
\ No newline at end of file
+
+    AsyncFileReader fileReader;
+    SharedAssetCache sharedCache;
+};
@@ -0,0 +1,334 @@
+#include "AsyncFileReader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef NPC_HAVE_IO_URING
+#include <liburing.h>
+#endif
+
+namespace {
+    // Keep enough reads in flight to cover a full texture set plus a prefetch window.
+    constexpr unsigned kRingQueueDepth = 64;
+    constexpr size_t kFallbackReadThreads = 8;
+
+    // Upper bounds for buffers kept around for reuse between batches.
+    constexpr size_t kMaxPooledBuffers = 32;
+    constexpr size_t kMaxPooledBytes = 256ull * 1024 * 1024;
+}
+
+#ifdef NPC_HAVE_IO_URING
+struct AsyncFileReader::IoUringState {
+    io_uring ring{};
+};
+#else
+struct AsyncFileReader::IoUringState {};
+#endif
+
+AsyncFileReader::AsyncFileReader() {
+#ifdef NPC_HAVE_IO_URING
+    auto state = std::make_unique<IoUringState>();
+    int rc = io_uring_queue_init(kRingQueueDepth, &state->ring, 0);
+    if (rc == 0) {
+        ring = std::move(state);
+    }
+    else {
+        // Typically -ENOSYS on old kernels or -EPERM when io_uring is disabled by policy.
+        std::cerr << "io_uring unavailable (error " << -rc << "). Falling back to threaded reads." << std::endl;
+    }
+#endif
+    if (!ring) {
+        size_t threads = std::min<size_t>(kFallbackReadThreads, std::max(1u, std::thread::hardware_concurrency()));
+        pool = std::make_unique<ThreadPool>(threads);
+    }
+    std::cout << "--- Async file reader using " << backendName() << " backend ---" << std::endl;
+}
+
+AsyncFileReader::~AsyncFileReader() {
+#ifdef NPC_HAVE_IO_URING
+    if (ring) {
+        io_uring_queue_exit(&ring->ring);
+    }
+#endif
+}
+
+const char* AsyncFileReader::backendName() const {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    return ring ? "io_uring" : "thread pool";
+}
+
+void AsyncFileReader::readAll(std::vector<FileReadRequest>& requests) {
+    if (requests.empty()) {
+        return;
+    }
+    if (readAllIoUring(requests)) {
+        return;
+    }
+    ThreadPool* fallback = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        if (!pool) {
+            // The ring failed mid-batch; build the fallback pool lazily.
+            pool = std::make_unique<ThreadPool>(kFallbackReadThreads);
+        }
+        fallback = pool.get();
+    }
+    readAllThreadPool(*fallback, requests);
+}
+
+std::vector<char> AsyncFileReader::acquireBuffer(size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(bufferPoolMutex);
+        // Best fit: the smallest pooled buffer that can hold the request.
+        auto best = bufferPool.end();
+        for (auto it = bufferPool.begin(); it != bufferPool.end(); ++it) {
+            if (it->capacity() >= size && (best == bufferPool.end() || it->capacity() < best->capacity())) {
+                best = it;
+            }
+        }
+        if (best != bufferPool.end()) {
+            std::vector<char> buffer = std::move(*best);
+            bufferPool.erase(best);
+            pooledBytes -= buffer.capacity();
+            buffer.resize(size);
+            return buffer;
+        }
+    }
+    return std::vector<char>(size);
+}
+
+void AsyncFileReader::recycleBuffer(std::vector<char>&& buffer) {
+    if (buffer.capacity() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(bufferPoolMutex);
+    if (bufferPool.size() >= kMaxPooledBuffers || pooledBytes + buffer.capacity() > kMaxPooledBytes) {
+        return; // Let it free normally.
+    }
+    buffer.clear();
+    pooledBytes += buffer.capacity();
+    bufferPool.push_back(std::move(buffer));
+}
+
+bool AsyncFileReader::readWholeFile(const std::filesystem::path& path, std::vector<char>& out) {
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    out = acquireBuffer(static_cast<size_t>(size.QuadPart));
+    size_t done = 0;
+    while (done < out.size()) {
+        // Positional read: the offset travels with the request, not with the handle.
+        OVERLAPPED at{};
+        at.Offset = static_cast<DWORD>(done & 0xFFFFFFFFull);
+        at.OffsetHigh = static_cast<DWORD>(static_cast<unsigned long long>(done) >> 32);
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(out.size() - done, 1u << 30));
+        DWORD got = 0;
+        if (!ReadFile(file, out.data() + done, chunk, &got, &at) || got == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        done += got;
+    }
+    CloseHandle(file);
+    return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    out = acquireBuffer(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t got = pread(fd, out.data() + done, out.size() - done, static_cast<off_t>(done));
+        if (got <= 0) {
+            close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(got);
+    }
+    close(fd);
+    return true;
+#endif
+}
+
+void AsyncFileReader::readAllThreadPool(ThreadPool& workers, std::vector<FileReadRequest>& requests) {
+    std::vector<std::future<void>> pending;
+    pending.reserve(requests.size());
+    for (auto& request : requests) {
+        pending.push_back(workers.submit([this, &request]() {
+            request.succeeded = readWholeFile(request.path, request.data);
+            if (!request.succeeded) {
+                recycleBuffer(std::move(request.data));
+                request.data = {};
+            }
+        }));
+    }
+    for (auto& f : pending) {
+        f.get();
+    }
+}
+
+#ifdef NPC_HAVE_IO_URING
+bool AsyncFileReader::readAllIoUring(std::vector<FileReadRequest>& requests) {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    if (!ring) {
+        return false;
+    }
+
+    struct InFlight {
+        int fd = -1;
+        size_t done = 0;
+        bool finished = false;
+    };
+    std::vector<InFlight> state(requests.size());
+    std::vector<size_t> toSubmit;
+    toSubmit.reserve(requests.size());
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        auto& request = requests[i];
+        request.succeeded = false;
+        int fd = open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st {};
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) close(fd);
+            state[i].finished = true;
+            continue;
+        }
+        state[i].fd = fd;
+        request.data = acquireBuffer(static_cast<size_t>(st.st_size));
+        if (request.data.empty()) {
+            request.succeeded = true;
+            state[i].finished = true;
+            continue;
+        }
+        toSubmit.push_back(i);
+    }
+
+    bool ringFailed = false;
+    size_t inFlight = 0;
+    size_t nextToSubmit = 0;
+    // Short reads are re-queued here with their progress kept in 'state'.
+    std::vector<size_t> resubmit;
+
+    while (!ringFailed && (nextToSubmit < toSubmit.size() || !resubmit.empty() || inFlight > 0)) {
+        // Fill the submission queue as far as it goes.
+        unsigned queued = 0;
+        while (inFlight + queued < kRingQueueDepth && (!resubmit.empty() || nextToSubmit < toSubmit.size())) {
+            size_t index;
+            if (!resubmit.empty()) {
+                index = resubmit.back();
+                resubmit.pop_back();
+            }
+            else {
+                index = toSubmit[nextToSubmit++];
+            }
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring->ring);
+            if (!sqe) {
+                resubmit.push_back(index);
+                break;
+            }
+            auto& request = requests[index];
+            size_t done = state[index].done;
+            io_uring_prep_read(sqe, state[index].fd, request.data.data() + done,
+                static_cast<unsigned>(std::min<size_t>(request.data.size() - done, 1u << 30)), done);
+            io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(index)));
+            ++queued;
+        }
+        if (queued > 0) {
+            int rc = io_uring_submit(&ring->ring);
+            if (rc < 0) {
+                ringFailed = true;
+                break;
+            }
+            inFlight += queued;
+        }
+        if (inFlight == 0) {
+            continue;
+        }
+
+        // Reap whatever has completed, in any order.
+        io_uring_cqe* cqe = nullptr;
+        if (io_uring_wait_cqe(&ring->ring, &cqe) < 0) {
+            ringFailed = true;
+            break;
+        }
+        do {
+            size_t index = static_cast<size_t>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+            int result = cqe->res;
+            io_uring_cqe_seen(&ring->ring, cqe);
+            --inFlight;
+
+            auto& request = requests[index];
+            if (result <= 0) {
+                state[index].finished = true; // Read error or unexpected EOF.
+            }
+            else {
+                state[index].done += static_cast<size_t>(result);
+                if (state[index].done >= request.data.size()) {
+                    request.succeeded = true;
+                    state[index].finished = true;
+                }
+                else {
+                    resubmit.push_back(index);
+                }
+            }
+        } while (io_uring_peek_cqe(&ring->ring, &cqe) == 0);
+    }
+
+    if (ringFailed) {
+        // Drain anything the kernel still owns before the buffers can be touched again.
+        while (inFlight > 0) {
+            io_uring_cqe* cqe = nullptr;
+            if (io_uring_wait_cqe(&ring->ring, &cqe) < 0) break;
+            io_uring_cqe_seen(&ring->ring, cqe);
+            --inFlight;
+        }
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (state[i].fd >= 0) {
+            close(state[i].fd);
+        }
+        if (!requests[i].succeeded) {
+            recycleBuffer(std::move(requests[i].data));
+            requests[i].data = {};
+        }
+    }
+
+    if (ringFailed) {
+        std::cerr << "io_uring submission failed. Disabling the ring and retrying with threaded reads." << std::endl;
+        io_uring_queue_exit(&ring->ring);
+        ring.reset();
+        return false;
+    }
+    return true;
+}
+#else
+bool AsyncFileReader::readAllIoUring(std::vector<FileReadRequest>&) {
+    return false;
+}
+#endif
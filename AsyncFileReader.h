@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ThreadPool;
+
+// A single whole-file read submitted as part of a batch.
+// On success 'data' holds the file contents in a buffer taken from the reader's pool.
+struct FileReadRequest {
+    std::filesystem::path path;
+    std::vector<char> data;
+    bool succeeded = false;
+};
+
+// Reads batches of files concurrently instead of one blocking read at a time.
+// All public members are safe to call from several threads.
+//
+// Linux builds configured with liburing (NPC_HAVE_IO_URING) submit the whole batch to an
+// io_uring and reap completions out of order. Everywhere else, or if the ring cannot be
+// created at runtime, the batch is spread over a small thread pool using positional reads.
+class AsyncFileReader {
+public:
+    AsyncFileReader();
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    // Blocks until every request in the batch has either completed or failed.
+    void readAll(std::vector<FileReadRequest>& requests);
+
+    // Buffers handed out by readAll() may be returned once the caller has consumed them,
+    // so the next batch can reuse their allocations.
+    std::vector<char> acquireBuffer(size_t size);
+    void recycleBuffer(std::vector<char>&& buffer);
+
+    const char* backendName() const;
+
+private:
+    bool readAllIoUring(std::vector<FileReadRequest>& requests);
+    void readAllThreadPool(ThreadPool& workers, std::vector<FileReadRequest>& requests);
+    bool readWholeFile(const std::filesystem::path& path, std::vector<char>& out);
+
+    struct IoUringState;
+    // A ring is not safe to submit to from several threads, so batches using it are serialised.
+    // The mutex also guards swapping from the ring to the fallback pool.
+    mutable std::mutex ringMutex;
+    std::unique_ptr<IoUringState> ring; // Null when io_uring is unavailable.
+    std::unique_ptr<ThreadPool> pool;   // Never destroyed once created, so it can be used unlocked.
+
+    std::mutex bufferPoolMutex;
+    std::vector<std::vector<char>> bufferPool;
+    size_t pooledBytes = 0;
+};
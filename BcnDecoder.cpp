@@ -0,0 +1,718 @@
+#include "BcnDecoder.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BCN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+// MSVC accepts any intrinsic without per-function target flags.
+#define BCN_TARGET_SSE41
+#define BCN_TARGET_AVX2
+#else
+#define BCN_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define BCN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define BCN_X86 0
+#endif
+
+namespace Bcn {
+
+namespace {
+
+    // Decodes one full 4x4 block, or two horizontally adjacent blocks (8x4 pixels), to RGBA8.
+    using BlockFn = void (*)(const uint8_t* block, uint8_t* dst, size_t pitch);
+
+    struct Kernels {
+        BlockFn single = nullptr;
+        BlockFn pair = nullptr; // Optional.
+    };
+
+    uint16_t load16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t load32(const uint8_t* p) {
+        return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+
+    uint64_t load64(const uint8_t* p) {
+        return uint64_t(load32(p)) | (uint64_t(load32(p + 4)) << 32);
+    }
+
+    // --- BC1-BC5 palettes (shared by every backend, so the SIMD paths only differ in how
+    //     they expand indices) ---
+
+    // The four RGBA colours of a BC1-style colour block. Colour blocks inside BC2/BC3 always
+    // use four colours; a standalone BC1 block switches to three colours plus transparent
+    // black when c0 <= c1.
+    void colorPalette(const uint8_t* block, bool allowPunchThrough, uint8_t palette[16]) {
+        uint16_t c0 = load16(block);
+        uint16_t c1 = load16(block + 2);
+        auto expand = [](uint16_t c, uint8_t* out) {
+            int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+            out[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+            out[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+            out[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+            out[3] = 255;
+        };
+        expand(c0, palette);
+        expand(c1, palette + 4);
+
+        if (c0 > c1 || !allowPunchThrough) {
+            for (int c = 0; c < 3; ++c) {
+                palette[8 + c] = static_cast<uint8_t>((2 * palette[c] + palette[4 + c]) / 3);
+                palette[12 + c] = static_cast<uint8_t>((palette[c] + 2 * palette[4 + c]) / 3);
+            }
+            palette[11] = palette[15] = 255;
+        }
+        else {
+            for (int c = 0; c < 3; ++c) {
+                palette[8 + c] = static_cast<uint8_t>((palette[c] + palette[4 + c]) / 2);
+            }
+            palette[11] = 255;
+            palette[12] = palette[13] = palette[14] = palette[15] = 0;
+        }
+    }
+
+    // The eight values of a BC3 alpha / BC4 / BC5 channel block.
+    void channelPalette(const uint8_t* block, uint8_t palette[8]) {
+        int a0 = block[0], a1 = block[1];
+        palette[0] = static_cast<uint8_t>(a0);
+        palette[1] = static_cast<uint8_t>(a1);
+        if (a0 > a1) {
+            for (int i = 1; i <= 6; ++i) {
+                palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1) / 7);
+            }
+        }
+        else {
+            for (int i = 1; i <= 4; ++i) {
+                palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1) / 5);
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    // The 16 decoded values of a channel block, in pixel order.
+    void channelValues(const uint8_t* block, uint8_t values[16]) {
+        uint8_t palette[8];
+        channelPalette(block, palette);
+        uint64_t indices = load64(block) >> 16;
+        for (int p = 0; p < 16; ++p) {
+            values[p] = palette[(indices >> (3 * p)) & 7];
+        }
+    }
+
+    // --- Scalar reference kernels ---
+
+    void decodeColorScalar(const uint8_t* block, bool allowPunchThrough, uint8_t* dst, size_t pitch) {
+        uint8_t palette[16];
+        colorPalette(block, allowPunchThrough, palette);
+        uint32_t indices = load32(block + 4);
+        for (int p = 0; p < 16; ++p) {
+            std::memcpy(dst + (p >> 2) * pitch + (p & 3) * 4, palette + ((indices >> (2 * p)) & 3) * 4, 4);
+        }
+    }
+
+    void decodeBC1Scalar(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        decodeColorScalar(block, true, dst, pitch);
+    }
+
+    void decodeBC2Scalar(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        decodeColorScalar(block + 8, false, dst, pitch);
+        uint64_t alpha = load64(block);
+        for (int p = 0; p < 16; ++p) {
+            dst[(p >> 2) * pitch + (p & 3) * 4 + 3] = static_cast<uint8_t>(((alpha >> (4 * p)) & 15) * 17);
+        }
+    }
+
+    void decodeBC3Scalar(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        decodeColorScalar(block + 8, false, dst, pitch);
+        uint8_t alpha[16];
+        channelValues(block, alpha);
+        for (int p = 0; p < 16; ++p) {
+            dst[(p >> 2) * pitch + (p & 3) * 4 + 3] = alpha[p];
+        }
+    }
+
+    void decodeBC4Scalar(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        uint8_t red[16];
+        channelValues(block, red);
+        for (int p = 0; p < 16; ++p) {
+            uint8_t* pixel = dst + (p >> 2) * pitch + (p & 3) * 4;
+            pixel[0] = red[p];
+            pixel[1] = 0;
+            pixel[2] = 0;
+            pixel[3] = 255;
+        }
+    }
+
+    void decodeBC5Scalar(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        uint8_t red[16], green[16];
+        channelValues(block, red);
+        channelValues(block + 8, green);
+        for (int p = 0; p < 16; ++p) {
+            uint8_t* pixel = dst + (p >> 2) * pitch + (p & 3) * 4;
+            pixel[0] = red[p];
+            pixel[1] = green[p];
+            pixel[2] = 0;
+            pixel[3] = 255;
+        }
+    }
+
+    // --- BC7 ---
+
+    struct Bc7Mode {
+        uint8_t subsets, partitionBits, rotationBits, indexSelectionBits;
+        uint8_t colorBits, alphaBits, endpointPBits, sharedPBits, indexBits, indexBits2;
+    };
+
+    constexpr Bc7Mode kBc7Modes[8] = {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+    };
+
+    // Two-subset partitions; bit i is the subset of pixel i.
+    constexpr uint16_t kBc7Partitions2[64] = {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+        0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+        0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+        0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+        0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+    };
+
+    constexpr uint8_t kBc7Partitions3[64][16] = {
+        { 0,0,1,1, 0,0,1,1, 0,2,2,1, 2,2,2,2 }, { 0,0,0,1, 0,0,1,1, 2,2,1,1, 2,2,2,1 },
+        { 0,0,0,0, 2,0,0,1, 2,2,1,1, 2,2,1,1 }, { 0,2,2,2, 0,0,2,2, 0,0,1,1, 0,1,1,1 },
+        { 0,0,0,0, 0,0,0,0, 1,1,2,2, 1,1,2,2 }, { 0,0,1,1, 0,0,1,1, 0,0,2,2, 0,0,2,2 },
+        { 0,0,2,2, 0,0,2,2, 1,1,1,1, 1,1,1,1 }, { 0,0,1,1, 0,0,1,1, 2,2,1,1, 2,2,1,1 },
+        { 0,0,0,0, 0,0,0,0, 1,1,1,1, 2,2,2,2 }, { 0,0,0,0, 1,1,1,1, 1,1,1,1, 2,2,2,2 },
+        { 0,0,0,0, 1,1,1,1, 2,2,2,2, 2,2,2,2 }, { 0,0,1,2, 0,0,1,2, 0,0,1,2, 0,0,1,2 },
+        { 0,1,1,2, 0,1,1,2, 0,1,1,2, 0,1,1,2 }, { 0,1,2,2, 0,1,2,2, 0,1,2,2, 0,1,2,2 },
+        { 0,0,1,1, 0,1,1,2, 1,1,2,2, 1,2,2,2 }, { 0,0,1,1, 2,0,0,1, 2,2,0,0, 2,2,2,0 },
+        { 0,0,0,1, 0,0,1,1, 0,1,1,2, 1,1,2,2 }, { 0,1,1,1, 0,0,1,1, 2,0,0,1, 2,2,0,0 },
+        { 0,0,0,0, 1,1,2,2, 1,1,2,2, 1,1,2,2 }, { 0,0,2,2, 0,0,2,2, 0,0,2,2, 1,1,1,1 },
+        { 0,1,1,1, 0,1,1,1, 0,2,2,2, 0,2,2,2 }, { 0,0,0,1, 0,0,0,1, 2,2,2,1, 2,2,2,1 },
+        { 0,0,0,0, 0,0,1,1, 0,1,2,2, 0,1,2,2 }, { 0,0,0,0, 1,1,0,0, 2,2,1,0, 2,2,1,0 },
+        { 0,1,2,2, 0,1,2,2, 0,0,1,1, 0,0,0,0 }, { 0,0,1,2, 0,0,1,2, 1,1,2,2, 2,2,2,2 },
+        { 0,1,1,0, 1,2,2,1, 1,2,2,1, 0,1,1,0 }, { 0,0,0,0, 0,1,1,0, 1,2,2,1, 1,2,2,1 },
+        { 0,0,2,2, 1,1,0,2, 1,1,0,2, 0,0,2,2 }, { 0,1,1,0, 0,1,1,0, 2,0,0,2, 2,2,2,2 },
+        { 0,0,1,1, 0,1,2,2, 0,1,2,2, 0,0,1,1 }, { 0,0,0,0, 2,0,0,0, 2,2,1,1, 2,2,2,1 },
+        { 0,0,0,0, 0,0,0,2, 1,1,2,2, 1,2,2,2 }, { 0,2,2,2, 0,0,2,2, 0,0,1,2, 0,0,1,1 },
+        { 0,0,1,1, 0,0,1,2, 0,0,2,2, 0,2,2,2 }, { 0,1,2,0, 0,1,2,0, 0,1,2,0, 0,1,2,0 },
+        { 0,0,0,0, 1,1,1,1, 2,2,2,2, 0,0,0,0 }, { 0,1,2,0, 1,2,0,1, 2,0,1,2, 0,1,2,0 },
+        { 0,1,2,0, 2,0,1,2, 1,2,0,1, 0,1,2,0 }, { 0,0,1,1, 2,2,0,0, 1,1,2,2, 0,0,1,1 },
+        { 0,0,1,1, 1,1,2,2, 2,2,0,0, 0,0,1,1 }, { 0,1,0,1, 0,1,0,1, 2,2,2,2, 2,2,2,2 },
+        { 0,0,0,0, 0,0,0,0, 2,1,2,1, 2,1,2,1 }, { 0,0,2,2, 1,1,2,2, 0,0,2,2, 1,1,2,2 },
+        { 0,0,2,2, 0,0,1,1, 0,0,2,2, 0,0,1,1 }, { 0,2,2,0, 1,2,2,1, 0,2,2,0, 1,2,2,1 },
+        { 0,1,0,1, 2,2,2,2, 2,2,2,2, 0,1,0,1 }, { 0,0,0,0, 2,1,2,1, 2,1,2,1, 2,1,2,1 },
+        { 0,1,0,1, 0,1,0,1, 0,1,0,1, 2,2,2,2 }, { 0,2,2,2, 0,1,1,1, 0,2,2,2, 0,1,1,1 },
+        { 0,0,0,2, 1,1,1,2, 0,0,0,2, 1,1,1,2 }, { 0,0,0,0, 2,1,1,2, 2,1,1,2, 2,1,1,2 },
+        { 0,2,2,2, 0,1,1,1, 0,1,1,1, 0,2,2,2 }, { 0,0,0,2, 1,1,1,2, 1,1,1,2, 0,0,0,2 },
+        { 0,1,1,0, 0,1,1,0, 0,1,1,0, 2,2,2,2 }, { 0,0,0,0, 0,0,0,0, 2,1,1,2, 2,1,1,2 },
+        { 0,1,1,0, 0,1,1,0, 2,2,2,2, 2,2,2,2 }, { 0,0,2,2, 0,0,1,1, 0,0,1,1, 0,0,2,2 },
+        { 0,0,2,2, 1,1,2,2, 1,1,2,2, 0,0,2,2 }, { 0,0,0,0, 0,0,0,0, 0,0,0,0, 2,1,1,2 },
+        { 0,0,0,2, 0,0,0,1, 0,0,0,2, 0,0,0,1 }, { 0,2,2,2, 1,2,2,2, 0,2,2,2, 1,2,2,2 },
+        { 0,1,0,1, 2,2,2,2, 2,2,2,2, 2,2,2,2 }, { 0,1,1,1, 2,0,1,1, 2,2,0,1, 2,2,2,0 },
+    };
+
+    // Pixels whose index drops its top bit: the anchor of subset 1 (two subsets), and of
+    // subsets 1 and 2 (three subsets). Subset 0 is always anchored at pixel 0.
+    constexpr uint8_t kBc7Anchor2[64] = {
+        15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15,
+        15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+        15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,
+         6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15,
+    };
+    constexpr uint8_t kBc7Anchor3a[64] = {
+         3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,
+         3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+         8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,
+         3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3,
+    };
+    constexpr uint8_t kBc7Anchor3b[64] = {
+        15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8,
+        15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+        15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8,
+        15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8,
+    };
+
+    constexpr uint8_t kBc7Weights2[4] = { 0, 21, 43, 64 };
+    constexpr uint8_t kBc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    constexpr uint8_t kBc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    const uint8_t* bc7Weights(unsigned bits) {
+        return bits == 2 ? kBc7Weights2 : bits == 3 ? kBc7Weights3 : kBc7Weights4;
+    }
+
+    // Reads a 128-bit block least significant bit first.
+    class BlockBits {
+    public:
+        explicit BlockBits(const uint8_t* block) : lo(load64(block)), hi(load64(block + 8)) {}
+
+        uint32_t read(unsigned count) {
+            if (count == 0) return 0;
+            uint64_t value;
+            if (pos >= 64) value = hi >> (pos - 64);
+            else if (pos + count <= 64) value = lo >> pos;
+            else value = (lo >> pos) | (hi << (64 - pos));
+            pos += count;
+            return static_cast<uint32_t>(value) & ((1u << count) - 1);
+        }
+
+    private:
+        uint64_t lo, hi;
+        unsigned pos = 0;
+    };
+
+    uint8_t bc7Interpolate(int e0, int e1, unsigned weight) {
+        return static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+    }
+
+    void decodeBC7Scalar(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        unsigned mode = 0;
+        while (mode < 8 && !(block[0] & (1u << mode))) ++mode;
+        if (mode == 8) {
+            // Reserved encoding; the spec decodes it as transparent black.
+            for (int row = 0; row < 4; ++row) std::memset(dst + row * pitch, 0, 16);
+            return;
+        }
+
+        const Bc7Mode& m = kBc7Modes[mode];
+        BlockBits bits(block);
+        bits.read(mode + 1);
+        unsigned partition = bits.read(m.partitionBits);
+        unsigned rotation = bits.read(m.rotationBits);
+        unsigned indexSelection = bits.read(m.indexSelectionBits);
+
+        // Endpoints are stored channel by channel: every R, then every G, B and A.
+        const unsigned endpointCount = m.subsets * 2u;
+        uint8_t endpoints[6][4] = {};
+        for (unsigned c = 0; c < 3; ++c) {
+            for (unsigned e = 0; e < endpointCount; ++e) endpoints[e][c] = static_cast<uint8_t>(bits.read(m.colorBits));
+        }
+        for (unsigned e = 0; e < endpointCount && m.alphaBits; ++e) {
+            endpoints[e][3] = static_cast<uint8_t>(bits.read(m.alphaBits));
+        }
+
+        unsigned colorPrecision = m.colorBits;
+        unsigned alphaPrecision = m.alphaBits;
+        if (m.endpointPBits || m.sharedPBits) {
+            uint32_t pBits[6];
+            if (m.endpointPBits) {
+                for (unsigned e = 0; e < endpointCount; ++e) pBits[e] = bits.read(1);
+            }
+            else {
+                for (unsigned s = 0; s < m.subsets; ++s) pBits[2 * s] = pBits[2 * s + 1] = bits.read(1);
+            }
+            for (unsigned e = 0; e < endpointCount; ++e) {
+                for (unsigned c = 0; c < 4; ++c) endpoints[e][c] = static_cast<uint8_t>((endpoints[e][c] << 1) | pBits[e]);
+            }
+            ++colorPrecision;
+            if (alphaPrecision) ++alphaPrecision;
+        }
+
+        auto expand = [](unsigned value, unsigned precision) {
+            value <<= (8 - precision);
+            return static_cast<uint8_t>(value | (value >> precision));
+        };
+        for (unsigned e = 0; e < endpointCount; ++e) {
+            for (unsigned c = 0; c < 3; ++c) endpoints[e][c] = expand(endpoints[e][c], colorPrecision);
+            endpoints[e][3] = alphaPrecision ? expand(endpoints[e][3], alphaPrecision) : 255;
+        }
+
+        uint8_t subsetOf[16] = {};
+        unsigned anchors[3] = { 0, 0, 0 };
+        if (m.subsets == 2) {
+            for (int p = 0; p < 16; ++p) subsetOf[p] = static_cast<uint8_t>((kBc7Partitions2[partition] >> p) & 1);
+            anchors[1] = kBc7Anchor2[partition];
+        }
+        else if (m.subsets == 3) {
+            std::memcpy(subsetOf, kBc7Partitions3[partition], 16);
+            anchors[1] = kBc7Anchor3a[partition];
+            anchors[2] = kBc7Anchor3b[partition];
+        }
+
+        uint8_t indices[16], indices2[16] = {};
+        for (unsigned p = 0; p < 16; ++p) {
+            bool anchor = p == anchors[subsetOf[p]];
+            indices[p] = static_cast<uint8_t>(bits.read(m.indexBits - (anchor ? 1 : 0)));
+        }
+        for (unsigned p = 0; p < 16 && m.indexBits2; ++p) {
+            indices2[p] = static_cast<uint8_t>(bits.read(m.indexBits2 - (p == 0 ? 1 : 0)));
+        }
+
+        // Modes 4 and 5 carry separate colour and alpha indices; mode 4's selection bit swaps them.
+        unsigned colorIndexBits = m.indexBits, alphaIndexBits = m.indexBits2 ? m.indexBits2 : m.indexBits;
+        const uint8_t* colorIndices = indices;
+        const uint8_t* alphaIndices = m.indexBits2 ? indices2 : indices;
+        if (indexSelection) {
+            std::swap(colorIndexBits, alphaIndexBits);
+            std::swap(colorIndices, alphaIndices);
+        }
+        const uint8_t* colorWeights = bc7Weights(colorIndexBits);
+        const uint8_t* alphaWeights = bc7Weights(alphaIndexBits);
+
+        for (unsigned p = 0; p < 16; ++p) {
+            const uint8_t* e0 = endpoints[2 * subsetOf[p]];
+            const uint8_t* e1 = endpoints[2 * subsetOf[p] + 1];
+            uint8_t* pixel = dst + (p >> 2) * pitch + (p & 3) * 4;
+            unsigned colorWeight = colorWeights[colorIndices[p]];
+            for (unsigned c = 0; c < 3; ++c) pixel[c] = bc7Interpolate(e0[c], e1[c], colorWeight);
+            pixel[3] = bc7Interpolate(e0[3], e1[3], alphaWeights[alphaIndices[p]]);
+            if (rotation) std::swap(pixel[3], pixel[rotation - 1]);
+        }
+    }
+
+#if BCN_X86
+    // --- SIMD kernels ---
+    // These reuse the scalar palettes and replace the per-pixel index extraction, palette
+    // lookups and channel interleaving with shifts and byte shuffles, so they match the scalar
+    // output exactly.
+
+    // pshufb masks shared by the SIMD kernels:
+    //  - colorMasks[b] gathers the four RGBA palette entries selected by a byte of four 2-bit
+    //    colour indices;
+    //  - channelMasks[row][channel] moves the four values of a row (bytes 4*row .. 4*row+3 of a
+    //    16-value vector) into byte 'channel' of each RGBA pixel and zeroes the other bytes.
+    struct ShuffleTables {
+        alignas(16) uint8_t colorMasks[256][16];
+        alignas(16) uint8_t channelMasks[4][4][16];
+        ShuffleTables() {
+            for (int b = 0; b < 256; ++b) {
+                for (int i = 0; i < 16; ++i) colorMasks[b][i] = static_cast<uint8_t>(((b >> (2 * (i >> 2))) & 3) * 4 + (i & 3));
+            }
+            for (int row = 0; row < 4; ++row) {
+                for (int channel = 0; channel < 4; ++channel) {
+                    for (int i = 0; i < 16; ++i) {
+                        channelMasks[row][channel][i] = (i & 3) == channel ? static_cast<uint8_t>(row * 4 + (i >> 2)) : 0x80;
+                    }
+                }
+            }
+        }
+    };
+
+    const ShuffleTables& shuffleTables() {
+        static const ShuffleTables tables;
+        return tables;
+    }
+
+    BCN_TARGET_SSE41 __m128i channelRowMask(int row, int channel) {
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleTables().channelMasks[row][channel]));
+    }
+
+    BCN_TARGET_SSE41 __m128i channelPaletteSSE41(const uint8_t* block) {
+        uint8_t palette[8];
+        channelPalette(block, palette);
+        return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(palette));
+    }
+
+    // The 16 3-bit indices of a channel block ('bits' holds the block's 8 bytes), one per byte.
+    // Each index is at most 7 bits into a 16-bit word starting at byte 2 + 3p/8, so a shuffle
+    // gathers that word for every pixel and a multiply by 2^(7 - shift) lines the index up at
+    // bit 7 of every lane (SSE has no per-lane variable shift).
+    BCN_TARGET_SSE41 __m128i channelIndicesSSE41(__m128i bits) {
+        const __m128i low = _mm_shuffle_epi8(bits, _mm_setr_epi8(2, 3, 2, 3, 2, 3, 3, 4, 3, 4, 3, 4, 4, 5, 4, 5));
+        const __m128i high = _mm_shuffle_epi8(bits, _mm_setr_epi8(5, 6, 5, 6, 5, 6, 6, 7, 6, 7, 6, 7, 7, -128, 7, -128));
+        const __m128i scale = _mm_setr_epi16(128, 16, 2, 64, 8, 1, 32, 4);
+        const __m128i mask = _mm_set1_epi16(7);
+        return _mm_packus_epi16(_mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(low, scale), 7), mask),
+            _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(high, scale), 7), mask));
+    }
+
+    BCN_TARGET_SSE41 __m128i channelValuesSSE41(const uint8_t* block) {
+        const __m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block));
+        return _mm_shuffle_epi8(channelPaletteSSE41(block), channelIndicesSSE41(bits));
+    }
+
+    // BC2's explicit alpha: 16 4-bit values, low nibble first, scaled to 0-255 by x * 17.
+    BCN_TARGET_SSE41 __m128i explicitAlphaSSE41(const uint8_t* block) {
+        const __m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block));
+        const __m128i nibble = _mm_set1_epi8(15);
+        const __m128i values = _mm_unpacklo_epi8(_mm_and_si128(bits, nibble), _mm_and_si128(_mm_srli_epi16(bits, 4), nibble));
+        return _mm_or_si128(values, _mm_slli_epi16(values, 4));
+    }
+
+    BCN_TARGET_SSE41 __m128i colorRowSSE41(__m128i palette, uint32_t indices, int row) {
+        const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleTables().colorMasks[(indices >> (8 * row)) & 0xFF]));
+        return _mm_shuffle_epi8(palette, mask);
+    }
+
+    BCN_TARGET_SSE41 void decodeColorSSE41(const uint8_t* block, bool allowPunchThrough, const __m128i* alpha, uint8_t* dst, size_t pitch) {
+        alignas(16) uint8_t palette[16];
+        colorPalette(block, allowPunchThrough, palette);
+        const __m128i pal = _mm_load_si128(reinterpret_cast<const __m128i*>(palette));
+        const __m128i alphaLanes = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        uint32_t indices = load32(block + 4);
+        for (int row = 0; row < 4; ++row) {
+            __m128i pixels = colorRowSSE41(pal, indices, row);
+            if (alpha) {
+                pixels = _mm_blendv_epi8(pixels, _mm_shuffle_epi8(*alpha, channelRowMask(row, 3)), alphaLanes);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + row * pitch), pixels);
+        }
+    }
+
+    BCN_TARGET_SSE41 void decodeBC1SSE41(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        decodeColorSSE41(block, true, nullptr, dst, pitch);
+    }
+
+    BCN_TARGET_SSE41 void decodeBC2SSE41(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        const __m128i alpha = explicitAlphaSSE41(block);
+        decodeColorSSE41(block + 8, false, &alpha, dst, pitch);
+    }
+
+    BCN_TARGET_SSE41 void decodeBC3SSE41(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        const __m128i alpha = channelValuesSSE41(block);
+        decodeColorSSE41(block + 8, false, &alpha, dst, pitch);
+    }
+
+    BCN_TARGET_SSE41 void decodeBC4SSE41(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        const __m128i red = channelValuesSSE41(block);
+        const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        for (int row = 0; row < 4; ++row) {
+            __m128i pixels = _mm_or_si128(_mm_shuffle_epi8(red, channelRowMask(row, 0)), opaque);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + row * pitch), pixels);
+        }
+    }
+
+    BCN_TARGET_SSE41 void decodeBC5SSE41(const uint8_t* block, uint8_t* dst, size_t pitch) {
+        const __m128i red = channelValuesSSE41(block);
+        const __m128i green = channelValuesSSE41(block + 8);
+        const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        for (int row = 0; row < 4; ++row) {
+            __m128i pixels = _mm_or_si128(_mm_shuffle_epi8(red, channelRowMask(row, 0)), _mm_shuffle_epi8(green, channelRowMask(row, 1)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + row * pitch), _mm_or_si128(pixels, opaque));
+        }
+    }
+
+    // The AVX2 kernels decode two neighbouring blocks at once: block A in the low 128-bit lane,
+    // block B in the high lane. Since pshufb works per lane, each lane shuffles its own palette,
+    // and a row of both blocks is one contiguous 32-byte store.
+
+    BCN_TARGET_AVX2 __m256i combineLanes(__m128i low, __m128i high) {
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+    }
+
+    BCN_TARGET_AVX2 __m256i channelRowMask2(int row, int channel) {
+        return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(shuffleTables().channelMasks[row][channel])));
+    }
+
+    BCN_TARGET_AVX2 __m256i channelValuesPairAVX2(const uint8_t* blockA, const uint8_t* blockB) {
+        const __m256i bits = combineLanes(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(blockA)),
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(blockB)));
+        const __m256i low = _mm256_shuffle_epi8(bits, _mm256_setr_epi8(2, 3, 2, 3, 2, 3, 3, 4, 3, 4, 3, 4, 4, 5, 4, 5,
+            2, 3, 2, 3, 2, 3, 3, 4, 3, 4, 3, 4, 4, 5, 4, 5));
+        const __m256i high = _mm256_shuffle_epi8(bits, _mm256_setr_epi8(5, 6, 5, 6, 5, 6, 6, 7, 6, 7, 6, 7, 7, -128, 7, -128,
+            5, 6, 5, 6, 5, 6, 6, 7, 6, 7, 6, 7, 7, -128, 7, -128));
+        const __m256i scale = _mm256_setr_epi16(128, 16, 2, 64, 8, 1, 32, 4, 128, 16, 2, 64, 8, 1, 32, 4);
+        const __m256i mask = _mm256_set1_epi16(7);
+        const __m256i indices = _mm256_packus_epi16(_mm256_and_si256(_mm256_srli_epi16(_mm256_mullo_epi16(low, scale), 7), mask),
+            _mm256_and_si256(_mm256_srli_epi16(_mm256_mullo_epi16(high, scale), 7), mask));
+        return _mm256_shuffle_epi8(combineLanes(channelPaletteSSE41(blockA), channelPaletteSSE41(blockB)), indices);
+    }
+
+    BCN_TARGET_AVX2 __m256i explicitAlphaPairAVX2(const uint8_t* blockA, const uint8_t* blockB) {
+        return combineLanes(explicitAlphaSSE41(blockA), explicitAlphaSSE41(blockB));
+    }
+
+    BCN_TARGET_AVX2 void decodeColorPairAVX2(const uint8_t* blockA, const uint8_t* blockB, bool allowPunchThrough, const __m256i* alpha, uint8_t* dst, size_t pitch) {
+        alignas(32) uint8_t palettes[32];
+        colorPalette(blockA, allowPunchThrough, palettes);
+        colorPalette(blockB, allowPunchThrough, palettes + 16);
+        const __m256i pal = _mm256_load_si256(reinterpret_cast<const __m256i*>(palettes));
+        const __m256i alphaLanes = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        const ShuffleTables& tables = shuffleTables();
+        uint32_t indicesA = load32(blockA + 4), indicesB = load32(blockB + 4);
+        for (int row = 0; row < 4; ++row) {
+            __m256i mask = combineLanes(
+                _mm_load_si128(reinterpret_cast<const __m128i*>(tables.colorMasks[(indicesA >> (8 * row)) & 0xFF])),
+                _mm_load_si128(reinterpret_cast<const __m128i*>(tables.colorMasks[(indicesB >> (8 * row)) & 0xFF])));
+            __m256i pixels = _mm256_shuffle_epi8(pal, mask);
+            if (alpha) {
+                pixels = _mm256_blendv_epi8(pixels, _mm256_shuffle_epi8(*alpha, channelRowMask2(row, 3)), alphaLanes);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + row * pitch), pixels);
+        }
+    }
+
+    BCN_TARGET_AVX2 void decodeBC1PairAVX2(const uint8_t* blocks, uint8_t* dst, size_t pitch) {
+        decodeColorPairAVX2(blocks, blocks + 8, true, nullptr, dst, pitch);
+    }
+
+    BCN_TARGET_AVX2 void decodeBC2PairAVX2(const uint8_t* blocks, uint8_t* dst, size_t pitch) {
+        const __m256i alpha = explicitAlphaPairAVX2(blocks, blocks + 16);
+        decodeColorPairAVX2(blocks + 8, blocks + 24, false, &alpha, dst, pitch);
+    }
+
+    BCN_TARGET_AVX2 void decodeBC3PairAVX2(const uint8_t* blocks, uint8_t* dst, size_t pitch) {
+        const __m256i alpha = channelValuesPairAVX2(blocks, blocks + 16);
+        decodeColorPairAVX2(blocks + 8, blocks + 24, false, &alpha, dst, pitch);
+    }
+
+    BCN_TARGET_AVX2 void decodeBC4PairAVX2(const uint8_t* blocks, uint8_t* dst, size_t pitch) {
+        const __m256i red = channelValuesPairAVX2(blocks, blocks + 8);
+        const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        for (int row = 0; row < 4; ++row) {
+            __m256i pixels = _mm256_or_si256(_mm256_shuffle_epi8(red, channelRowMask2(row, 0)), opaque);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + row * pitch), pixels);
+        }
+    }
+
+    BCN_TARGET_AVX2 void decodeBC5PairAVX2(const uint8_t* blocks, uint8_t* dst, size_t pitch) {
+        const __m256i red = channelValuesPairAVX2(blocks, blocks + 16);
+        const __m256i green = channelValuesPairAVX2(blocks + 8, blocks + 24);
+        const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        for (int row = 0; row < 4; ++row) {
+            __m256i pixels = _mm256_or_si256(_mm256_shuffle_epi8(red, channelRowMask2(row, 0)), _mm256_shuffle_epi8(green, channelRowMask2(row, 1)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + row * pitch), _mm256_or_si256(pixels, opaque));
+        }
+    }
+#endif
+
+    Kernels kernelsFor(Format format, Backend backend) {
+        Kernels k;
+        switch (format) {
+        case Format::BC1: k.single = decodeBC1Scalar; break;
+        case Format::BC2: k.single = decodeBC2Scalar; break;
+        case Format::BC3: k.single = decodeBC3Scalar; break;
+        case Format::BC4: k.single = decodeBC4Scalar; break;
+        case Format::BC5: k.single = decodeBC5Scalar; break;
+        case Format::BC7: k.single = decodeBC7Scalar; break;
+        }
+#if BCN_X86
+        if (backend == Backend::SSE41 || backend == Backend::AVX2) {
+            switch (format) {
+            case Format::BC1: k.single = decodeBC1SSE41; break;
+            case Format::BC2: k.single = decodeBC2SSE41; break;
+            case Format::BC3: k.single = decodeBC3SSE41; break;
+            case Format::BC4: k.single = decodeBC4SSE41; break;
+            case Format::BC5: k.single = decodeBC5SSE41; break;
+            default: break;
+            }
+        }
+        if (backend == Backend::AVX2) {
+            switch (format) {
+            case Format::BC1: k.pair = decodeBC1PairAVX2; break;
+            case Format::BC2: k.pair = decodeBC2PairAVX2; break;
+            case Format::BC3: k.pair = decodeBC3PairAVX2; break;
+            case Format::BC4: k.pair = decodeBC4PairAVX2; break;
+            case Format::BC5: k.pair = decodeBC5PairAVX2; break;
+            default: break;
+            }
+        }
+#else
+        (void)backend;
+#endif
+        return k;
+    }
+
+    Backend detectBackend() {
+#if BCN_X86
+        const CpuFeatures& cpu = DetectedCpuFeatures();
+        if (cpu.avx2) return Backend::AVX2;
+        if (cpu.sse41) return Backend::SSE41;
+#endif
+        return Backend::Scalar;
+    }
+
+}
+
+size_t blockBytes(Format format) {
+    return (format == Format::BC1 || format == Format::BC4) ? 8 : 16;
+}
+
+const char* formatName(Format format) {
+    switch (format) {
+    case Format::BC1: return "BC1";
+    case Format::BC2: return "BC2";
+    case Format::BC3: return "BC3";
+    case Format::BC4: return "BC4";
+    case Format::BC5: return "BC5";
+    case Format::BC7: return "BC7";
+    }
+    return "?";
+}
+
+const char* backendName(Backend backend) {
+    switch (backend) {
+    case Backend::Scalar: return "scalar";
+    case Backend::SSE41: return "SSE4.1";
+    case Backend::AVX2: return "AVX2";
+    }
+    return "?";
+}
+
+Backend bestBackend() {
+    static const Backend backend = detectBackend();
+    return backend;
+}
+
+Backend kernelBackend(Format format, Backend backend) {
+    const Kernels kernels = kernelsFor(format, backend);
+    while (backend != Backend::Scalar) {
+        const Backend lower = static_cast<Backend>(static_cast<int>(backend) - 1);
+        const Kernels fallback = kernelsFor(format, lower);
+        if (kernels.single != fallback.single || kernels.pair != fallback.pair) break;
+        backend = lower;
+    }
+    return backend;
+}
+
+void decode(Format format, const void* src, uint32_t width, uint32_t height, uint8_t* dst) {
+    decode(format, src, width, height, dst, bestBackend());
+}
+
+void decode(Format format, const void* src, uint32_t width, uint32_t height, uint8_t* dst, Backend backend) {
+    const Kernels kernels = kernelsFor(format, backend);
+    const size_t blockSize = blockBytes(format);
+    const uint32_t blocksWide = (width + 3) / 4;
+    const uint32_t blocksHigh = (height + 3) / 4;
+    const size_t pitch = size_t(width) * 4;
+    const uint8_t* blocks = static_cast<const uint8_t*>(src);
+
+    for (uint32_t by = 0; by < blocksHigh; ++by) {
+        const uint8_t* blockRow = blocks + size_t(by) * blocksWide * blockSize;
+        uint8_t* dstRow = dst + size_t(by) * 4 * pitch;
+        const uint32_t rows = std::min<uint32_t>(4, height - by * 4);
+
+        uint32_t bx = 0;
+        while (bx < blocksWide) {
+            const uint32_t x = bx * 4;
+            const uint8_t* block = blockRow + size_t(bx) * blockSize;
+            if (rows == 4 && kernels.pair && bx + 1 < blocksWide && x + 8 <= width) {
+                kernels.pair(block, dstRow + size_t(x) * 4, pitch);
+                bx += 2;
+                continue;
+            }
+            if (rows == 4 && x + 4 <= width) {
+                kernels.single(block, dstRow + size_t(x) * 4, pitch);
+                ++bx;
+                continue;
+            }
+
+            // Partial block at the right or bottom edge (or a mip smaller than 4x4).
+            uint8_t scratch[64];
+            kernels.single(block, scratch, 16);
+            const uint32_t columns = std::min<uint32_t>(4, width - x);
+            for (uint32_t row = 0; row < rows; ++row) {
+                std::memcpy(dstRow + row * pitch + size_t(x) * 4, scratch + row * 16, columns * 4);
+            }
+            ++bx;
+        }
+    }
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CPU decoder for the block-compressed texture formats used by Skyrim assets.
+//
+// Used when the GL driver can't sample a format itself (BC7 on some software stacks) and by
+// anything that needs the pixels on the CPU. Every format has a scalar reference path; BC1-BC5
+// also have SSE4.1 and AVX2 paths that must produce bit-identical output, selected at runtime
+// from the CPU's capabilities. BC7 always runs the scalar path.
+namespace Bcn {
+
+    enum class Format { BC1, BC2, BC3, BC4, BC5, BC7 };
+    enum class Backend { Scalar, SSE41, AVX2 };
+
+    size_t blockBytes(Format format);
+    const char* formatName(Format format);
+    const char* backendName(Backend backend);
+
+    // The fastest backend this CPU supports (detected once).
+    Backend bestBackend();
+
+    // The backend whose kernels decode() runs when asked for 'backend': the highest one at or
+    // below it with its own kernels for 'format' (always Scalar for BC7).
+    Backend kernelBackend(Format format, Backend backend);
+
+    // Decodes a width x height image stored as whole 4x4 blocks in 'src' to tightly packed
+    // RGBA8 in 'dst' (width * height * 4 bytes). Channels a format doesn't store are filled the
+    // way GL samples them: BC4 gives (r, 0, 0, 255), BC5 gives (r, g, 0, 255).
+    void decode(Format format, const void* src, uint32_t width, uint32_t height, uint8_t* dst);
+    void decode(Format format, const void* src, uint32_t width, uint32_t height, uint8_t* dst, Backend backend);
+
+}
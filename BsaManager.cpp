@@ -6,10 +6,60 @@
 #include <unordered_set>    // For std::unordered_set
 #include <stdexcept> 
 #include <functional>   // Add this for std::hash
+#include <mutex>
 
 // Include the correct C++ wrapper header for reading archives
 #include <bs_archive.h>
 
+struct BsaManager::ArchiveHandle {
+    std::filesystem::path path;
+    std::string filename;
+    uint64_t fingerprint = 0;
+    // libbsarch archives are not safe to use from several threads at once.
+    std::mutex mutex;
+    std::unique_ptr<libbsarch::bs_archive> archive;
+
+    // Opens the archive on first use and keeps it open, instead of re-reading its
+    // header and file table on every extraction. Throws on failure, like libbsarch.
+    std::vector<char> extract(const std::string& extractionPath) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!archive) {
+            auto opened = std::make_unique<libbsarch::bs_archive>();
+            opened->load_from_disk(path.wstring());
+            archive = std::move(opened);
+        }
+        // The blob is freed through the archive, so it must not outlive the lock.
+        libbsarch::memory_blob blob = archive->extract_to_memory(extractionPath);
+        const char* data = static_cast<const char*>(blob.data);
+        return std::vector<char>(data, data + blob.size);
+    }
+};
+
+namespace {
+    uint64_t fingerprintArchive(const std::filesystem::path& path) {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(path, ec);
+        auto writeTime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+
+        uint64_t h = 14695981039346656037ull;
+        auto mix = [&h](uint64_t value) {
+            for (int i = 0; i < 8; ++i) h = (h ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ull;
+        };
+        for (char c : path.filename().string()) {
+            h = (h ^ static_cast<unsigned char>(::tolower(static_cast<unsigned char>(c)))) * 1099511628211ull;
+        }
+        mix(size);
+        mix(static_cast<uint64_t>(writeTime));
+        return h;
+    }
+
+    std::string toExtractionPath(const PathKey& internalPath) {
+        std::string extractionPath = internalPath.str();
+        std::replace(extractionPath.begin(), extractionPath.end(), '\\', '/');
+        return extractionPath;
+    }
+}
+
 std::string sanitizePathForFilename(const std::string& path) {
     std::string sanitized = path;
     // Replace characters that are invalid in filenames
@@ -25,28 +75,25 @@ std::string sanitizePathForFilename(const std::string& path) {
     return sanitized;
 }
 
-void BsaManager::saveCache() {
+void BsaManager::saveCache(const Index& index) const {
     std::cout << "--- Saving BSA contents to cache: " << cacheFilePath.string() << " ---" << std::endl;
     try {
         // --- FIX: Group files by their source BSA for a more organized cache file ---
         nlohmann::json archivesJson;
         std::map<std::string, std::vector<std::string>> groupedFiles;
 
-        // Combine all flat maps into one for easier processing
-        std::unordered_map<std::string, std::string> combined = anyCache;
-        combined.insert(texturesCache.begin(), texturesCache.end());
-        combined.insert(meshesCache.begin(), meshesCache.end());
-
         // Group file paths by their BSA name
-        for (const auto& [filePath, bsaName] : combined) {
-            groupedFiles[bsaName].push_back(filePath);
+        for (const auto* cache : { &index.anyCache, &index.texturesCache, &index.meshesCache }) {
+            for (const auto& [filePath, archive] : *cache) {
+                groupedFiles[index.archives[archive]->filename].push_back(filePath.str());
+            }
         }
         archivesJson = groupedFiles;
 
         nlohmann::json metadata;
         std::vector<std::string> sourceBsaNames;
-        for (const auto& p : bsaPaths) {
-            sourceBsaNames.push_back(p.filename().string());
+        for (const auto& archive : index.archives) {
+            sourceBsaNames.push_back(archive->filename);
         }
         std::sort(sourceBsaNames.begin(), sourceBsaNames.end());
         metadata["sources"] = sourceBsaNames;
@@ -64,7 +111,7 @@ void BsaManager::saveCache() {
     }
 }
 
-bool BsaManager::loadCache(const std::string& bsa_directory) {
+bool BsaManager::loadCache(const std::string& bsa_directory, Index& index) const {
     if (!std::filesystem::exists(cacheFilePath)) {
         return false;
     }
@@ -100,34 +147,30 @@ bool BsaManager::loadCache(const std::string& bsa_directory) {
         // --- Cache is valid, proceed with loading ---
         std::cout << "--- Loading BSA contents from valid cache: " << cacheFilePath.string() << " ---" << std::endl;
 
-        anyCache.clear();
-        texturesCache.clear();
-        meshesCache.clear();
-        bsaPaths.clear();
+        // Populate the archive list from the validated diskBsaNames list
+        std::unordered_map<std::string, uint32_t> archiveByName;
+        for (const auto& bsaName : diskBsaNames) {
+            auto handle = std::make_shared<ArchiveHandle>();
+            handle->path = std::filesystem::path(bsa_directory) / bsaName;
+            handle->filename = bsaName;
+            handle->fingerprint = fingerprintArchive(handle->path);
+            archiveByName[bsaName] = static_cast<uint32_t>(index.archives.size());
+            index.archives.push_back(std::move(handle));
+        }
 
         // --- FIX: Parse the grouped archive structure and repopulate the flat in-memory maps ---
         const auto& archivesData = data["archives"];
         for (const auto& [bsaName, fileList] : archivesData.items()) {
+            auto archiveIt = archiveByName.find(bsaName);
+            if (archiveIt == archiveByName.end()) {
+                continue;
+            }
             for (const auto& filePathJson : fileList) {
-                std::string filePath = filePathJson.get<std::string>();
                 // Route to the correct in-memory cache for fast lookups
-                if (filePath.rfind("textures\\", 0) == 0) {
-                    texturesCache[filePath] = bsaName;
-                }
-                else if (filePath.rfind("meshes\\", 0) == 0) {
-                    meshesCache[filePath] = bsaName;
-                }
-                else {
-                    anyCache[filePath] = bsaName;
-                }
+                index.add(PathKey(filePathJson.get<std::string>()), archiveIt->second);
             }
         }
 
-        // Populate bsaPaths from the validated diskBsaNames list
-        for (const auto& bsaName : diskBsaNames) {
-            bsaPaths.push_back(std::filesystem::path(bsa_directory) / bsaName);
-        }
-
         std::cout << "--- BSA Cache Loaded Successfully ---" << std::endl;
         return true;
 
@@ -157,16 +200,15 @@ void BsaManager::loadArchives(const std::string& directory, const std::filesyste
     std::string cacheFilename = sanitizedDir + ".json";
     cacheFilePath = cacheSubfolder / cacheFilename;
 
-    if (loadCache(directory)) {
+    auto newIndex = std::make_shared<Index>();
+    if (loadCache(directory, *newIndex)) {
+        std::atomic_store(&index, std::shared_ptr<const Index>(std::move(newIndex)));
         return;
     }
-
-    bsaPaths.clear();
-    anyCache.clear();
-    texturesCache.clear();
-    meshesCache.clear();
+    newIndex = std::make_shared<Index>();
 
     try {
+        std::vector<std::filesystem::path> bsaPaths;
         for (const auto& entry : std::filesystem::directory_iterator(directory)) {
             if (entry.is_regular_file()) {
                 std::string extension = entry.path().extension().string();
@@ -178,50 +220,56 @@ void BsaManager::loadArchives(const std::string& directory, const std::filesyste
         }
         std::sort(bsaPaths.begin(), bsaPaths.end());
 
-        std::cout << "--- Caching BSA contents from: " << directory << " ---" << std::endl;
         for (const auto& bsaPath : bsaPaths) {
+            auto handle = std::make_shared<ArchiveHandle>();
+            handle->path = bsaPath;
+            handle->filename = bsaPath.filename().string();
+            handle->fingerprint = fingerprintArchive(bsaPath);
+            newIndex->archives.push_back(std::move(handle));
+        }
+
+        std::cout << "--- Caching BSA contents from: " << directory << " ---" << std::endl;
+        for (uint32_t archiveSlot = 0; archiveSlot < bsaPaths.size(); ++archiveSlot) {
+            ArchiveHandle& handle = *newIndex->archives[archiveSlot];
+            const auto& bsaPath = handle.path;
             try {
-                libbsarch::bs_archive bsa;
-                bsa.load_from_disk(bsaPath.wstring());
-                const std::string bsaFilename = bsaPath.filename().string();
+                // Keep the archive open; the index is not shared yet, so no lock is needed.
+                handle.archive = std::make_unique<libbsarch::bs_archive>();
+                handle.archive->load_from_disk(bsaPath.wstring());
+                const std::string& bsaFilename = handle.filename;
 
-                for (const auto& file : bsa.list_files()) {
-                    std::string filePath = normalizePath(std::string(file));
+                for (const auto& file : handle.archive->list_files()) {
+                    PathKey internalPath{ std::string(file) };
+                    std::string_view filePath = internalPath.view();
 
                     // --- LOGGING RESTORED AND ENABLED ---
                     bool showDebug = true;
                     if (showDebug &&
-                        filePath.find("texture") != std::string::npos &&
-                        filePath.find("terrain") == std::string::npos &&
-                        filePath.find("clutter") == std::string::npos &&
-                        filePath.find("architecture") == std::string::npos &&
-                        filePath.find("weapons") == std::string::npos &&
-                        filePath.find("armor") == std::string::npos &&
-                        filePath.find("clothes") == std::string::npos &&
-                        filePath.find("landscape") == std::string::npos &&
-                        filePath.find("dungeon") == std::string::npos &&
-                        filePath.find("effects") == std::string::npos)
+                        filePath.find("texture") != std::string_view::npos &&
+                        filePath.find("terrain") == std::string_view::npos &&
+                        filePath.find("clutter") == std::string_view::npos &&
+                        filePath.find("architecture") == std::string_view::npos &&
+                        filePath.find("weapons") == std::string_view::npos &&
+                        filePath.find("armor") == std::string_view::npos &&
+                        filePath.find("clothes") == std::string_view::npos &&
+                        filePath.find("landscape") == std::string_view::npos &&
+                        filePath.find("dungeon") == std::string_view::npos &&
+                        filePath.find("effects") == std::string_view::npos)
                     {
                         std::cout << "[" << bsaFilename << "]: " << filePath << std::endl;
                     }
 
-                    if (filePath.rfind("textures\\", 0) == 0) {
-                        texturesCache[filePath] = bsaFilename;
-                    }
-                    else if (filePath.rfind("meshes\\", 0) == 0) {
-                        meshesCache[filePath] = bsaFilename;
-                    }
-                    else {
-                        anyCache[filePath] = bsaFilename;
-                    }
+                    newIndex->add(internalPath, archiveSlot);
                 }
             }
             catch (const std::exception& e) {
+                handle.archive.reset(); // Retried on first extraction.
                 std::cerr << "Error processing BSA " << bsaPath.string() << ": " << e.what() << std::endl;
             }
         }
 
-        saveCache();
+        saveCache(*newIndex);
+        std::atomic_store(&index, std::shared_ptr<const Index>(std::move(newIndex)));
         std::cout << "--- BSA Caching Complete ---" << std::endl;
     }
     catch (const std::filesystem::filesystem_error& e) {
@@ -231,23 +279,19 @@ void BsaManager::loadArchives(const std::string& directory, const std::filesyste
 
 
 // New helper to search all loaded BSAs directly, used as a fallback.
-std::vector<char> BsaManager::findAndExtractDirectly(const std::string& internalPath, const std::filesystem::path& bsaToExclude) const {
-    std::string extractionPath = internalPath;
-    std::replace(extractionPath.begin(), extractionPath.end(), '\\', '/');
+std::vector<char> BsaManager::findAndExtractDirectly(const Index& index, const PathKey& internalPath, const ArchiveHandle* bsaToExclude) const {
+    const std::string extractionPath = toExtractionPath(internalPath);
 
-    for (const auto& bsaPath : bsaPaths) {
-        if (!bsaToExclude.empty() && bsaPath == bsaToExclude) {
+    for (const auto& archive : index.archives) {
+        if (archive.get() == bsaToExclude) {
             continue; // Skip the BSA that we already know failed
         }
         try {
-            libbsarch::bs_archive bsa;
-            bsa.load_from_disk(bsaPath.wstring());
             // The check for existence is simply trying to extract it.
-            libbsarch::memory_blob blob = bsa.extract_to_memory(extractionPath);
-            const char* data = static_cast<const char*>(blob.data);
-            std::cout << "Fallback success: Found '" << internalPath << "' in '" << bsaPath.filename().string() << "'" << std::endl;
+            std::vector<char> fileData = archive->extract(extractionPath);
+            std::cout << "Fallback success: Found '" << internalPath.view() << "' in '" << archive->filename << "'" << std::endl;
             // A full cache rebuild upon next run will fix this permanently.
-            return std::vector<char>(data, data + blob.size);
+            return fileData;
         }
         catch (const std::runtime_error&) { // This is the correct type
             // Expected when a file isn't in this BSA, so we silently continue.
@@ -261,110 +305,105 @@ std::vector<char> BsaManager::findAndExtractDirectly(const std::string& internal
 }
 
 
+std::shared_ptr<const BsaManager::Index> BsaManager::currentIndex() const {
+    return std::atomic_load(&index);
+}
+
 size_t BsaManager::getArchiveCount() const {
-    return bsaPaths.size();
+    auto snapshot = currentIndex();
+    return snapshot ? snapshot->archives.size() : 0;
 }
 
-std::string BsaManager::findFileInArchives(const std::string& relativePath) const {
-    if (relativePath.empty()) {
-        return "";
+std::vector<PathKey> BsaManager::listFiles(size_t maxCount) const {
+    std::vector<PathKey> files;
+    auto snapshot = currentIndex();
+    if (!snapshot) {
+        return files;
+    }
+    // An even share from meshes, textures and everything else, so the sample mixes file types.
+    const size_t share = (maxCount + 2) / 3;
+    for (const auto* cache : { &snapshot->meshesCache, &snapshot->texturesCache, &snapshot->anyCache }) {
+        size_t taken = 0;
+        for (auto it = cache->begin(); it != cache->end() && taken < share && files.size() < maxCount; ++it, ++taken) {
+            files.push_back(it->first);
+        }
     }
+    return files;
+}
 
-    std::string internalPath = normalizePath(relativePath);
+void BsaManager::Index::add(const PathKey& internalPath, uint32_t archive) {
+    switch (internalPath.root()) {
+    case PathKey::Root::Textures: texturesCache[internalPath] = archive; break;
+    case PathKey::Root::Meshes: meshesCache[internalPath] = archive; break;
+    default: anyCache[internalPath] = archive; break;
+    }
+}
 
-    // If the caller is asking for a texture, only consult the Textures cache.
-    if (internalPath.rfind("textures\\", 0) == 0) {
-        if (auto it = texturesCache.find(internalPath); it != texturesCache.end()) {
-            return it->second;
-        }
-        return "";
+const std::unordered_map<PathKey, uint32_t>& BsaManager::Index::cacheFor(PathKey::Root root) const {
+    switch (root) {
+    case PathKey::Root::Textures: return texturesCache;
+    case PathKey::Root::Meshes: return meshesCache;
+    default: return anyCache;
     }
-    // If the caller is asking for a mesh, only consult the Meshes cache.
-    if (internalPath.rfind("meshes\\", 0) == 0) {
-        if (auto it = meshesCache.find(internalPath); it != meshesCache.end()) {
-            return it->second;
-        }
-        return "";
+}
+
+BsaManager::ArchiveHandle* BsaManager::Index::find(const PathKey& internalPath) const {
+    // Textures only consult the Textures cache and meshes only the Meshes cache;
+    // anything else falls back to the general cache (non-standard top-level folders).
+    const auto& cache = cacheFor(internalPath.root());
+    if (auto it = cache.find(internalPath); it != cache.end()) {
+        return archives[it->second].get();
     }
-    // Otherwise, fall back to the general cache (non-standard top-level folders).
-    if (auto it = anyCache.find(internalPath); it != anyCache.end()) {
-        return it->second;
+    return nullptr;
+}
+
+std::string BsaManager::findFileInArchives(const PathKey& internalPath) const {
+    auto snapshot = currentIndex();
+    if (internalPath.empty() || !snapshot) {
+        return "";
     }
 
-    return "";
+    const ArchiveHandle* archive = snapshot->find(internalPath);
+    return archive ? archive->filename : "";
+}
+
+bool BsaManager::locateFile(const PathKey& internalPath, uint64_t& archiveFingerprint) const {
+    auto snapshot = currentIndex();
+    if (internalPath.empty() || !snapshot) {
+        return false;
+    }
+    const ArchiveHandle* archive = snapshot->find(internalPath);
+    if (!archive) {
+        return false;
+    }
+    archiveFingerprint = archive->fingerprint;
+    return true;
 }
 
 // This function now correctly finds the full BSA path from its internal list.
-std::vector<char> BsaManager::extractFile(const std::string& relativePath) const {
-    if (relativePath.empty()) {
+std::vector<char> BsaManager::extractFile(const PathKey& internalPath) const {
+    // Hold the snapshot for the whole extraction so its archive handles stay alive.
+    auto snapshot = currentIndex();
+    if (internalPath.empty() || !snapshot) {
         return {};
     }
 
-    std::string internalPath = normalizePath(relativePath);
-    std::string bsaName = findFileInArchives(internalPath);
+    ArchiveHandle* archive = snapshot->find(internalPath);
 
     // Case 1: Cache Miss - The file is not in our maps.
-    if (bsaName.empty()) {
+    if (!archive) {
         // Perform a global search across all BSAs since we have no cached location.
-        return findAndExtractDirectly(internalPath, "");
+        return findAndExtractDirectly(*snapshot, internalPath, nullptr);
     }
 
     // Case 2: Cache Hit - We have a predicted location for the file.
-    std::filesystem::path bsaFullPath;
-    for (const auto& p : bsaPaths) {
-        if (p.filename().string() == bsaName) {
-            bsaFullPath = p;
-            break;
-        }
-    }
-
-    if (bsaFullPath.empty()) {
-        // The cached BSA doesn't exist on disk. Fall back to a global search.
-        std::cout << "Cached BSA '" << bsaName << "' not found on disk. Falling back to global search for: " << internalPath << std::endl;
-        return findAndExtractDirectly(internalPath, "");
-    }
-
     try {
-        libbsarch::bs_archive bsa;
-        bsa.load_from_disk(bsaFullPath.wstring());
-        std::string extractionPath = internalPath;
-        std::replace(extractionPath.begin(), extractionPath.end(), '\\', '/');
-
-        libbsarch::memory_blob blob = bsa.extract_to_memory(extractionPath);
-        const char* data = static_cast<const char*>(blob.data);
-        return std::vector<char>(data, data + blob.size);
+        return archive->extract(toExtractionPath(internalPath));
     }
     catch (const std::exception& e) {
         // The file wasn't in the cached BSA. Fall back to a global search.
-        std::cerr << "Failed to extract " << internalPath << " from cached BSA " << bsaName << ": " << e.what() << std::endl;
+        std::cerr << "Failed to extract " << internalPath.view() << " from cached BSA " << archive->filename << ": " << e.what() << std::endl;
         std::cerr << "Cache might be stale. Falling back to global BSA search." << std::endl;
-        return findAndExtractDirectly(internalPath, bsaFullPath);
+        return findAndExtractDirectly(*snapshot, internalPath, archive);
     }
 }
-
-
-std::string BsaManager::normalizePath(const std::string& p) {
-    std::string s = p;
-    std::replace(s.begin(), s.end(), '/', '\\');
-    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-    if (!s.empty() && (s[0] == '\\')) s.erase(0, 1);
-
-    // If the path already has a top-level directory, don't modify it further.
-    if (s.rfind("textures\\", 0) == 0 || s.rfind("meshes\\", 0) == 0) {
-        return s;
-    }
-
-    // Find the file extension to decide on the prefix.
-    size_t dot_pos = s.find_last_of('.');
-    if (dot_pos != std::string::npos) {
-        std::string ext = s.substr(dot_pos);
-        if (ext == ".dds") {
-            s = "textures\\" + s;
-        }
-        else if (ext == ".nif" || ext == ".tri") {
-            s = "meshes\\" + s;
-        }
-    }
-
-    return s;
-}
\ No newline at end of file
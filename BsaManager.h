@@ -3,31 +3,55 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <nlohmann/json.hpp>
+#include "PathKey.h"
 
+// Thread safety: lookups and extractions may run concurrently from any number of threads.
+// The archive index is an immutable snapshot that loadArchives() replaces atomically, and
+// each open archive handle is guarded by its own mutex. libbsarch handles aren't thread-safe,
+// so extractions (including decompression) from one archive run one at a time; only
+// extractions from different archives overlap.
 class BsaManager {
 public:
     BsaManager() = default;
     void loadArchives(const std::string& directory, const std::filesystem::path& cache_dir);
-    std::string findFileInArchives(const std::string& relativePath) const;
-    std::vector<char> extractFile(const std::string& relativePath) const;
+    std::string findFileInArchives(const PathKey& internalPath) const;
+    std::vector<char> extractFile(const PathKey& internalPath) const;
+    // Finds the indexed archive holding a file and returns its fingerprint (name, size and
+    // modification time), which identifies that exact archive version across processes.
+    bool locateFile(const PathKey& internalPath, uint64_t& archiveFingerprint) const;
     size_t getArchiveCount() const;
+    // Up to 'maxCount' paths from the archive index, for self-checks.
+    std::vector<PathKey> listFiles(size_t maxCount) const;
 
 private:
+    struct ArchiveHandle; // An archive on disk plus its lazily opened, persistent libbsarch handle.
+
+    // Everything a lookup needs. Built once by loadArchives() and never modified afterwards.
+    struct Index {
+        std::vector<std::shared_ptr<ArchiveHandle>> archives; // Sorted by filename.
+        // Separate caches so textures-only queries don't scan meshes archives and vice versa.
+        // Values are positions in 'archives'.
+        std::unordered_map<PathKey, uint32_t> anyCache;      // fallback / non-standard paths
+        std::unordered_map<PathKey, uint32_t> texturesCache; // keys start with "textures\"
+        std::unordered_map<PathKey, uint32_t> meshesCache;   // keys start with "meshes\"
+
+        void add(const PathKey& internalPath, uint32_t archive);
+        const std::unordered_map<PathKey, uint32_t>& cacheFor(PathKey::Root root) const;
+        ArchiveHandle* find(const PathKey& internalPath) const;
+    };
+
     // New helper methods for loading and saving the JSON cache
-    bool loadCache(const std::string& bsa_directory);
-    void saveCache();
+    bool loadCache(const std::string& bsa_directory, Index& index) const;
+    void saveCache(const Index& index) const;
     // New helper for the global search fallback
-    std::vector<char> findAndExtractDirectly(const std::string& internalPath, const std::filesystem::path& bsaToExclude) const;
+    std::vector<char> findAndExtractDirectly(const Index& index, const PathKey& internalPath, const ArchiveHandle* bsaToExclude) const;
+
+    std::shared_ptr<const Index> currentIndex() const;
 
     std::filesystem::path cacheFilePath; // Path to bsa_contents_cache.json
-    std::vector<std::filesystem::path> bsaPaths;
-    // Separate caches so textures-only queries don't scan meshes archives and vice versa.
-    std::unordered_map<std::string, std::string> anyCache;      // fallback / non-standard paths
-    std::unordered_map<std::string, std::string> texturesCache; // keys start with "textures\"
-    std::unordered_map<std::string, std::string> meshesCache;   // keys start with "meshes\"
-
-    static std::string normalizePath(const std::string& p);
-};
\ No newline at end of file
+    std::shared_ptr<const Index> index;  // Only accessed through std::atomic_load/atomic_store.
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 (xxHash, 64-bit): a fast non-cryptographic hash for recognising identical file
+// contents. Not suitable where collisions could be forced on purpose; use sha256 for that.
+uint64_t contentHash64(const void* data, size_t size, uint64_t seed = 0);
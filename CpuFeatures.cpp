@@ -0,0 +1,40 @@
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define CPU_FEATURES_X86 0
+#endif
+
+namespace {
+
+    CpuFeatures detect() {
+        CpuFeatures features;
+#if CPU_FEATURES_X86
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        features.sse41 = (info[2] & (1 << 19)) != 0;
+        bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+        if (osSavesYmm) {
+            __cpuidex(info, 7, 0);
+            features.avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        features.sse41 = __builtin_cpu_supports("sse4.1");
+        features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+#endif
+        return features;
+    }
+
+}
+
+const CpuFeatures& DetectedCpuFeatures() {
+    static const CpuFeatures features = detect();
+    return features;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// The SIMD instruction sets the SIMD kernels (BcnDecoder, SkinningKernel) pick between,
+// detected once. AVX2 only counts if the OS also saves the YMM registers. Everything is
+// false on non-x86 builds.
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx2 = false;
+};
+
+const CpuFeatures& DetectedCpuFeatures();
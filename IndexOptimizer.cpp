@@ -0,0 +1,246 @@
+#include "IndexOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr uint32_t kNone = 0xFFFFFFFF;
+
+    // Forsyth's scoring, with the constants from his write-up: a simulated LRU cache of 32, the
+    // last triangle's vertices held at a flat score, and a boost for vertices with few
+    // triangles left so they get finished off instead of stranded.
+    constexpr size_t kForsythCacheSize = 32;
+    constexpr float kCacheDecayPower = 1.5f;
+    constexpr float kLastTriangleScore = 0.75f;
+    constexpr float kValenceBoostScale = 2.0f;
+    constexpr float kValenceBoostPower = 0.5f;
+    constexpr size_t kValenceTableSize = 32;
+
+    struct ScoreTables {
+        float cache[kForsythCacheSize];
+        float valence[kValenceTableSize];
+
+        ScoreTables() {
+            for (size_t i = 0; i < kForsythCacheSize; ++i) {
+                cache[i] = i < 3 ? kLastTriangleScore
+                    : std::pow(1.0f - float(i - 3) / float(kForsythCacheSize - 3), kCacheDecayPower);
+            }
+            valence[0] = 0.0f;
+            for (size_t i = 1; i < kValenceTableSize; ++i) {
+                valence[i] = kValenceBoostScale * std::pow(float(i), -kValenceBoostPower);
+            }
+        }
+    };
+
+    float VertexScore(const ScoreTables& tables, int cachePosition, uint32_t liveTriangles) {
+        if (liveTriangles == 0) return -1.0f; // Nothing left to draw from it.
+        float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+        return score + tables.valence[std::min<size_t>(liveTriangles, kValenceTableSize - 1)];
+    }
+
+    const float* Position(const float* positions, size_t stride, uint32_t vertex) {
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + size_t(vertex) * stride);
+    }
+}
+
+namespace IndexOptimizer {
+
+    double acmr(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize) {
+        if (indices.size() < 3) return 0.0;
+        // A vertex is cached if fewer than cacheSize misses have happened since it was loaded.
+        std::vector<size_t> loadedAt(vertexCount, 0);
+        size_t clock = cacheSize + 1;
+        size_t misses = 0;
+        for (uint32_t index : indices) {
+            if (clock - loadedAt[index] > cacheSize) {
+                loadedAt[index] = clock++;
+                ++misses;
+            }
+        }
+        return double(misses) / double(indices.size() / 3);
+    }
+
+    void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2) return;
+        static const ScoreTables tables;
+
+        // Each vertex's triangles that haven't been emitted yet, packed into one array: vertex v
+        // owns adjacency[offsets[v]] onwards, and the first liveCount[v] of those are still live.
+        std::vector<uint32_t> liveCount(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; ++i) ++liveCount[indices[i]];
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + liveCount[v];
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < triangleCount * 3; ++i) adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = VertexScore(tables, -1, liveCount[v]);
+
+        std::vector<float> triangleScore(triangleCount);
+        uint32_t best = kNone;
+        float bestScore = -1.0f;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            const uint32_t* tri = &indices[t * 3];
+            triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+            if (triangleScore[t] > bestScore) {
+                bestScore = triangleScore[t];
+                best = uint32_t(t);
+            }
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> ordered;
+        ordered.reserve(triangleCount * 3);
+        std::vector<uint32_t> cache, nextCache;
+        cache.reserve(kForsythCacheSize + 3);
+        nextCache.reserve(kForsythCacheSize + 3);
+        size_t cursor = 0;
+
+        while (ordered.size() < triangleCount * 3) {
+            if (best == kNone) {
+                // Nothing in the cache has triangles left; restart from the next unemitted one.
+                while (emitted[cursor]) ++cursor;
+                best = uint32_t(cursor);
+            }
+            emitted[best] = true;
+            const uint32_t* tri = &indices[size_t(best) * 3];
+            nextCache.clear();
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t v = tri[k];
+                ordered.push_back(v);
+
+                uint32_t* live = &adjacency[offsets[v]];
+                uint32_t* slot = std::find(live, live + liveCount[v], best);
+                std::swap(*slot, live[--liveCount[v]]);
+
+                if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) nextCache.push_back(v);
+            }
+            // The triangle's vertices move to the front; the rest of the cache shifts back.
+            const size_t fresh = nextCache.size();
+            for (uint32_t v : cache) {
+                if (std::find(nextCache.begin(), nextCache.begin() + fresh, v) == nextCache.begin() + fresh) nextCache.push_back(v);
+            }
+
+            // Rescore everything that was or is in the cache (evicted vertices drop back to their
+            // valence score), then pick the best live triangle touching it.
+            for (size_t i = 0; i < nextCache.size(); ++i) {
+                const uint32_t v = nextCache[i];
+                cachePosition[v] = i < kForsythCacheSize ? int(i) : -1;
+                vertexScore[v] = VertexScore(tables, cachePosition[v], liveCount[v]);
+            }
+            best = kNone;
+            bestScore = -1.0f;
+            for (uint32_t v : nextCache) {
+                for (uint32_t j = 0; j < liveCount[v]; ++j) {
+                    const uint32_t t = adjacency[offsets[v] + j];
+                    const uint32_t* other = &indices[size_t(t) * 3];
+                    triangleScore[t] = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+                    if (triangleScore[t] > bestScore) {
+                        bestScore = triangleScore[t];
+                        best = t;
+                    }
+                }
+            }
+            if (nextCache.size() > kForsythCacheSize) nextCache.resize(kForsythCacheSize);
+            cache.swap(nextCache);
+        }
+
+        std::copy(ordered.begin(), ordered.end(), indices.begin());
+    }
+
+    void optimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount,
+        float threshold) {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2) return;
+
+        // Cluster boundaries: triangles whose three vertices all miss the cache. Moving whole
+        // clusters around keeps nearly all of the reuse the cache pass found.
+        std::vector<size_t> clusterStarts;
+        {
+            std::vector<size_t> loadedAt(vertexCount, 0);
+            size_t clock = kReportCacheSize + 1;
+            for (size_t t = 0; t < triangleCount; ++t) {
+                int misses = 0;
+                for (int k = 0; k < 3; ++k) {
+                    const uint32_t v = indices[t * 3 + k];
+                    if (clock - loadedAt[v] > kReportCacheSize) {
+                        loadedAt[v] = clock++;
+                        ++misses;
+                    }
+                }
+                if (t == 0 || misses == 3) clusterStarts.push_back(t);
+            }
+        }
+        if (clusterStarts.size() < 2) return;
+        clusterStarts.push_back(triangleCount);
+        const size_t clusterCount = clusterStarts.size() - 1;
+
+        // Area-weighted centroid and summed normal of each cluster, and of the whole mesh.
+        std::vector<float> clusterData(clusterCount * 7, 0.0f); // Centroid sum xyz, area, normal sum xyz.
+        float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+        float meshArea = 0.0f;
+        for (size_t c = 0; c < clusterCount; ++c) {
+            float* data = &clusterData[c * 7];
+            for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+                const float* p0 = Position(positions, positionStride, indices[t * 3]);
+                const float* p1 = Position(positions, positionStride, indices[t * 3 + 1]);
+                const float* p2 = Position(positions, positionStride, indices[t * 3 + 2]);
+                const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+                const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (int i = 0; i < 3; ++i) {
+                    data[i] += (p0[i] + p1[i] + p2[i]) * (area / 3.0f);
+                    data[4 + i] += n[i];
+                }
+                data[3] += area;
+            }
+            for (int i = 0; i < 3; ++i) meshCentroid[i] += data[i];
+            meshArea += data[3];
+        }
+        if (meshArea <= 0.0f) return;
+        for (float& m : meshCentroid) m /= meshArea;
+
+        // Sort key: how far along its own normal the cluster sits from the mesh centre.
+        std::vector<float> keys(clusterCount, 0.0f);
+        for (size_t c = 0; c < clusterCount; ++c) {
+            const float* data = &clusterData[c * 7];
+            const float length = std::sqrt(data[4] * data[4] + data[5] * data[5] + data[6] * data[6]);
+            if (data[3] <= 0.0f || length <= 0.0f) continue;
+            float key = 0.0f;
+            for (int i = 0; i < 3; ++i) key += (data[i] / data[3] - meshCentroid[i]) * (data[4 + i] / length);
+            keys[c] = key;
+        }
+        std::vector<uint32_t> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; ++c) order[c] = uint32_t(c);
+        std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+        std::vector<uint32_t> sorted;
+        sorted.reserve(indices.size());
+        for (uint32_t c : order) {
+            sorted.insert(sorted.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+        }
+        sorted.insert(sorted.end(), indices.begin() + triangleCount * 3, indices.end());
+        if (acmr(sorted, vertexCount) <= acmr(indices, vertexCount) * threshold) {
+            indices.swap(sorted);
+        }
+    }
+
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+        std::vector<uint32_t> remap(vertexCount, kNone);
+        uint32_t next = 0;
+        for (uint32_t& index : indices) {
+            if (remap[index] == kNone) remap[index] = next++;
+            index = remap[index];
+        }
+        for (auto& slot : remap) {
+            if (slot == kNone) slot = next++;
+        }
+        return remap;
+    }
+}
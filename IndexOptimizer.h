@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reorders a triangle list's indices and vertices for the GPU, without changing what is drawn.
+//
+// NIF triangles come in whatever order the exporter wrote them, so the same vertex is often
+// shaded again after falling out of the post-transform cache. The passes below run in order:
+// optimizeVertexCache (Forsyth's linear-speed reordering), then optimizeOverdraw (outward-facing
+// clusters first, as long as the cache gain mostly survives), then optimizeVertexFetch
+// (renumbers vertices in first-use order so fetches walk the vertex buffer forwards).
+// Alpha-blended meshes depend on their triangle order, so they only get the last pass.
+// Every index must be below vertexCount.
+namespace IndexOptimizer {
+
+    // Cache size assumed when reporting ACMR; a typical FIFO post-transform cache.
+    constexpr size_t kReportCacheSize = 16;
+
+    // Average cache miss ratio: vertices shaded per triangle with a FIFO cache of 'cacheSize'
+    // entries. 3.0 is the worst case; around 0.6 to 0.7 is good for a closed mesh. 0 when empty.
+    double acmr(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = kReportCacheSize);
+
+    void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+    // 'positions' points at the x of vertex 0, with 'positionStride' bytes between vertices
+    // (x, y, z floats). Groups of triangles that start with a cold cache are sorted so the ones
+    // on the outside of the mesh, facing outwards, draw first and hide what is behind them. The
+    // new order is dropped if it raises ACMR by more than 'threshold' times.
+    void optimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount,
+        float threshold = 1.05f);
+
+    // Renumbers vertices in the order the indices first use them, rewriting 'indices', and
+    // returns the map from old to new vertex numbers. Vertices no triangle uses go last.
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// A read-only memory mapping of a whole file. The view stays valid until close() or
+// destruction; pages are only read from disk when first touched.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Fails (quietly) for missing or empty files.
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    bool isOpen() const { return view != nullptr; }
+    const char* data() const { return static_cast<const char*>(view); }
+    size_t size() const { return mappedBytes; }
+
+private:
+    void* view = nullptr;
+    size_t mappedBytes = 0;
+#ifdef _WIN32
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// A file name next to 'finalPath' to write it under before renaming it into place. It holds
+// the process and thread ids, so concurrent writers (even from other processes sharing the
+// cache folder) never write the same temporary file.
+std::filesystem::path TemporarySiblingPath(const std::filesystem::path& finalPath);
@@ -0,0 +1,41 @@
+#include "MemoryStream.h"
+
+MemoryStreamBuf::MemoryStreamBuf(const char* data, size_t size) {
+    // The get area is never written through: putting back a different character fails
+    // (the default pbackfail()), and there is no put area.
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) {
+    if (!(which & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+    off_type base = 0;
+    switch (direction) {
+    case std::ios_base::beg: base = 0; break;
+    case std::ios_base::cur: base = gptr() - eback(); break;
+    case std::ios_base::end: base = egptr() - eback(); break;
+    default: return pos_type(off_type(-1));
+    }
+    off_type target = base + offset;
+    if (target < 0 || target > egptr() - eback()) {
+        return pos_type(off_type(-1));
+    }
+    setg(eback(), eback() + target, egptr());
+    return pos_type(target);
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(pos_type position, std::ios_base::openmode which) {
+    return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+std::streamsize MemoryStreamBuf::showmanyc() {
+    std::streamsize remaining = egptr() - gptr();
+    return remaining > 0 ? remaining : -1;
+}
+
+MemoryInputStream::MemoryInputStream(const char* data, size_t size)
+    : std::istream(nullptr), buffer(data, size) {
+    rdbuf(&buffer); // The base is constructed before 'buffer', so attach it here.
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+
+// A read-only stream buffer over memory owned by someone else (a std::vector, a MappedFile
+// view, ...). nifly only loads from a std::istream; wrapping the bytes in a stringstream
+// copies them twice (into a std::string, then into the stream), so a large NIF briefly
+// takes three times its size. The memory must outlive the stream.
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const char* data, size_t size);
+
+protected:
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+    std::streamsize showmanyc() override;
+};
+
+// An std::istream reading from a MemoryStreamBuf.
+class MemoryInputStream : public std::istream {
+public:
+    MemoryInputStream(const char* data, size_t size);
+
+private:
+    MemoryStreamBuf buffer;
+};
@@ -0,0 +1,110 @@
+#include "MeshDiskCache.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    constexpr uint32_t kMagic = 0x48534D4E; // "NMSH"
+    constexpr uint32_t kFormatVersion = 2;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t skeletonFingerprint;
+        uint32_t skeletonHint;
+        uint32_t reserved[3];
+        uint64_t payloadSize;
+    };
+    // The payload starts right after the header; keep it 16-byte aligned for the vertex data.
+    static_assert(sizeof(FileHeader) % 16 == 0, "FileHeader must keep the payload aligned");
+}
+
+bool MeshDiskCache::open(const std::filesystem::path& cacheDirectory) {
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDirectory, ec);
+    if (ec || !std::filesystem::is_directory(cacheDirectory, ec)) {
+        std::cerr << "Mesh disk cache: could not create " << cacheDirectory.string() << " (" << ec.message() << ")." << std::endl;
+        directory.clear();
+        return false;
+    }
+    directory = cacheDirectory;
+    std::cout << "--- Mesh disk cache: " << directory.string() << " ---" << std::endl;
+    return true;
+}
+
+std::filesystem::path MeshDiskCache::pathFor(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.npcmesh", static_cast<unsigned long long>(key));
+    return directory / name;
+}
+
+std::unique_ptr<MappedFile> MeshDiskCache::lookup(uint64_t key, const char*& payload, size_t& payloadSize, Provenance& provenance) const {
+    if (!isOpen()) {
+        return nullptr;
+    }
+
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(pathFor(key)) || file->size() < sizeof(FileHeader)) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != kMagic || header.version != kFormatVersion || header.key != key
+        || header.payloadSize != file->size() - sizeof(FileHeader)) {
+        // Written by another version, truncated, or a hash collision between keys; rebuilt on this load.
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    payload = file->data() + sizeof(FileHeader);
+    payloadSize = static_cast<size_t>(header.payloadSize);
+    provenance.skeletonFingerprint = header.skeletonFingerprint;
+    provenance.skeletonHint = header.skeletonHint;
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return file;
+}
+
+void MeshDiskCache::store(uint64_t key, const std::vector<char>& payload, const Provenance& provenance) const {
+    if (!isOpen() || payload.empty()) {
+        return;
+    }
+
+    FileHeader header{};
+    header.magic = kMagic;
+    header.version = kFormatVersion;
+    header.key = key;
+    header.skeletonFingerprint = provenance.skeletonFingerprint;
+    header.skeletonHint = provenance.skeletonHint;
+    header.payloadSize = payload.size();
+
+    // As in TextureDiskCache: each writer uses its own temporary file and the last rename wins.
+    std::filesystem::path finalPath = pathFor(key);
+    std::filesystem::path tempPath = TemporarySiblingPath(finalPath);
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out) {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, finalPath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return;
+    }
+    writes.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+class MappedFile;
+
+// An on-disk cache of fully processed models (".npcmesh" files): NifModel's compiled form
+// (see NifModel::loadCompiled) behind a small header. Files are memory-mapped on lookup, and
+// the vertex and index data are uploaded straight from the mapping, so a warm load skips the
+// NIF parse and all of the per-shape CPU work.
+//
+// One file is kept per key. The caller picks the key from the NIF's contents and the program
+// version. Which skeleton the model was posed with is stored in the header for the caller to
+// check, since the choice is itself made from the NIF. Files are written under a temporary
+// name and renamed into place, the same as TextureDiskCache.
+//
+// The cache is opt-in. Until open() succeeds, lookup() always misses and store() does nothing.
+class MeshDiskCache {
+public:
+    // What a blob was built with, stored alongside it.
+    struct Provenance {
+        uint64_t skeletonFingerprint = 0; // Skeleton::getFingerprint() of the pose skeleton, or 0.
+        uint32_t skeletonHint = 0;        // What the NIF said about its skeleton (Renderer's SkeletonHint).
+    };
+
+    MeshDiskCache() = default;
+    MeshDiskCache(const MeshDiskCache&) = delete;
+    MeshDiskCache& operator=(const MeshDiskCache&) = delete;
+
+    bool open(const std::filesystem::path& directory);
+    bool isOpen() const { return !directory.empty(); }
+
+    // On a hit, 'payload' points into the returned mapping, which must outlive any use of it.
+    std::unique_ptr<MappedFile> lookup(uint64_t key, const char*& payload, size_t& payloadSize, Provenance& provenance) const;
+    // Writes and renames the file before returning, on the calling thread.
+    void store(uint64_t key, const std::vector<char>& payload, const Provenance& provenance) const;
+
+    // Per-process counters, for logging.
+    uint64_t hitCount() const { return hits.load(std::memory_order_relaxed); }
+    uint64_t missCount() const { return misses.load(std::memory_order_relaxed); }
+    uint64_t writeCount() const { return writes.load(std::memory_order_relaxed); }
+
+private:
+    std::filesystem::path pathFor(uint64_t key) const;
+
+    std::filesystem::path directory;
+    mutable std::atomic<uint64_t> hits{ 0 };
+    mutable std::atomic<uint64_t> misses{ 0 };
+    mutable std::atomic<uint64_t> writes{ 0 };
+};
@@ -6,17 +6,30 @@
 #include "Shader.h"
 #include "TextureManager.h" 
 #include "Renderer.h"
+#include "MappedFile.h"
+#include "MemoryStream.h"
+#include "ThreadPool.h"
+#include "SkinningKernel.h"
+#include "SceneGraphTable.h"
+#include "IndexOptimizer.h"
+#include "ProcessMemory.h"
 #include <iostream>
 #include <set>
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_precision.hpp>
 #include <Shaders.hpp> 
 #include <limits>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/norm.hpp>  // gives length2() and distance2()
 #include <chrono>
 #include <sstream> // Add for std::stringstream
 #include <fstream> 
+#include <thread>
 
 // Vertex structure used for processing mesh data, now includes skinning and tangent space info
 struct Vertex {
@@ -30,6 +43,165 @@ struct Vertex {
     glm::vec3 bitangent = glm::vec3(0.0f);
 };
 
+// The GPU copy of a Vertex. Position keeps full precision and the rest is packed:
+//   offset 0   position, 3 x float               12 bytes
+//   offset 12  normal, snorm 10_10_10_2            4
+//   offset 16  tangent, snorm 10_10_10_2           4  (w: bitangent handedness, rebuilt in the shader)
+//   offset 20  UV, 2 x half                        4
+// followed by the streams a shape actually has:
+//              colour, 4 x unorm8                  4
+//              bone ids, 4 x uint8 (uint16 > 255)  4 or 8
+//              weights, 4 x unorm16                8
+// That is 24-40 bytes a vertex instead of sizeof(Vertex) = 104.
+struct PackedVertexLayout {
+    bool colors = false;
+    bool skinning = false;
+    bool wideBoneIds = false;
+    GLsizei stride = 24;
+    size_t colorOffset = 0, boneIdOffset = 0, weightOffset = 0;
+};
+
+PackedVertexLayout MakePackedVertexLayout(const std::vector<Vertex>& vertices, bool colors, bool skinning) {
+    PackedVertexLayout layout;
+    layout.colors = colors;
+    layout.skinning = skinning;
+    size_t offset = 24;
+    if (colors) {
+        layout.colorOffset = offset;
+        offset += 4;
+    }
+    if (skinning) {
+        for (const auto& vert : vertices) {
+            if (glm::any(glm::greaterThan(vert.boneIDs, glm::ivec4(255)))) {
+                layout.wideBoneIds = true;
+                break;
+            }
+        }
+        layout.boneIdOffset = offset;
+        offset += layout.wideBoneIds ? 8 : 4;
+        layout.weightOffset = offset;
+        offset += 8;
+    }
+    layout.stride = static_cast<GLsizei>(offset);
+    return layout;
+}
+
+std::vector<char> PackVertices(const std::vector<Vertex>& vertices, const PackedVertexLayout& layout) {
+    std::vector<char> packed(vertices.size() * layout.stride);
+    char* out = packed.data();
+    for (const auto& vert : vertices) {
+        float handedness = glm::dot(glm::cross(vert.normal, vert.tangent), vert.bitangent) < 0.0f ? -1.0f : 1.0f;
+        uint32_t normal = glm::packSnorm3x10_1x2(glm::vec4(glm::clamp(vert.normal, -1.0f, 1.0f), 0.0f));
+        uint32_t tangent = glm::packSnorm3x10_1x2(glm::vec4(glm::clamp(vert.tangent, -1.0f, 1.0f), handedness));
+        uint32_t texCoords = glm::packHalf2x16(vert.texCoords);
+        std::memcpy(out, &vert.pos, 12);
+        std::memcpy(out + 12, &normal, 4);
+        std::memcpy(out + 16, &tangent, 4);
+        std::memcpy(out + 20, &texCoords, 4);
+        if (layout.colors) {
+            uint32_t color = glm::packUnorm4x8(vert.color);
+            std::memcpy(out + layout.colorOffset, &color, 4);
+        }
+        if (layout.skinning) {
+            if (layout.wideBoneIds) {
+                glm::u16vec4 ids(glm::clamp(vert.boneIDs, glm::ivec4(0), glm::ivec4(0xFFFF)));
+                std::memcpy(out + layout.boneIdOffset, &ids, 8);
+            }
+            else {
+                glm::u8vec4 ids(glm::clamp(vert.boneIDs, glm::ivec4(0), glm::ivec4(0xFF)));
+                std::memcpy(out + layout.boneIdOffset, &ids, 4);
+            }
+            uint64_t weights = glm::packUnorm4x16(glm::clamp(vert.weights, 0.0f, 1.0f));
+            std::memcpy(out + layout.weightOffset, &weights, 8);
+        }
+        out += layout.stride;
+    }
+    return packed;
+}
+
+// Expects the VAO and VBO bound. Streams the layout leaves out stay disabled: colours then
+// read the generic value set in NifModel::draw() (white), and bone data is only read for
+// skinned shapes.
+void SetPackedVertexAttributes(const PackedVertexLayout& layout) {
+    const GLsizei stride = layout.stride;
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)12);
+    glEnableVertexAttribArray(6);
+    glVertexAttribPointer(6, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)16);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)20);
+    if (layout.colors) {
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)layout.colorOffset);
+    }
+    if (layout.skinning) {
+        glEnableVertexAttribArray(4);
+        glVertexAttribIPointer(4, 4, layout.wideBoneIds ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE, stride, (void*)layout.boneIdOffset);
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)layout.weightOffset);
+    }
+}
+
+// One shape as prepared on a worker thread by NifModel::load: everything up to (but not
+// including) the texture loads and GL calls, which stay on the GL thread.
+struct ShapePacket {
+    bool skipped = true; // Hidden or empty; nothing to upload.
+    nifly::NiShape* shape = nullptr;
+    const nifly::NiShader* shader = nullptr;
+    MeshShape mesh;
+    PackedVertexLayout vertexLayout;
+    std::vector<char> vertices;
+    std::vector<char> indices; // indexCount elements of mesh.indexType.
+    size_t indexCount = 0;
+    double acmrBefore = 0.0, acmrAfter = 0.0; // Vertex cache misses per triangle, as read and as drawn.
+
+    // Posed bounds in NIF root space (Z-up), and what the model-wide merge needs to know about them.
+    glm::vec3 minBounds_nifRootSpace_zUp = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 maxBounds_nifRootSpace_zUp = glm::vec3(std::numeric_limits<float>::lowest());
+    bool isAccessoryPart = false;
+    bool isPrimaryHead = false;
+    glm::vec3 eyeCenter_nifRootSpace_zUp = glm::vec3(0.0f);
+
+    std::string log; // Debug output, buffered so shapes don't interleave.
+    std::chrono::high_resolution_clock::duration stage1{}, stage2{}, stage3{}, stage4{}, preprocess{};
+};
+
+// Shapes are small enough that more workers than this just wait on the queue.
+constexpr size_t kMaxShapeThreads = 8;
+
+// std140 mirror of the 'Material' uniform block in basic.frag; keep the two in sync.
+// Booleans are 4-byte values in std140, hence the GLints.
+struct MaterialBlock {
+    glm::vec3 tintColor;
+    float greyscaleToPaletteScale;
+    glm::vec3 emissiveColor;
+    float emissiveMultiple;
+    float glossiness;
+    float specularStrength;
+    float rimlightPower;
+    float subsurfaceRolloff;
+    float envMapScale;
+    float eyeCubemapScale;
+    float alphaThreshold;
+    GLint diffuseLayer, normalLayer, skinLayer, detailLayer, specularLayer, faceTintLayer, envMapLayer, envMaskLayer;
+    GLint isEye, isModelSpace, hasGreyscaleToPalette, hasTintColor, hasEmissive, hasHairSoftLighting, hasSoftLighting, hasVertexColors;
+    GLint hasNormalMap, hasSkinMap, hasDetailMap, hasSpecular, hasSpecularMap, hasFaceTintMap;
+    GLint hasEnvironmentMap, hasEyeEnvironmentMap, isEnvmapCube, hasEnvMask;
+};
+static_assert(sizeof(MaterialBlock) == 164, "MaterialBlock must match the std140 layout of the shader's Material block");
+
+// Bound ranges are rounded up to a whole vec4, as std140 sizes the block.
+constexpr GLsizeiptr kMaterialBlockSize = (sizeof(MaterialBlock) + 15) & ~GLsizeiptr(15);
+constexpr GLuint kMaterialBlockBinding = 0;
+
+// Texture units used by basic.frag. The shadow map (unit 8) is bound by the renderer.
+enum TextureUnit : GLuint {
+    kUnitDiffuse = 0, kUnitNormal, kUnitSkin, kUnitDetail, kUnitSpecular, kUnitFaceTint, kUnitEnvMap2D, kUnitEnvMask,
+    kUnitShadowMap, kUnitEnvMapCube, kTextureUnitCount
+};
+
 // Helper function to calculate the centroid of a set of vertices
 glm::vec3 CalculateCentroid(const std::vector<Vertex>& vertices) {
     if (vertices.empty()) {
@@ -42,6 +214,38 @@ glm::vec3 CalculateCentroid(const std::vector<Vertex>& vertices) {
     return sum / static_cast<float>(vertices.size());
 }
 
+// The top three rows of an affine glm (column-major) matrix, as Skinning::posedBounds takes it.
+Skinning::Affine ToAffine(const glm::mat4& m) {
+    Skinning::Affine affine;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            affine.m[r][c] = m[c][r];
+        }
+    }
+    return affine;
+}
+
+// Transposes the positions (and, for a skinned shape, the bone influences) of 'vertices' into the
+// structure-of-arrays layout the skinning kernel reads. An influence on a bone the shape doesn't
+// have is dropped rather than read out of range.
+Skinning::StreamStorage MakeSkinningStreams(const std::vector<Vertex>& vertices, size_t boneCount) {
+    Skinning::StreamStorage streams;
+    streams.resize(vertices.size(), boneCount > 0);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        streams.x[i] = vertices[i].pos.x;
+        streams.y[i] = vertices[i].pos.y;
+        streams.z[i] = vertices[i].pos.z;
+        if (boneCount == 0) continue;
+        for (int k = 0; k < 4; ++k) {
+            const int boneId = vertices[i].boneIDs[k];
+            if (boneId < 0 || static_cast<size_t>(boneId) >= boneCount) continue;
+            streams.boneIds[k][i] = boneId;
+            streams.weights[k][i] = vertices[i].weights[k];
+        }
+    }
+    return streams;
+}
+
 struct ShaderFlagSet {
     // Flags from shaderFlags1 (SLSF1)
     bool SLSF1_Specular = false;
@@ -139,47 +343,6 @@ std::string GetFlagsString(const ShaderFlagSet& flags, int set_number) {
     return ss.str();
 }
 
-// Helper function to get the full world transform of any scene graph object (Node or Shape).
-// This calculates the transformation from the object's local space to the NIF file's root space.
-nifly::MatTransform GetAVObjectTransformToGlobal(const nifly::NifFile& nifFile, nifly::NiAVObject* obj, bool debugMode = false) {
-    if (!obj) {
-        return nifly::MatTransform();
-    }
-
-    // This matrix transforms from the object's local space to its parent's space.
-    // It is a row-major matrix within the NIF's Z-up coordinate system.
-    nifly::MatTransform objectToNifRoot_transform_zUp = obj->GetTransformToParent();
-
-    nifly::NiNode* parent = nifFile.GetParentNode(obj);
-    while (parent) {
-        // ComposeTransforms pre-multiplies, so the operation is: parent * current.
-        // This correctly concatenates the transforms up the scene graph hierarchy.
-        objectToNifRoot_transform_zUp = parent->GetTransformToParent().ComposeTransforms(objectToNifRoot_transform_zUp);
-
-        // --- CORRECTED LOGGING ---
-        if (debugMode) {
-            std::stringstream niflyMatrixStream;
-            // --- MODIFIED LINE ---
-            const float* matrixData = &objectToNifRoot_transform_zUp.ToMatrix()[0]; // Get a pointer to the data
-            niflyMatrixStream << "\n";
-            for (int row = 0; row < 4; ++row) {
-                niflyMatrixStream << "        [";
-                for (int col = 0; col < 4; ++col) {
-                    // Access data in row-major order and format it
-                    niflyMatrixStream << std::setw(9) << std::fixed << std::setprecision(4) << matrixData[row * 4 + col];
-                    if (col < 3) niflyMatrixStream << ", ";
-                }
-                niflyMatrixStream << "]\n";
-            }
-            std::cout << "  [GetAVObjectTransformToGlobal] Composed with parent '" << parent->name.get() << "'. Cumulative Matrix (Nifly Z-up, Row-major):" << niflyMatrixStream.str();
-        }
-        // --- END CORRECTION ---
-
-        parent = nifFile.GetParentNode(parent);
-    }
-    return objectToNifRoot_transform_zUp;
-}
-
 // Helper to convert NIF blend modes to OpenGL blend modes
 GLenum NifBlendToGL(unsigned int nifBlend) {
     switch (nifBlend) {
@@ -202,36 +365,243 @@ static bool isHeadDismemberPartition(int partID) {
 }
 
 
-// Returns true if 'ancestor' is an ancestor of 'node' in the NIF scene graph.
-static bool IsAncestor(const nifly::NifFile& nif, const nifly::NiNode* ancestor, nifly::NiNode* node) {
-    if (!ancestor || !node) return false;
-    for (nifly::NiNode* p = node; p != nullptr; p = nif.GetParentNode(p)) {
-        if (p == ancestor) return true;
-    }
-    return false;
-}
-
 // Finds the lowest common ancestor of all bones in a NiSkinInstance.
-static nifly::NiNode* FindSkeletonRootLCA(const nifly::NifFile& nif, nifly::NiSkinInstance* si) {
+static nifly::NiNode* FindSkeletonRootLCA(const nifly::NifFile& nif, const SceneGraphTable& sceneGraph, nifly::NiSkinInstance* si) {
     if (!si) return nullptr;
-    std::vector<nifly::NiNode*> bones;
+    std::vector<uint32_t> bones;
     for (auto it = si->boneRefs.begin(); it != si->boneRefs.end(); ++it) {
-        if (auto* b = nif.GetHeader().GetBlock<nifly::NiNode>(*it)) {
-            bones.push_back(b);
+        if (nif.GetHeader().GetBlock<nifly::NiNode>(*it)) {
+            bones.push_back(it->index);
         }
     }
     if (bones.empty()) return nullptr;
-    for (nifly::NiNode* candidate = bones[0]; candidate != nullptr; candidate = nif.GetParentNode(candidate)) {
-        bool allChildrenFound = true;
-        for (size_t i = 1; i < bones.size(); ++i) {
-            if (!IsAncestor(nif, candidate, bones[i])) {
-                allChildrenFound = false;
-                break;
+    uint32_t root = sceneGraph.lowestCommonAncestor(bones);
+    if (root != SceneGraphTable::kNone) {
+        return nif.GetHeader().GetBlock<nifly::NiNode>(root);
+    }
+    return nif.GetRootNode(); // Fallback
+}
+
+// Loads a shader texture set as one batch and points the shape's texture slots at the results.
+// The shape keeps a reference to every texture that loaded.
+void AssignTextureSet(MeshShape& mesh, const std::vector<std::string>& setPaths, TextureManager& textureManager, bool debugMode) {
+    std::vector<TextureInfo> setInfos = textureManager.loadTextureSet(setPaths);
+    for (const auto& info : setInfos) {
+        if (info.id != 0) mesh.textureRefs.push_back(info);
+    }
+
+    for (size_t i = 0; i < setPaths.size(); ++i) {
+        const std::string& texPath = setPaths[i];
+        if (texPath.empty()) continue;
+
+        if (debugMode) {
+            std::string slotName = "Unknown";
+            switch (i) {
+            case 0: slotName = "Diffuse"; break;
+            case 1: slotName = "Normal"; break;
+            case 2: slotName = "Skin/Subsurface"; break;
+            case 3: slotName = "Detail"; break;
+            case 4: slotName = "Environment Map"; break;
+            case 5: slotName = "Environment Mask"; break;
+            case 6: slotName = "Face Tint Mask"; break;
+            case 7: slotName = "Specular"; break;
             }
+            std::cout << "    [Texture Load] Shape '" << mesh.name << "' | Slot " << i << " | " << slotName << ": \"" << texPath << "\"\n";
+        }
+
+        TextureInfo texInfo = setInfos[i];
+        // Every slot but the environment map samples a 2D array; anything else can't be bound there.
+        bool cubeEnvMap = i == 4 && texInfo.target == GL_TEXTURE_CUBE_MAP;
+        if (texInfo.id != 0 && texInfo.target != GL_TEXTURE_2D_ARRAY && !cubeEnvMap) {
+            std::cerr << "Warning: Texture \"" << texPath << "\" is not a 2D texture; slot " << i << " of '" << mesh.name << "' is left empty." << std::endl;
+            texInfo = TextureInfo();
+        }
+
+        // Now assign the members of the struct to the mesh.
+        switch (i) {
+        case 0: mesh.diffuseTextureID = texInfo.id; mesh.diffuseLayer = texInfo.layer; break;
+        case 1: mesh.normalTextureID = texInfo.id; mesh.normalLayer = texInfo.layer; break;
+        case 2: mesh.skinTextureID = texInfo.id; mesh.skinLayer = texInfo.layer; break;
+        case 3: mesh.detailTextureID = texInfo.id; mesh.detailLayer = texInfo.layer; break;
+        case 4: // Environment Map - store both ID and target
+            mesh.environmentMapID = texInfo.id;
+            mesh.environmentMapTarget = cubeEnvMap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D_ARRAY;
+            mesh.environmentMapLayer = texInfo.layer;
+            break;
+        case 5: mesh.environmentMaskID = texInfo.id; mesh.environmentMaskLayer = texInfo.layer; break;   // Masks are always 2D
+        case 6: mesh.faceTintColorMaskID = texInfo.id; mesh.faceTintLayer = texInfo.layer; break;
+        case 7: mesh.specularTextureID = texInfo.id; mesh.specularLayer = texInfo.layer; break;
+        default: break;
         }
-        if (allChildrenFound) return candidate;
     }
-    return nif.GetRootNode(); // Fallback
+}
+
+size_t IndexSize(GLenum type) {
+    return type == GL_UNSIGNED_INT ? sizeof(uint32_t) : sizeof(uint16_t);
+}
+
+// The narrowest index type that can address every vertex: 16-bit unless the shape is too big.
+std::vector<char> PackIndices(const std::vector<uint32_t>& indices, size_t vertexCount, GLenum& type) {
+    type = vertexCount > 0xFFFF ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    std::vector<char> packed(indices.size() * IndexSize(type));
+    if (type == GL_UNSIGNED_INT) {
+        std::memcpy(packed.data(), indices.data(), packed.size());
+    }
+    else {
+        std::vector<uint16_t> narrow(indices.begin(), indices.end());
+        std::memcpy(packed.data(), narrow.data(), packed.size());
+    }
+    return packed;
+}
+
+// Creates the shape's VAO and buffers and uploads its packed vertices and indices (of mesh.indexType).
+void UploadShapeBuffers(MeshShape& mesh, const PackedVertexLayout& layout, const void* vertices, size_t vertexBytes, const void* indices, size_t indexCount) {
+    glGenVertexArrays(1, &mesh.VAO);
+    glGenBuffers(1, &mesh.VBO);
+    glGenBuffers(1, &mesh.EBO);
+    glBindVertexArray(mesh.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+    mesh.vertexBytes = vertexBytes;
+
+    if (indexCount > 0) {
+        mesh.indexCount = static_cast<GLsizei>(indexCount);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * IndexSize(mesh.indexType), indices, GL_STATIC_DRAW);
+        mesh.indexBytes = indexCount * IndexSize(mesh.indexType);
+    }
+
+    SetPackedVertexAttributes(layout);
+
+    glBindVertexArray(0);
+}
+
+// --- Compiled Model Format ---
+// NifModel's processed result as load() writes it and loadCompiled() reads it back (see
+// MeshDiskCache). Values are stored in the in-memory representation, which is fine for a cache
+// on the machine that wrote it; bump MeshDiskCache's format version whenever this changes.
+//
+//   CompiledModelHeader
+//   per shape: render pass, name, material flags and values, transforms, bone palette,
+//              texture set paths, vertex layout, then the vertex and index data (16-byte aligned)
+
+struct CompiledModelHeader {
+    uint32_t shapeCount;
+    uint32_t flags;
+    glm::vec3 minBounds, maxBounds;
+    glm::vec3 headMinBounds, headMaxBounds;
+    glm::vec3 headShapeMinBounds, headShapeMaxBounds;
+    glm::vec3 eyeCenter;
+};
+constexpr uint32_t kCompiledHasHeadShapeBounds = 1u << 0;
+constexpr uint32_t kCompiledHasEyeCenter = 1u << 1;
+
+using RenderPass = NifModel::RenderPass;
+
+// MeshShape's flags and scalar material values, in stored order.
+const bool MeshShape::* const kCompiledShapeFlags[] = {
+    &MeshShape::isModelSpace, &MeshShape::isEye, &MeshShape::flipUvs, &MeshShape::isSkinned,
+    &MeshShape::hasAlphaProperty, &MeshShape::alphaBlend, &MeshShape::alphaTest, &MeshShape::doubleSided,
+    &MeshShape::zBufferWrite, &MeshShape::hasTintColor, &MeshShape::hasVertexColors, &MeshShape::hasSpecularFlag,
+    &MeshShape::hasGreyscaleToPaletteFlag, &MeshShape::hasHairSoftLightingFlag, &MeshShape::hasSoftLightingFlag,
+    &MeshShape::hasEnvMapFlag, &MeshShape::hasEyeEnvMapFlag, &MeshShape::receiveShadows, &MeshShape::castShadows,
+    &MeshShape::hasOwnEmitFlag, &MeshShape::has_specular_map,
+};
+const float MeshShape::* const kCompiledShapeFloats[] = {
+    &MeshShape::alphaThreshold, &MeshShape::materialAlpha, &MeshShape::glossiness, &MeshShape::specularStrength,
+    &MeshShape::rimlightPower, &MeshShape::subsurfaceRolloff, &MeshShape::envMapScale, &MeshShape::eyeCubemapScale,
+    &MeshShape::greyscaleToPaletteScale, &MeshShape::emissiveMultiple,
+};
+static_assert(std::size(kCompiledShapeFlags) <= 32, "Shape flags are stored in one uint32_t");
+
+struct CompiledWriter {
+    std::vector<char>& out;
+
+    void bytes(const void* data, size_t size) {
+        const char* p = static_cast<const char*>(data);
+        out.insert(out.end(), p, p + size);
+    }
+    template <typename T> void put(const T& value) { bytes(&value, sizeof(T)); }
+    void string(const std::string& value) {
+        put(static_cast<uint32_t>(value.size()));
+        bytes(value.data(), value.size());
+    }
+    void align(size_t alignment) { out.resize((out.size() + alignment - 1) & ~(alignment - 1), 0); }
+};
+
+// Bounds-checked reads; after the first overrun every read fails and 'ok' stays false.
+struct CompiledReader {
+    const char* data;
+    size_t size;
+    size_t offset = 0;
+    bool ok = true;
+
+    const char* bytes(size_t count) {
+        if (!ok || count > size - offset) {
+            ok = false;
+            return nullptr;
+        }
+        const char* p = data + offset;
+        offset += count;
+        return p;
+    }
+    template <typename T> T get() {
+        T value{};
+        if (const char* p = bytes(sizeof(T))) std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+    std::string string() {
+        uint32_t length = get<uint32_t>();
+        const char* p = bytes(length);
+        return p ? std::string(p, length) : std::string();
+    }
+    void align(size_t alignment) {
+        size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+        if (aligned > size) ok = false;
+        else offset = aligned;
+    }
+};
+
+void WriteCompiledShape(std::vector<char>& out, const MeshShape& mesh, RenderPass pass, const std::vector<std::string>& texturePaths,
+    const PackedVertexLayout& layout, const std::vector<char>& vertices, const std::vector<char>& indices, size_t indexCount) {
+    CompiledWriter w{ out };
+    w.put(pass);
+    w.string(mesh.name);
+
+    uint32_t flags = 0;
+    for (size_t i = 0; i < std::size(kCompiledShapeFlags); ++i) {
+        if (mesh.*kCompiledShapeFlags[i]) flags |= 1u << i;
+    }
+    w.put(flags);
+    for (auto field : kCompiledShapeFloats) w.put(mesh.*field);
+    w.put(mesh.tintColor);
+    w.put(mesh.emissiveColor);
+    w.put(mesh.boundsCenter_nifRootSpace_zUp);
+    w.put(static_cast<uint32_t>(mesh.srcBlend));
+    w.put(static_cast<uint32_t>(mesh.dstBlend));
+    w.put(mesh.shapeLocalToNifRoot_transform_zUp);
+
+    w.put(static_cast<uint32_t>(mesh.skinToBonePose_transforms_zUp.size()));
+    w.bytes(mesh.skinToBonePose_transforms_zUp.data(), mesh.skinToBonePose_transforms_zUp.size() * sizeof(glm::mat4));
+
+    w.put(static_cast<uint32_t>(texturePaths.size()));
+    for (const auto& path : texturePaths) w.string(path);
+
+    w.put(static_cast<uint8_t>(layout.colors));
+    w.put(static_cast<uint8_t>(layout.skinning));
+    w.put(static_cast<uint8_t>(layout.wideBoneIds));
+    w.put(static_cast<uint32_t>(layout.stride));
+    w.put(static_cast<uint32_t>(layout.colorOffset));
+    w.put(static_cast<uint32_t>(layout.boneIdOffset));
+    w.put(static_cast<uint32_t>(layout.weightOffset));
+
+    w.put(static_cast<uint64_t>(vertices.size()));
+    w.put(static_cast<uint32_t>(indexCount));
+    w.put(static_cast<uint32_t>(mesh.indexType));
+    w.align(16);
+    w.bytes(vertices.data(), vertices.size());
+    w.align(16);
+    w.bytes(indices.data(), indices.size());
 }
 
 // --- MeshShape Methods ---
@@ -239,7 +609,7 @@ static nifly::NiNode* FindSkeletonRootLCA(const nifly::NifFile& nif, nifly::NiSk
 void MeshShape::draw() const {
     if (VAO != 0 && indexCount > 0) {
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, 0);
+        glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
         glBindVertexArray(0);
     }
 }
@@ -251,6 +621,7 @@ void MeshShape::cleanup() {
         glDeleteBuffers(1, &EBO);
         VAO = VBO = EBO = 0;
         indexCount = 0;
+        vertexBytes = indexBytes = 0;
     }
 }
 
@@ -262,15 +633,36 @@ NifModel::~NifModel() {
     cleanup();
 }
 
-bool NifModel::load(const std::vector<char>& data, const std::string& nifPath, TextureManager& textureManager, const Skeleton* skeleton) {
-    cleanup();
-    bool debugMode = true; // Set to true to enable debug output
+std::shared_ptr<nifly::NifFile> NifModel::parse(const std::vector<char>& data) {
+    return parse(data.data(), data.size());
+}
 
-    std::stringstream nifStream(std::string(data.begin(), data.end()));
-    if (nif.Load(nifStream) != 0) { // <-- Load from memory stream
+std::shared_ptr<nifly::NifFile> NifModel::parse(const char* data, size_t size) {
+    auto parsed = std::make_shared<nifly::NifFile>();
+    MemoryInputStream nifStream(data, size); // Reads the buffer in place.
+    if (parsed->Load(nifStream) != 0) {
+        return nullptr;
+    }
+    return parsed;
+}
+
+bool NifModel::load(const std::vector<char>& data, const std::string& nifPath, TextureManager& textureManager, const Skeleton* skeleton) {
+    std::shared_ptr<nifly::NifFile> parsed = parse(data);
+    if (!parsed) {
+        cleanup();
         std::cerr << "Error: Failed to load NIF from memory: " << nifPath << std::endl;
         return false;
     }
+    return load(std::move(parsed), nifPath, textureManager, skeleton);
+}
+
+bool NifModel::load(std::shared_ptr<nifly::NifFile> parsed, const std::string& nifPath, TextureManager& textureManager, const Skeleton* skeleton, std::vector<char>* compiled) {
+    cleanup();
+    textureOwner = &textureManager;
+    bool debugMode = true; // Set to true to enable debug output
+
+    // Only needed while the model is built; released before returning.
+    nifly::NifFile& nif = *parsed;
 
     const auto& shapeList = nif.GetShapes();
     if (shapeList.empty()) {
@@ -278,6 +670,21 @@ bool NifModel::load(const std::vector<char>& data, const std::string& nifPath, T
         return true;
     }
 
+    // The compiled copy starts with the model header, filled in once the bounds are known.
+    uint32_t compiledShapeCount = 0;
+    if (compiled) {
+        compiled->assign(sizeof(CompiledModelHeader), 0);
+    }
+
+    // Parents and root transforms of every node, so the transform and skeleton lookups below
+    // don't each rescan the block list.
+    const SceneGraphTable sceneGraph(nif);
+
+    // --- Texture Prefetch ---
+    // Gather every texture referenced by the NIF up front so extraction and DDS parsing run on
+    // worker threads while the geometry is processed. Stage 5 then only uploads the results.
+    textureManager.prefetchTextures(listTextures(nif)); // Deduplicates and skips cached paths.
+
     // Reset bounds for the new model. These are calculated in the NIF's Z-up root space.
     minBounds_nifRootSpace_zUp = glm::vec3(std::numeric_limits<float>::max());
     maxBounds_nifRootSpace_zUp = glm::vec3(std::numeric_limits<float>::lowest());
@@ -363,7 +770,7 @@ bool NifModel::load(const std::vector<char>& data, const std::string& nifPath, T
     for (auto* shape : shapeList) {
         if (!shape->IsSkinned()) continue;
         // This is the shape's transform from its local space to the NIF root space (Z-up).
-        nifly::MatTransform shapeToNifRoot_transform_zUp_nifly = GetAVObjectTransformToGlobal(nif, shape, false);
+        nifly::MatTransform shapeToNifRoot_transform_zUp_nifly = sceneGraph.toGlobal(shape);
         // A hybrid model has skinned parts with no transform, but their vertices are far from the origin.
         if (shapeToNifRoot_transform_zUp_nifly.IsNearlyEqualTo(nifly::MatTransform())) {
             const auto* v = nif.GetVertsForShape(shape);
@@ -385,7 +792,7 @@ found_head:
     // relative to the main head mesh. It is in the NIF's Z-up root space.
     nifly::MatTransform accessoryToNifRoot_offset_zUp_nifly;
     if (primaryHeadShape) {
-        accessoryToNifRoot_offset_zUp_nifly = GetAVObjectTransformToGlobal(nif, const_cast<nifly::NiShape*>(primaryHeadShape), false);
+        accessoryToNifRoot_offset_zUp_nifly = sceneGraph.toGlobal(primaryHeadShape);
         if (debugMode) std::cout << "[NIF Analysis] Using transform from primary head '" << primaryHeadShapeName << "' as the accessory offset.\n";
     }
     else {
@@ -396,7 +803,7 @@ found_head:
                 bool found = false;
                 for (const auto& partition : skinInst->partitions) {
                     if (isHeadDismemberPartition(partition.partID)) {
-                        accessoryToNifRoot_offset_zUp_nifly = GetAVObjectTransformToGlobal(nif, shape, false);
+                        accessoryToNifRoot_offset_zUp_nifly = sceneGraph.toGlobal(shape);
                         if (debugMode) std::cout << "[NIF Analysis] Using fallback accessory offset from shape '" << shape->name.get() << "'.\n";
                         found = true;
                         break;
@@ -413,9 +820,9 @@ found_head:
     for (auto* shape : shapeList) {
         if (shape->IsSkinned()) {
             if (auto* skinInst = nif.GetHeader().GetBlock<nifly::NiSkinInstance>(shape->SkinInstanceRef())) {
-                auto* skelRootNode = FindSkeletonRootLCA(nif, skinInst);
+                auto* skelRootNode = FindSkeletonRootLCA(nif, sceneGraph, skinInst);
                 if (skelRootNode) {
-                    skeletonRootToNifRoot_transform_zUp_nifly = GetAVObjectTransformToGlobal(nif, skelRootNode);
+                    skeletonRootToNifRoot_transform_zUp_nifly = sceneGraph.toGlobal(skelRootNode);
                     if (debugMode) std::cout << "[NIF Analysis] Found skeleton root node: " << skelRootNode->name.get() << "\n";
                 }
             }
@@ -423,23 +830,37 @@ found_head:
         }
     }
 
-    for (auto* niShape : shapeList) {
+    // --- Stages 1-4: per-shape mesh preparation ---
+    // Copying the vertex data, expanding the skin partitions and computing the posed bounds only
+    // read the parsed NIF and the skeleton, so each shape is prepared on a worker thread. The
+    // results come back as CPU-side packets that this (GL) thread uploads in shape order below.
+    auto prepareShape = [&](nifly::NiShape* niShape) {
+        ShapePacket packet;
+        std::ostringstream log; // Printed in shape order by the GL thread, so logs don't interleave.
+        packet.shape = niShape;
         auto start_preprocess = std::chrono::high_resolution_clock::now();
 
-        if (debugMode) std::cout << "\n--- Processing Shape: " << niShape->name.get() << " ---\n";
-        if (!niShape || (niShape->flags & 1)) continue;
+        if (debugMode) log << "\n--- Processing Shape: " << niShape->name.get() << " ---\n";
+        if (!niShape || (niShape->flags & 1)) {
+            packet.log = log.str();
+            return packet;
+        }
 
         // --- Stage 1: Nifly Vertex/Property Parsing ---
         auto start_stage1 = std::chrono::high_resolution_clock::now();
         const auto* vertices = nif.GetVertsForShape(niShape);
-        if (!vertices || vertices->empty()) continue;
+        if (!vertices || vertices->empty()) {
+            packet.log = log.str();
+            return packet;
+        }
 
-        const auto* colors = nif.GetColorsForShape(niShape->name.get());
+        const auto* colors = nif.GetColorsForShape(niShape);
         const auto* normals = nif.GetNormalsForShape(niShape);
         const auto* uvs = nif.GetUvsForShape(niShape);
         const auto* tangents = nif.GetTangentsForShape(niShape);
         const auto* bitangents = nif.GetBitangentsForShape(niShape);
         auto end_stage1 = std::chrono::high_resolution_clock::now();
+        packet.stage1 = end_stage1 - start_stage1;
 
         // --- Stage 2: Copying Data to Local Buffers ---
         auto start_stage2 = std::chrono::high_resolution_clock::now();
@@ -461,8 +882,9 @@ found_head:
             if (bitangents && i < bitangents->size()) vertexData[i].bitangent = glm::vec3((*bitangents)[i].x, (*bitangents)[i].y, (*bitangents)[i].z);
         }
         auto end_stage2 = std::chrono::high_resolution_clock::now();
+        packet.stage2 = end_stage2 - start_stage2;
 
-        MeshShape mesh;
+        MeshShape& mesh = packet.mesh;
         mesh.name = niShape->name.get();
         std::string shapeName = niShape->name.get();
 
@@ -478,10 +900,10 @@ found_head:
         nifly::MatTransform finalShapeToNifRoot_transform_zUp_nifly; // Default to identity
 
         if (isHybridModel && niShape->IsSkinned()) {
-            if (debugMode) std::cout << "    [Debug] Using identity transform for hybrid skinned part.\n";
+            if (debugMode) log << "    [Debug] Using identity transform for hybrid skinned part.\n";
         }
         else {
-            finalShapeToNifRoot_transform_zUp_nifly = GetAVObjectTransformToGlobal(nif, niShape, false);
+            finalShapeToNifRoot_transform_zUp_nifly = sceneGraph.toGlobal(niShape);
             bool isPrimaryHead = (shapeName == primaryHeadShapeName);
 
             // --- HEURISTIC FOR MISPLACED ACCESSORIES ---
@@ -494,12 +916,12 @@ found_head:
             // with either a pure-identity or a rotation-only transform.
             const float ZERO_TRANSLATION_THRESHOLD = 0.1f;
             if (!isPrimaryHead && finalShapeToNifRoot_transform_zUp_nifly.translation.length() < ZERO_TRANSLATION_THRESHOLD) {
-                if (debugMode) std::cout << "    [Debug] Shape '" << shapeName << "' has a near-zero translation and is not the primary head. Applying accessory offset.\n";
+                if (debugMode) log << "    [Debug] Shape '" << shapeName << "' has a near-zero translation and is not the primary head. Applying accessory offset.\n";
                 finalShapeToNifRoot_transform_zUp_nifly = accessoryToNifRoot_offset_zUp_nifly;
             }
             // This handles a rare case where the primary head itself might be at the origin, falling back to the skeleton's transform.
             else if (isPrimaryHead && finalShapeToNifRoot_transform_zUp_nifly.translation.length() < ZERO_TRANSLATION_THRESHOLD) {
-                if (debugMode) std::cout << "    [Debug] Primary head part '" << shapeName << "' has a near-zero translation. Applying skeleton root as fallback.\n";
+                if (debugMode) log << "    [Debug] Primary head part '" << shapeName << "' has a near-zero translation. Applying skeleton root as fallback.\n";
                 finalShapeToNifRoot_transform_zUp_nifly = skeletonRootToNifRoot_transform_zUp_nifly;
             }
         }
@@ -507,7 +929,7 @@ found_head:
         mesh.shapeLocalToNifRoot_transform_zUp = glm::transpose(glm::make_mat4(&finalShapeToNifRoot_transform_zUp_nifly.ToMatrix()[0]));
 
         if (debugMode) {
-            std::cout << "    [Matrix Calc] Shape Local -> NIF Root Transform for '" << mesh.name << "' (GLM Z-up, Col-major):\n" << glm::to_string(mesh.shapeLocalToNifRoot_transform_zUp) << std::endl;
+            log << "    [Matrix Calc] Shape Local -> NIF Root Transform for '" << mesh.name << "' (GLM Z-up, Col-major):\n" << glm::to_string(mesh.shapeLocalToNifRoot_transform_zUp) << std::endl;
         }
 
         // --- Stage 3: GPU Skinning Data Extraction ---
@@ -518,7 +940,7 @@ found_head:
             auto* skinPartition = nif.GetHeader().GetBlock<nifly::NiSkinPartition>(skinInst->skinPartitionRef);
 
             if (skinInst && skinData && skinPartition) {
-                if (debugMode) std::cout << "    [Debug] Extracting skinning data for GPU...\n";
+                if (debugMode) log << "    [Debug] Extracting skinning data for GPU...\n";
 
                 mesh.skinToBonePose_transforms_zUp.resize(skinData->bones.size());
                 auto boneRefIt = skinInst->boneRefs.begin();
@@ -538,13 +960,13 @@ found_head:
                     }
                     else {
                         // This is the bone's transform from its local space to the NIF root space (Z-up, row-major).
-                        auto boneToNifRoot_transform_zUp_nifly = GetAVObjectTransformToGlobal(nif, boneNode, false);
+                        auto boneToNifRoot_transform_zUp_nifly = sceneGraph.toGlobal(boneNode);
                         // Convert to GLM matrix (Z-up, column-major).
                         boneToWorld_transform = glm::transpose(glm::make_mat4(&boneToNifRoot_transform_zUp_nifly.ToMatrix()[0]));
                     }
 
                     if (debugMode) {
-                        std::cout << "        [Skinning Matrix] Bone '" << boneName << "' To World Transform (GLM Z-up, Col-major):\n" << glm::to_string(boneToWorld_transform) << std::endl;
+                        log << "        [Skinning Matrix] Bone '" << boneName << "' To World Transform (GLM Z-up, Col-major):\n" << glm::to_string(boneToWorld_transform) << std::endl;
                     }
 
                     // This is the inverse bind pose matrix from the nifly data (Z-up, row-major).
@@ -554,14 +976,14 @@ found_head:
                     glm::mat4 skinToBone_transform_zUp_glm = glm::transpose(glm::make_mat4(&skinToBone_transform_zUp_nifly.ToMatrix()[0]));
 
                     if (debugMode) {
-                        std::cout << "        [Skinning Matrix] Inverse Bind Pose for Bone #" << i << " (GLM Z-up, Col-major):\n" << glm::to_string(skinToBone_transform_zUp_glm) << std::endl;
+                        log << "        [Skinning Matrix] Inverse Bind Pose for Bone #" << i << " (GLM Z-up, Col-major):\n" << glm::to_string(skinToBone_transform_zUp_glm) << std::endl;
                     }
 
                     // The final matrix for the shader is: Bone's World Transform * Inverse Bind Pose Transform.
                     mesh.skinToBonePose_transforms_zUp[i] = boneToWorld_transform * skinToBone_transform_zUp_glm;
 
                     if (debugMode) {
-                        std::cout << "        [Skinning Matrix] Final Shader Matrix for Bone #" << i << " (GLM Z-up, Col-major):\n" << glm::to_string(mesh.skinToBonePose_transforms_zUp[i]) << std::endl;
+                        log << "        [Skinning Matrix] Final Shader Matrix for Bone #" << i << " (GLM Z-up, Col-major):\n" << glm::to_string(mesh.skinToBonePose_transforms_zUp[i]) << std::endl;
                     }
                 }
 
@@ -586,18 +1008,20 @@ found_head:
             }
         }
         auto end_stage3 = std::chrono::high_resolution_clock::now();
+        packet.stage3 = end_stage3 - start_stage3;
 
         // Get the shader properties early to determine if the mesh is skinned.
         // This is critical for the bounds calculation in Stage 4.
         // --- Shader Property and Flag Parsing ---
         // Get all shader-related properties at once to avoid redundant checks.
         const nifly::NiShader* shader = nif.GetShader(niShape);
+        packet.shader = shader;
         if (shader) {
             mesh.isModelSpace = shader->IsModelSpace();
             // --- MODIFIED: Get alpha from the material property itself using the virtual function. ---
             mesh.materialAlpha = shader->GetAlpha();
             if (debugMode) {
-                std::cout << "    [Material] Shape '" << mesh.name << "' has material alpha: " << mesh.materialAlpha << "\n";
+                log << "    [Material] Shape '" << mesh.name << "' has material alpha: " << mesh.materialAlpha << "\n";
             }
             // --- END MODIFICATION ---
             if (const auto* bslsp = dynamic_cast<const nifly::BSLightingShaderProperty*>(shader)) {
@@ -608,7 +1032,7 @@ found_head:
                 if (flags.SLSF1_Skinned) {
                     mesh.isSkinned = true;
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Skinned.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Skinned.\n";
                     }
                 }
 
@@ -616,26 +1040,26 @@ found_head:
                 // Get all shader-related properties at once to avoid redundant checks.
                 // This is done before bounds calculation because the 'isSkinned' flag is needed.
                 if (debugMode) {
-                    std::cout << "    [Flag Parse] Parsed shader flags for shape '" << mesh.name << "':\n";
-                    std::cout << "    [Flag Parse] shaderFlags1 (raw: " << bslsp->shaderFlags1 << "): " << GetFlagsString(flags, 1) << "\n";
-                    std::cout << "    [Flag Parse] shaderFlags2 (raw: " << bslsp->shaderFlags2 << "): " << GetFlagsString(flags, 2) << "\n";
+                    log << "    [Flag Parse] Parsed shader flags for shape '" << mesh.name << "':\n";
+                    log << "    [Flag Parse] shaderFlags1 (raw: " << bslsp->shaderFlags1 << "): " << GetFlagsString(flags, 1) << "\n";
+                    log << "    [Flag Parse] shaderFlags2 (raw: " << bslsp->shaderFlags2 << "): " << GetFlagsString(flags, 2) << "\n";
                 }
 
                 mesh.hasHairSoftLightingFlag = flags.SLSF1_Hair_Soft_Lighting;
                 mesh.hasSoftLightingFlag = flags.SLSF2_Soft_Lighting;
                 if (debugMode) {
                     if (mesh.hasHairSoftLightingFlag) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Hair_Soft_Lighting ENABLED.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Hair_Soft_Lighting ENABLED.\n";
                     }
                     if (mesh.hasSoftLightingFlag) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF2_Soft_Lighting ENABLED.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF2_Soft_Lighting ENABLED.\n";
                     }
                 }
 
                 if (flags.SLSF1_Specular) {
                     mesh.hasSpecularFlag = true;
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Specular.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Specular.\n";
                     }
                 }
 
@@ -643,26 +1067,26 @@ found_head:
                     mesh.hasEnvMapFlag = true;
                     mesh.envMapScale = bslsp->environmentMapScale;
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Environment_Mapping.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Environment_Mapping.\n";
                     }
                 }
 
                 if (flags.SLSF1_Eye_Environment_Mapping) {
                     mesh.hasEyeEnvMapFlag = true;
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Eye_Environment_Mapping.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Eye_Environment_Mapping.\n";
                     }
                 }
 
                 if (flags.SLSF2_Vertex_Colors) {
                     mesh.hasVertexColors = true;
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF2_Vertex_Colors ENABLED.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF2_Vertex_Colors ENABLED.\n";
                     }
                 }
                 else {
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' does not use vertex colors.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' does not use vertex colors.\n";
                     }
                 }
 
@@ -672,14 +1096,14 @@ found_head:
                 if (flags.SLSF1_Receive_Shadows) {
                     mesh.receiveShadows = true;
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Receive_Shadows ENABLED.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Receive_Shadows ENABLED.\n";
                     }
                 }
 
                 if (flags.SLSF1_Cast_Shadows) {
                     mesh.castShadows = true;
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Cast_Shadows ENABLED.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Cast_Shadows ENABLED.\n";
                     }
                 }
 
@@ -689,7 +1113,7 @@ found_head:
                     mesh.emissiveColor = glm::vec3(color.x, color.y, color.z);
                     mesh.emissiveMultiple = bslsp->emissiveMultiple;
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Own_Emit ENABLED.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Own_Emit ENABLED.\n";
                     }
                 }
 
@@ -699,7 +1123,7 @@ found_head:
                     const auto& color = bslsp->hairTintColor;
                     mesh.tintColor = glm::vec3(color.x, color.y, color.z);
                     if (debugMode) {
-                        std::cout << "    [Shader Type] Shape '" << mesh.name << "' has Hair Tint enabled.\n";
+                        log << "    [Shader Type] Shape '" << mesh.name << "' has Hair Tint enabled.\n";
                     }
                 }
                 else if (shaderType == nifly::BSLSP_SKINTINT || shaderType == nifly::BSLSP_FACE) {
@@ -707,31 +1131,31 @@ found_head:
                     const auto& color = bslsp->skinTintColor;
                     mesh.tintColor = glm::vec3(color.x, color.y, color.z);
                     if (debugMode) {
-                        std::cout << "    [Shader Type] Shape '" << mesh.name << "' has Skin/Face Tint enabled.\n";
+                        log << "    [Shader Type] Shape '" << mesh.name << "' has Skin/Face Tint enabled.\n";
                     }
                 }
 
                 mesh.glossiness = bslsp->glossiness;
                 mesh.specularStrength = bslsp->specularStrength;
                 if (debugMode) {
-                    std::cout << "    [Material] Shape '" << mesh.name << "' has Glossiness: " << mesh.glossiness << "\n";
-                    std::cout << "    [Material] Shape '" << mesh.name << "' has Specular Strength: " << mesh.specularStrength << "\n";
+                    log << "    [Material] Shape '" << mesh.name << "' has Glossiness: " << mesh.glossiness << "\n";
+                    log << "    [Material] Shape '" << mesh.name << "' has Specular Strength: " << mesh.specularStrength << "\n";
                 }
 
                 // --- NEW: Read advanced lighting properties from the NIF material ---
                 mesh.rimlightPower = bslsp->rimlightPower;
                 mesh.subsurfaceRolloff = bslsp->subsurfaceRolloff;
                 if (debugMode) {
-                    std::cout << "    [Material] Rim Light Power read: " << mesh.rimlightPower << "\n";
-                    std::cout << "    [Material] Subsurface Rolloff read: " << mesh.subsurfaceRolloff << "\n";
+                    log << "    [Material] Rim Light Power read: " << mesh.rimlightPower << "\n";
+                    log << "    [Material] Subsurface Rolloff read: " << mesh.subsurfaceRolloff << "\n";
                 }
                 // --- END NEW BLOCK ---
 
                 if (shaderType == nifly::BSLSP_EYE) {
                     mesh.eyeCubemapScale = bslsp->eyeCubemapScale;
                     if (debugMode) {
-                        std::cout << "    [Shader Type] Shape '" << mesh.name << "' has Eye shader type.\n";
-                        std::cout << "    [Material] Eye Cubemap Scale: " << mesh.eyeCubemapScale << "\n";
+                        log << "    [Shader Type] Shape '" << mesh.name << "' has Eye shader type.\n";
+                        log << "    [Material] Eye Cubemap Scale: " << mesh.eyeCubemapScale << "\n";
                     }
                 }
 
@@ -739,13 +1163,13 @@ found_head:
                     mesh.hasGreyscaleToPaletteFlag = true;
                     mesh.greyscaleToPaletteScale = bslsp->grayscaleToPaletteScale;
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Greyscale_To_Palette_Color ENABLED.\n";
-                        std::cout << "    [Material] Greyscale to Palette Scale: " << mesh.greyscaleToPaletteScale << "\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' has flag SLSF1_Greyscale_To_Palette_Color ENABLED.\n";
+                        log << "    [Material] Greyscale to Palette Scale: " << mesh.greyscaleToPaletteScale << "\n";
                     }
                 }
                 else {
                     if (debugMode) {
-                        std::cout << "    [Flag Detect] Shape '" << mesh.name << "' does not have greyscale-to-palette flag.\n";
+                        log << "    [Flag Detect] Shape '" << mesh.name << "' does not have greyscale-to-palette flag.\n";
                     }
                 }
             }
@@ -756,48 +1180,26 @@ found_head:
 
         // This is the base transformation for the current, un-skinned shape.
         // It transforms from the shape's local model space to the NIF root space (Z-up).
-        glm::mat4 shapeLocalToNifRoot_transform_zUp_glm = mesh.shapeLocalToNifRoot_transform_zUp;
-
-        glm::vec3 shapeMinBounds_nifRootSpace_zUp(std::numeric_limits<float>::max());
-        glm::vec3 shapeMaxBounds_nifRootSpace_zUp(std::numeric_limits<float>::lowest());
-
-        std::vector<glm::vec3> posedVertices_nifRootSpace_zUp;
-        posedVertices_nifRootSpace_zUp.reserve(vertexData.size());
+        const Skinning::Affine shapeLocalToNifRoot_transform_zUp = ToAffine(mesh.shapeLocalToNifRoot_transform_zUp);
 
+        // Skinned vertices are posed as the weighted average of their bones' transforms. The kernel
+        // folds each posed vertex straight into the bounds and centroid instead of storing it.
+        std::vector<Skinning::Affine> skinToBonePose_transforms_zUp;
         if (mesh.isSkinned) { // <-- This check will now work correctly!
-            if (debugMode) std::cout << "    [Debug] Performing precise, pose-aware bounds calculation.\n";
-            for (const auto& vert : vertexData) {
-                // Vertex position in the mesh's local bind-pose model space (Z-up).
-                glm::vec4 vertexPos_modelSpace_zUp(vert.pos, 1.0f);
-                // This will hold the final posed vertex position.
-                glm::vec4 posedVertexPos_modelSpace_zUp(0.0f);
-
-                float totalWeight = vert.weights.x + vert.weights.y + vert.weights.z + vert.weights.w;
-                if (totalWeight > 0.0f) {
-                    // This matrix is the weighted average of the bone transforms for this vertex.
-                    // It transforms the vertex from bind-pose model space to the final animated pose space (Z-up).
-                    glm::mat4 skinBindToPose_transform_zUp = (vert.weights.x * mesh.skinToBonePose_transforms_zUp[vert.boneIDs.x] +
-                        vert.weights.y * mesh.skinToBonePose_transforms_zUp[vert.boneIDs.y] +
-                        vert.weights.z * mesh.skinToBonePose_transforms_zUp[vert.boneIDs.z] +
-                        vert.weights.w * mesh.skinToBonePose_transforms_zUp[vert.boneIDs.w]) / totalWeight;
-                    posedVertexPos_modelSpace_zUp = skinBindToPose_transform_zUp * vertexPos_modelSpace_zUp;
-                }
-                else {
-                    posedVertexPos_modelSpace_zUp = vertexPos_modelSpace_zUp;
-                }
-                // Transform the final posed vertex into the NIF's root space for bounds calculation.
-                posedVertices_nifRootSpace_zUp.push_back(glm::vec3(shapeLocalToNifRoot_transform_zUp_glm * posedVertexPos_modelSpace_zUp));
+            if (debugMode) log << "    [Debug] Performing precise, pose-aware bounds calculation.\n";
+            skinToBonePose_transforms_zUp.reserve(mesh.skinToBonePose_transforms_zUp.size());
+            for (const auto& boneTransform : mesh.skinToBonePose_transforms_zUp) {
+                skinToBonePose_transforms_zUp.push_back(ToAffine(boneTransform));
             }
         }
         else {
-            if (debugMode) std::cout << "    [Debug] Performing bounds calculation for unskinned mesh.\n";
-            for (const auto& vert : vertexData) {
-                // For unskinned meshes, just transform the vertex into the NIF's root space.
-                posedVertices_nifRootSpace_zUp.push_back(glm::vec3(shapeLocalToNifRoot_transform_zUp_glm * glm::vec4(vert.pos, 1.0f)));
-            }
+            if (debugMode) log << "    [Debug] Performing bounds calculation for unskinned mesh.\n";
         }
+        Skinning::StreamStorage skinningStreams = MakeSkinningStreams(vertexData, skinToBonePose_transforms_zUp.size());
+        const Skinning::PosedBounds posed = Skinning::posedBounds(skinningStreams.view(), skinToBonePose_transforms_zUp.data(),
+            skinToBonePose_transforms_zUp.size(), shapeLocalToNifRoot_transform_zUp);
 
-        bool isAccessoryPart = false;
+        bool& isAccessoryPart = packet.isAccessoryPart;
         if (auto* skinInst = nif.GetHeader().GetBlock<nifly::BSDismemberSkinInstance>(niShape->SkinInstanceRef())) {
             for (const auto& partition : skinInst->partitions) {
                 if (partition.partID == 131 || partition.partID == 130) { // SBP_131_HAIR or SBP_31_HAIR
@@ -814,89 +1216,140 @@ found_head:
             }
         }
 
-        for (const auto& pos : posedVertices_nifRootSpace_zUp) {
-            minBounds_nifRootSpace_zUp = glm::min(minBounds_nifRootSpace_zUp, pos);
-            maxBounds_nifRootSpace_zUp = glm::max(maxBounds_nifRootSpace_zUp, pos);
-            shapeMinBounds_nifRootSpace_zUp = glm::min(shapeMinBounds_nifRootSpace_zUp, pos);
-            shapeMaxBounds_nifRootSpace_zUp = glm::max(shapeMaxBounds_nifRootSpace_zUp, pos);
-            if (!isAccessoryPart) {
-                headMinBounds_nifRootSpace_zUp = glm::min(headMinBounds_nifRootSpace_zUp, pos);
-                headMaxBounds_nifRootSpace_zUp = glm::max(headMaxBounds_nifRootSpace_zUp, pos);
-            }
+        // The model-wide and head bounds are min/max reductions of these, merged in shape order
+        // once every packet is back.
+        const glm::vec3 shapeMinBounds_nifRootSpace_zUp = glm::make_vec3(posed.min);
+        const glm::vec3 shapeMaxBounds_nifRootSpace_zUp = glm::make_vec3(posed.max);
+        packet.minBounds_nifRootSpace_zUp = shapeMinBounds_nifRootSpace_zUp;
+        packet.maxBounds_nifRootSpace_zUp = shapeMaxBounds_nifRootSpace_zUp;
+        packet.isPrimaryHead = (shapeName == primaryHeadShapeName);
+
+        if (debugMode) {
+            log << "    [Shape Bounds] '" << shapeName << "' Min: (" << shapeMinBounds_nifRootSpace_zUp.x << ", " << shapeMinBounds_nifRootSpace_zUp.y << ", " << shapeMinBounds_nifRootSpace_zUp.z << ")\n";
+            log << "    [Shape Bounds] '" << shapeName << "' Max: (" << shapeMaxBounds_nifRootSpace_zUp.x << ", " << shapeMaxBounds_nifRootSpace_zUp.y << ", " << shapeMaxBounds_nifRootSpace_zUp.z << ")\n";
         }
 
-        // If this shape was identified as the primary head, store its final posed bounds.
-        if (shapeName == primaryHeadShapeName) {
-            headShapeMinBounds_nifRootSpace_zUp = shapeMinBounds_nifRootSpace_zUp;
-            headShapeMaxBounds_nifRootSpace_zUp = shapeMaxBounds_nifRootSpace_zUp;
-            bHasHeadShapeBounds = true;
-            if (debugMode) {
-                std::cout << "    [Head Bounds] Stored final posed bounds for primary head shape '" << shapeName << "'.\n";
-            }
+        mesh.boundsCenter_nifRootSpace_zUp = (shapeMinBounds_nifRootSpace_zUp + shapeMaxBounds_nifRootSpace_zUp) * 0.5f;
+
+        if (mesh.isEye) {
+            packet.eyeCenter_nifRootSpace_zUp = glm::make_vec3(posed.centroid);
+        }
+        auto end_stage4 = std::chrono::high_resolution_clock::now();
+        packet.stage4 = end_stage4 - start_stage4;
+
+        // The CPU half of the upload: the index list, reordered for the GPU's vertex cache,
+        // overdraw and vertex fetch, and the packed vertex stream in the matching order.
+        std::vector<nifly::Triangle> triangles;
+        niShape->GetTriangles(triangles);
+        std::vector<uint32_t> indices;
+        indices.reserve(triangles.size() * 3);
+        for (const auto& tri : triangles) {
+            // A triangle past the end of the vertex list can't be drawn (or optimised); skip it.
+            if (tri.p1 >= vertexData.size() || tri.p2 >= vertexData.size() || tri.p3 >= vertexData.size()) continue;
+            indices.push_back(tri.p1);
+            indices.push_back(tri.p2);
+            indices.push_back(tri.p3);
+        }
+        packet.acmrBefore = IndexOptimizer::acmr(indices, vertexData.size());
+        // Blended shapes are drawn without sorting their triangles, so the authored order decides
+        // what shows through what; only renumber their vertices. This is the same test the GL
+        // thread uses to pick the transparent pass: the NiAlphaProperty's blend bit or, without
+        // one, a material alpha below 1.
+        const nifly::NiAlphaProperty* alphaProperty = nif.GetAlphaProperty(niShape);
+        const bool blended = alphaProperty ? (alphaProperty->flags & 1) != 0 : mesh.materialAlpha < 1.0f;
+        if (!blended) {
+            IndexOptimizer::optimizeVertexCache(indices, vertexData.size());
+            IndexOptimizer::optimizeOverdraw(indices, &vertexData[0].pos.x, sizeof(Vertex), vertexData.size());
+        }
+        const std::vector<uint32_t> remap = IndexOptimizer::optimizeVertexFetch(indices, vertexData.size());
+        packet.acmrAfter = IndexOptimizer::acmr(indices, vertexData.size());
+        std::vector<Vertex> fetchOrdered(vertexData.size());
+        for (size_t i = 0; i < vertexData.size(); ++i) {
+            fetchOrdered[remap[i]] = vertexData[i];
         }
 
+        packet.vertexLayout = MakePackedVertexLayout(fetchOrdered, colors && !colors->empty(), mesh.isSkinned);
+        packet.vertices = PackVertices(fetchOrdered, packet.vertexLayout);
+        packet.indices = PackIndices(indices, fetchOrdered.size(), mesh.indexType);
+        packet.indexCount = indices.size();
         if (debugMode) {
-            std::cout << "    [Shape Bounds] '" << shapeName << "' Min: (" << shapeMinBounds_nifRootSpace_zUp.x << ", " << shapeMinBounds_nifRootSpace_zUp.y << ", " << shapeMinBounds_nifRootSpace_zUp.z << ")\n";
-            std::cout << "    [Shape Bounds] '" << shapeName << "' Max: (" << shapeMaxBounds_nifRootSpace_zUp.x << ", " << shapeMaxBounds_nifRootSpace_zUp.y << ", " << shapeMaxBounds_nifRootSpace_zUp.z << ")\n";
+            log << "    [Index Opt] '" << shapeName << "': ACMR " << packet.acmrBefore << " -> " << packet.acmrAfter << " over "
+                << indices.size() / 3 << " triangles, " << (mesh.indexType == GL_UNSIGNED_INT ? 32 : 16) << "-bit indices\n";
         }
 
-        mesh.boundsCenter_nifRootSpace_zUp = (shapeMinBounds_nifRootSpace_zUp + shapeMaxBounds_nifRootSpace_zUp) * 0.5f;
+        packet.skipped = false;
+        packet.log = log.str();
+        packet.preprocess = std::chrono::high_resolution_clock::now() - start_preprocess;
+        return packet;
+    };
 
-        if (mesh.isEye) {
-            glm::vec3 sum(0.0f);
-            if (!posedVertices_nifRootSpace_zUp.empty()) {
-                for (const auto& pos : posedVertices_nifRootSpace_zUp) {
-                    sum += pos;
-                }
-                eyeCenter_nifRootSpace_zUp = sum / static_cast<float>(posedVertices_nifRootSpace_zUp.size());
+    if (!shapeWorkers) {
+        size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+        shapeWorkers = std::make_unique<ThreadPool>(std::min<size_t>(hardwareThreads, kMaxShapeThreads));
+    }
+    std::vector<std::future<ShapePacket>> packets;
+    packets.reserve(shapeList.size());
+    for (auto* niShape : shapeList) {
+        packets.push_back(shapeWorkers->submit([&prepareShape, niShape]() { return prepareShape(niShape); }));
+    }
+    // The jobs capture this frame by reference, so it can't be left (even by an exception) while any still run.
+    struct PacketWait {
+        std::vector<std::future<ShapePacket>>& pending;
+        ~PacketWait() { for (auto& f : pending) if (f.valid()) f.wait(); }
+    } packetWait{ packets };
+
+    // --- Merge, Stages 5-6: in shape order on the GL thread ---
+    // Bounds are min/max reductions, and the primary-head bounds and eye centre take the same shape
+    // the serial loop did (the last eye wins), so the result doesn't depend on worker timing.
+    size_t triangleTotal = 0;
+    double missesBefore = 0.0, missesAfter = 0.0; // ACMR x triangles, summed over shapes.
+    for (auto& pending : packets) {
+        ShapePacket packet = pending.get();
+        std::cout << packet.log;
+        if (packet.skipped) continue;
+        const size_t shapeTriangles = packet.indexCount / 3;
+        triangleTotal += shapeTriangles;
+        missesBefore += packet.acmrBefore * shapeTriangles;
+        missesAfter += packet.acmrAfter * shapeTriangles;
+        auto start_upload = std::chrono::high_resolution_clock::now();
+
+        nifly::NiShape* niShape = packet.shape;
+        MeshShape& mesh = packet.mesh;
+        const nifly::NiShader* shader = packet.shader;
+
+        minBounds_nifRootSpace_zUp = glm::min(minBounds_nifRootSpace_zUp, packet.minBounds_nifRootSpace_zUp);
+        maxBounds_nifRootSpace_zUp = glm::max(maxBounds_nifRootSpace_zUp, packet.maxBounds_nifRootSpace_zUp);
+        if (!packet.isAccessoryPart) {
+            headMinBounds_nifRootSpace_zUp = glm::min(headMinBounds_nifRootSpace_zUp, packet.minBounds_nifRootSpace_zUp);
+            headMaxBounds_nifRootSpace_zUp = glm::max(headMaxBounds_nifRootSpace_zUp, packet.maxBounds_nifRootSpace_zUp);
+        }
+        // If this shape was identified as the primary head, store its final posed bounds.
+        if (packet.isPrimaryHead) {
+            headShapeMinBounds_nifRootSpace_zUp = packet.minBounds_nifRootSpace_zUp;
+            headShapeMaxBounds_nifRootSpace_zUp = packet.maxBounds_nifRootSpace_zUp;
+            bHasHeadShapeBounds = true;
+            if (debugMode) {
+                std::cout << "    [Head Bounds] Stored final posed bounds for primary head shape '" << mesh.name << "'.\n";
             }
+        }
+        if (mesh.isEye) {
+            eyeCenter_nifRootSpace_zUp = packet.eyeCenter_nifRootSpace_zUp;
             bHasEyeCenter = true;
         }
-        auto end_stage4 = std::chrono::high_resolution_clock::now();
 
         // --- Stage 5: Texture & Material Loading ---
         auto start_stage5 = std::chrono::high_resolution_clock::now();
+        std::vector<std::string> shapeTexturePaths;
         if (shader && shader->HasTextureSet()) {
             if (auto* textureSet = nif.GetHeader().GetBlock<nifly::BSShaderTextureSet>(shader->TextureSetRef())) {
-                for (size_t i = 0; i < textureSet->textures.size(); ++i) {
-                    std::string texPath = textureSet->textures[i].get();
-                    if (texPath.empty()) continue;
-
-                    if (debugMode) {
-                        std::string slotName = "Unknown";
-                        switch (i) {
-                        case 0: slotName = "Diffuse"; break;
-                        case 1: slotName = "Normal"; break;
-                        case 2: slotName = "Skin/Subsurface"; break;
-                        case 3: slotName = "Detail"; break;
-                        case 4: slotName = "Environment Map"; break;
-                        case 5: slotName = "Environment Mask"; break;
-                        case 6: slotName = "Face Tint Mask"; break;
-                        case 7: slotName = "Specular"; break;
-                        }
-                        std::cout << "    [Texture Load] Shape '" << mesh.name << "' | Slot " << i << " | " << slotName << ": \"" << texPath << "\"\n";
-                    }
-
-                    // --- CORRECTED LOGIC ---
-                    // Call the function once and store the full TextureInfo result.
-                    TextureInfo texInfo = textureManager.loadTexture(texPath);
-
-                    // Now assign the members of the struct to the mesh.
-                    switch (i) {
-                    case 0: mesh.diffuseTextureID = texInfo.id; break;
-                    case 1: mesh.normalTextureID = texInfo.id; break;
-                    case 2: mesh.skinTextureID = texInfo.id; break;
-                    case 3: mesh.detailTextureID = texInfo.id; break;
-                    case 4: // Environment Map - store both ID and target
-                        mesh.environmentMapID = texInfo.id;
-                        mesh.environmentMapTarget = texInfo.target;
-                        break;
-                    case 5: mesh.environmentMaskID = texInfo.id; break;   // Masks are always 2D
-                    case 6: mesh.faceTintColorMaskID = texInfo.id; break;
-                    case 7: mesh.specularTextureID = texInfo.id; break;
-                    default: break;
-                    }
+                // Fetch the whole set in one batch so the file reads overlap instead of running back to back.
+                std::vector<std::string> setPaths;
+                setPaths.reserve(textureSet->textures.size());
+                for (const auto& tex : textureSet->textures) {
+                    setPaths.push_back(tex.get());
                 }
+                AssignTextureSet(mesh, setPaths, textureManager, debugMode);
+                shapeTexturePaths = std::move(setPaths);
             }
         }
 
@@ -913,52 +1366,11 @@ found_head:
 
         // --- Stage 6: GPU Buffer Upload ---
         auto start_stage6 = std::chrono::high_resolution_clock::now();
-        glGenVertexArrays(1, &mesh.VAO);
-        glGenBuffers(1, &mesh.VBO);
-        glGenBuffers(1, &mesh.EBO);
-        glBindVertexArray(mesh.VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(Vertex), vertexData.data(), GL_STATIC_DRAW);
-
-        std::vector<nifly::Triangle> triangles;
-        niShape->GetTriangles(triangles);
-        if (!triangles.empty()) {
-            std::vector<unsigned short> final_indices;
-            final_indices.reserve(triangles.size() * 3);
-            for (const auto& tri : triangles) {
-                final_indices.push_back(tri.p1);
-                final_indices.push_back(tri.p2);
-                final_indices.push_back(tri.p3);
-            }
-            mesh.indexCount = static_cast<GLsizei>(final_indices.size());
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, final_indices.size() * sizeof(unsigned short), final_indices.data(), GL_STATIC_DRAW);
-        }
-
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
-
-        glEnableVertexAttribArray(4);
-        glVertexAttribIPointer(4, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, boneIDs));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, weights));
-
-        // Add Tangent and Bitangent attributes
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-        glEnableVertexAttribArray(7);
-        glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
-
-        glBindVertexArray(0);
+        UploadShapeBuffers(mesh, packet.vertexLayout, packet.vertices.data(), packet.vertices.size(), packet.indices.data(), packet.indexCount);
         auto end_stage6 = std::chrono::high_resolution_clock::now();
 
         // Sort into render passes
+        RenderPass pass = RenderPass::Opaque;
         if (mesh.hasAlphaProperty) {
             if (debugMode) {
                 std::cout << "    [Render Pass] Shape '" << mesh.name << "' has NiAlphaProperty, using its settings.\n";
@@ -967,20 +1379,20 @@ found_head:
                 if (debugMode) {
                     std::cout << "    [Render Pass] -> Assigned to TRANSPARENT pass due to alpha blending.\n";
                 }
-                transparentShapes.push_back(mesh);
+                pass = RenderPass::Transparent;
             }
             else if (mesh.alphaTest) {
                 if (debugMode) {
                     std::cout << "    [Render Pass] -> Assigned to ALPHA-TEST pass due to alpha property.\n";
                 }
-                alphaTestShapes.push_back(mesh);
+                pass = RenderPass::AlphaTest;
             }
             else {
                 if (debugMode) {
                     std::cout << "    [Render Pass] -> NiAlphaProperty found but no flags set. Defaulting to ALPHA-TEST pass.\n";
                 }
                 mesh.alphaTest = true;
-                alphaTestShapes.push_back(mesh);
+                pass = RenderPass::AlphaTest;
             }
         }
         else { // --- MODIFIED BLOCK: Logic for shapes WITHOUT an NiAlphaProperty ---
@@ -1002,28 +1414,34 @@ found_head:
                 if (debugMode) {
                     std::cout << "    [Render Pass] -> Material alpha is < 1.0. Forcing blend mode and assigning to TRANSPARENT pass.\n";
                 }
-                transparentShapes.push_back(mesh);
+                pass = RenderPass::Transparent;
             }
             else { // Material alpha is 1.0, so it's truly opaque.
                 if (debugMode) {
                     std::cout << "    [Render Pass] -> Material alpha is 1.0. Assigning to OPAQUE pass.\n";
                 }
-                opaqueShapes.push_back(mesh);
             }
         } // --- END MODIFIED BLOCK ---
+        shapesFor(pass).push_back(mesh);
+
+        if (compiled) {
+            ++compiledShapeCount;
+            WriteCompiledShape(*compiled, mesh, pass, shapeTexturePaths, packet.vertexLayout, packet.vertices, packet.indices, packet.indexCount);
+        }
 
-        auto end_preprocess = std::chrono::high_resolution_clock::now();
+        auto end_upload = std::chrono::high_resolution_clock::now();
 
         // --- LOGGING ---
         if (debugMode) {
-            auto dur_s1 = std::chrono::duration_cast<std::chrono::milliseconds>(end_stage1 - start_stage1);
-            auto dur_s2 = std::chrono::duration_cast<std::chrono::milliseconds>(end_stage2 - start_stage2);
-            auto dur_s3 = std::chrono::duration_cast<std::chrono::milliseconds>(end_stage3 - start_stage3);
-            auto dur_s4 = std::chrono::duration_cast<std::chrono::milliseconds>(end_stage4 - start_stage4);
+            auto dur_s1 = std::chrono::duration_cast<std::chrono::milliseconds>(packet.stage1);
+            auto dur_s2 = std::chrono::duration_cast<std::chrono::milliseconds>(packet.stage2);
+            auto dur_s3 = std::chrono::duration_cast<std::chrono::milliseconds>(packet.stage3);
+            auto dur_s4 = std::chrono::duration_cast<std::chrono::milliseconds>(packet.stage4);
             auto dur_s5 = std::chrono::duration_cast<std::chrono::milliseconds>(end_stage5 - start_stage5);
             auto dur_s6 = std::chrono::duration_cast<std::chrono::milliseconds>(end_stage6 - start_stage6);
-            auto duration_preprocess = std::chrono::duration_cast<std::chrono::milliseconds>(end_preprocess - start_preprocess);
+            auto duration_preprocess = std::chrono::duration_cast<std::chrono::milliseconds>(packet.preprocess + (end_upload - start_upload));
 
+            std::cout << "    [Profile] Shape '" << mesh.name << "' (stages 1-4 on a worker thread):\n";
             std::cout << "    [Profile] Nifly Vertex/Property Parsing: " << dur_s1.count() << " ms\n";
             std::cout << "    [Profile] Data Copy to Buffers: " << dur_s2.count() << " ms\n";
             std::cout << "    [Profile] Skinning Data Extraction: " << dur_s3.count() << " ms\n";
@@ -1034,6 +1452,26 @@ found_head:
         }
     }
 
+    buildMaterialBuffer();
+    if (triangleTotal > 0) {
+        std::cout << "[Profile] Index optimisation: ACMR " << missesBefore / triangleTotal << " -> " << missesAfter / triangleTotal
+            << " over " << triangleTotal << " triangles (" << IndexOptimizer::kReportCacheSize << "-entry FIFO cache)\n";
+    }
+
+    if (compiled) {
+        CompiledModelHeader header{};
+        header.shapeCount = compiledShapeCount;
+        header.flags = (bHasHeadShapeBounds ? kCompiledHasHeadShapeBounds : 0) | (bHasEyeCenter ? kCompiledHasEyeCenter : 0);
+        header.minBounds = minBounds_nifRootSpace_zUp;
+        header.maxBounds = maxBounds_nifRootSpace_zUp;
+        header.headMinBounds = headMinBounds_nifRootSpace_zUp;
+        header.headMaxBounds = headMaxBounds_nifRootSpace_zUp;
+        header.headShapeMinBounds = headShapeMinBounds_nifRootSpace_zUp;
+        header.headShapeMaxBounds = headShapeMaxBounds_nifRootSpace_zUp;
+        header.eyeCenter = eyeCenter_nifRootSpace_zUp;
+        std::memcpy(compiled->data(), &header, sizeof(header));
+    }
+
     if (debugMode) {
         std::cout << "\n--- Load Complete ---\n";
         std::cout << "[Bounds] Final Min Bounds: (" << minBounds_nifRootSpace_zUp.x << ", " << minBounds_nifRootSpace_zUp.y << ", " << minBounds_nifRootSpace_zUp.z << ")\n";
@@ -1043,19 +1481,153 @@ found_head:
         std::cout << "---------------------\n\n";
     }
 
+    // Drawing needs only the GPU buffers and the bounds above, so let the parsed file go now
+    // rather than keeping it for the model's lifetime.
+    if (!measureReleasedMemory) {
+        parsed.reset();
+        return true;
+    }
+    // glibc keeps freed small blocks in its heap instead of returning them, so trim the heap
+    // before each sample; otherwise both samples would include the same cached pages and the
+    // difference would read about 0. Trimming walks the whole heap, hence only on request.
+    ReleaseFreeHeapMemory();
+    const size_t residentBefore = ProcessResidentBytes();
+    parsed.reset();
+    ReleaseFreeHeapMemory();
+    const size_t residentAfter = ProcessResidentBytes();
+    releasedNifBytes = residentBefore > residentAfter ? residentBefore - residentAfter : 0;
+    std::cout << "[Profile] Released parsed NIF: " << (releasedNifBytes >> 10) << " KB of resident memory freed, "
+        << (residentAfter >> 20) << " MB resident\n";
+
     return true;
 }
 
 // Keep your old load function to avoid breaking things, and have it call the new one.
 // This is optional but good practice.
 bool NifModel::load(const std::string& nifPath, TextureManager& textureManager, const Skeleton* skeleton) {
-    std::ifstream file(nifPath, std::ios::binary);
-    if (!file) {
+    MappedFile file;
+    if (!file.open(nifPath)) {
         std::cerr << "Error: Failed to open NIF file from disk: " << nifPath << std::endl;
         return false;
     }
-    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    return load(data, nifPath, textureManager, skeleton);
+    std::shared_ptr<nifly::NifFile> parsed = parse(file.data(), file.size());
+    if (!parsed) {
+        cleanup();
+        std::cerr << "Error: Failed to load NIF from memory: " << nifPath << std::endl;
+        return false;
+    }
+    return load(std::move(parsed), nifPath, textureManager, skeleton);
+}
+
+bool NifModel::loadCompiled(const char* data, size_t size, const std::string& nifPath, TextureManager& textureManager) {
+    cleanup();
+    textureOwner = &textureManager;
+
+    struct CompiledShape {
+        MeshShape mesh;
+        RenderPass pass = RenderPass::Opaque;
+        std::vector<std::string> texturePaths;
+        PackedVertexLayout layout;
+        const char* vertices = nullptr;
+        size_t vertexBytes = 0;
+        const char* indices = nullptr;
+        size_t indexCount = 0;
+    };
+
+    // Read every record before touching GL, so a damaged file leaves nothing half built and the
+    // textures can be prefetched as one batch.
+    CompiledReader in{ data, size };
+    const CompiledModelHeader header = in.get<CompiledModelHeader>();
+    std::vector<CompiledShape> shapes;
+    for (uint32_t s = 0; s < header.shapeCount && in.ok; ++s) {
+        CompiledShape shape;
+        MeshShape& mesh = shape.mesh;
+        shape.pass = in.get<RenderPass>();
+        mesh.name = in.string();
+
+        const uint32_t flags = in.get<uint32_t>();
+        for (size_t i = 0; i < std::size(kCompiledShapeFlags); ++i) {
+            mesh.*kCompiledShapeFlags[i] = (flags & (1u << i)) != 0;
+        }
+        for (auto field : kCompiledShapeFloats) mesh.*field = in.get<float>();
+        mesh.tintColor = in.get<glm::vec3>();
+        mesh.emissiveColor = in.get<glm::vec3>();
+        mesh.boundsCenter_nifRootSpace_zUp = in.get<glm::vec3>();
+        mesh.srcBlend = in.get<uint32_t>();
+        mesh.dstBlend = in.get<uint32_t>();
+        mesh.shapeLocalToNifRoot_transform_zUp = in.get<glm::mat4>();
+
+        const uint32_t boneCount = in.get<uint32_t>();
+        if (const char* bones = in.bytes(size_t(boneCount) * sizeof(glm::mat4))) {
+            mesh.skinToBonePose_transforms_zUp.resize(boneCount);
+            std::memcpy(mesh.skinToBonePose_transforms_zUp.data(), bones, size_t(boneCount) * sizeof(glm::mat4));
+        }
+
+        const uint32_t textureCount = in.get<uint32_t>();
+        for (uint32_t t = 0; t < textureCount && in.ok; ++t) {
+            shape.texturePaths.push_back(in.string());
+        }
+
+        shape.layout.colors = in.get<uint8_t>() != 0;
+        shape.layout.skinning = in.get<uint8_t>() != 0;
+        shape.layout.wideBoneIds = in.get<uint8_t>() != 0;
+        shape.layout.stride = static_cast<GLsizei>(in.get<uint32_t>());
+        shape.layout.colorOffset = in.get<uint32_t>();
+        shape.layout.boneIdOffset = in.get<uint32_t>();
+        shape.layout.weightOffset = in.get<uint32_t>();
+
+        shape.vertexBytes = static_cast<size_t>(in.get<uint64_t>());
+        shape.indexCount = in.get<uint32_t>();
+        mesh.indexType = in.get<uint32_t>();
+        in.align(16);
+        shape.vertices = in.bytes(shape.vertexBytes);
+        in.align(16);
+        shape.indices = in.bytes(shape.indexCount * IndexSize(mesh.indexType));
+        if (shape.pass > RenderPass::Transparent) in.ok = false;
+        if (mesh.indexType != GL_UNSIGNED_SHORT && mesh.indexType != GL_UNSIGNED_INT) in.ok = false;
+        shapes.push_back(std::move(shape));
+    }
+    if (!in.ok) {
+        std::cerr << "Error: Compiled model for " << nifPath << " is damaged; ignoring it." << std::endl;
+        textureOwner = nullptr;
+        return false;
+    }
+
+    std::vector<std::string> allTextures;
+    for (const auto& shape : shapes) {
+        allTextures.insert(allTextures.end(), shape.texturePaths.begin(), shape.texturePaths.end());
+    }
+    textureManager.prefetchTextures(allTextures); // Deduplicates and skips cached paths.
+
+    minBounds_nifRootSpace_zUp = header.minBounds;
+    maxBounds_nifRootSpace_zUp = header.maxBounds;
+    headMinBounds_nifRootSpace_zUp = header.headMinBounds;
+    headMaxBounds_nifRootSpace_zUp = header.headMaxBounds;
+    headShapeMinBounds_nifRootSpace_zUp = header.headShapeMinBounds;
+    headShapeMaxBounds_nifRootSpace_zUp = header.headShapeMaxBounds;
+    bHasHeadShapeBounds = (header.flags & kCompiledHasHeadShapeBounds) != 0;
+    eyeCenter_nifRootSpace_zUp = header.eyeCenter;
+    bHasEyeCenter = (header.flags & kCompiledHasEyeCenter) != 0;
+
+    for (auto& shape : shapes) {
+        if (!shape.texturePaths.empty()) {
+            AssignTextureSet(shape.mesh, shape.texturePaths, textureManager, false);
+        }
+        UploadShapeBuffers(shape.mesh, shape.layout, shape.vertices, shape.vertexBytes, shape.indices, shape.indexCount);
+        shapesFor(shape.pass).push_back(std::move(shape.mesh));
+    }
+
+    buildMaterialBuffer();
+    std::cout << "[Mesh Cache] Rebuilt " << shapes.size() << " shape(s) of " << nifPath << " from its compiled copy.\n";
+    return true;
+}
+
+std::vector<MeshShape>& NifModel::shapesFor(RenderPass pass) {
+    switch (pass) {
+    case RenderPass::AlphaTest: return alphaTestShapes;
+    case RenderPass::Transparent: return transparentShapes;
+    default: return opaqueShapes;
+    }
 }
 
 /**
@@ -1075,24 +1647,52 @@ void NifModel::draw(Shader& shader, const glm::vec3& cameraPos, const glm::mat4&
     // --- Set Global Shader Uniforms (Samplers) ---
     // These uniforms tell the shader which texture unit to use for each type of texture map.
     // They are set once per draw call as they are the same for all shapes.
-    shader.setInt("texture_diffuse1", 0);    // Diffuse/Albedo map on TU 0
-    shader.setInt("texture_normal", 1);      // Normal map on TU 1
-    shader.setInt("texture_skin", 2);        // Subsurface/Skin map on TU 2
-    shader.setInt("texture_detail", 3);      // Detail map on TU 3
-    shader.setInt("texture_specular", 4);    // Specular map on TU 4
-    shader.setInt("texture_face_tint", 5);   // Face tint mask on TU 5
-    shader.setInt("texture_envmap_2d", 6);   // 2D Environment map on TU 6
-    shader.setInt("texture_envmap_cube", 6); // Cubemap Environment map on TU 6 (same unit)
-    shader.setInt("texture_envmask", 7);     // Environment mask on TU 7
+    shader.setInt("texture_diffuse1", kUnitDiffuse);       // Diffuse/Albedo map
+    shader.setInt("texture_normal", kUnitNormal);          // Normal map
+    shader.setInt("texture_skin", kUnitSkin);              // Subsurface/Skin map
+    shader.setInt("texture_detail", kUnitDetail);          // Detail map
+    shader.setInt("texture_specular", kUnitSpecular);      // Specular map
+    shader.setInt("texture_face_tint", kUnitFaceTint);     // Face tint mask
+    shader.setInt("texture_envmap_2d", kUnitEnvMap2D);     // 2D Environment map
+    shader.setInt("texture_envmap_cube", kUnitEnvMapCube); // Cubemap Environment map (a sampler type of its own needs its own unit)
+    shader.setInt("texture_envmask", kUnitEnvMask);        // Environment mask
 
     // Set eye-specific shader properties, used for fresnel and specular effects on eye meshes.
     shader.setFloat("eye_fresnel_strength", 0.3f);
     shader.setFloat("eye_spec_power", 80.0f);
+    shader.setBool("u_suppressSpecularOnVertexColor", suppressSpecularOnVColor);
+    // Shapes without a colour stream read this generic value instead.
+    glVertexAttrib4f(3, 1.0f, 1.0f, 1.0f, 1.0f);
+
+    // Per-shape material parameters come from ranges of the material buffer.
+    GLuint materialBlockIndex = glGetUniformBlockIndex(shader.ID, "Material");
+    if (materialBlockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader.ID, materialBlockIndex, kMaterialBlockBinding);
+    }
 
     // Get the uniform location for the bone matrices array once, before the render loop, for efficiency.
     GLint boneMatricesLocation = glGetUniformLocation(shader.ID, "uBoneMatrices");
+    GLint modelMatrixLocation = glGetUniformLocation(shader.ID, "u_model_localToWorld");
+    GLint flipUvsLocation = glGetUniformLocation(shader.ID, "u_flipUvs");
+    GLint isSkinnedLocation = glGetUniformLocation(shader.ID, "uIsSkinned");
     if (m_logRenderPassesOnce) checkGlErrors("After getting bone uniform location");
 
+    // --- Texture Bind Cache ---
+    // Textures of the same format and size share an array, so consecutive shapes usually need
+    // the same objects on every unit. Only issue the binds that change something. The cache
+    // starts empty each frame because other code binds textures between frames.
+    GLuint boundTextures[kTextureUnitCount];
+    std::fill(std::begin(boundTextures), std::end(boundTextures), std::numeric_limits<GLuint>::max());
+    size_t textureBinds = 0;
+    size_t shapesDrawn = 0;
+    auto bindTexture = [&](GLuint unit, GLenum target, GLuint textureID) {
+        if (boundTextures[unit] == textureID) return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, textureID);
+        boundTextures[unit] = textureID;
+        ++textureBinds;
+    };
+
     // A helper lambda to render a single shape. This centralizes the logic for setting
     // per-shape uniforms, binding textures, and issuing the draw command.
     auto render_shape = [&](const MeshShape& shape) {
@@ -1111,62 +1711,28 @@ void NifModel::draw(Shader& shader, const glm::vec3& cameraPos, const glm::mat4&
         // Calculate and set the final model matrix. This transforms the shape's vertices from its local Z-up space
         // all the way to the renderer's world Y-up space.
         glm::mat4 modelMatrix = nifRootToWorld_conversionMatrix_zUpToYUp * shape.shapeLocalToNifRoot_transform_zUp;
-        shader.setMat4("u_model_localToWorld", modelMatrix);
+        glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix));
 
         // Determine if the final transform matrix for geometry has a negative scale (is mirrored).
        // The determinant of the rotation/scale part will be negative if it's a reflection.
         bool isMirrored = glm::determinant(glm::mat3(modelMatrix)) < 0;
 
         // We only flip UVs if the geometry is mirrored.
-        shader.setBool("u_flipUvs", isMirrored);
+        glUniform1i(flipUvsLocation, isMirrored ? 1 : 0);
         if (m_logRenderPassesOnce) {
             renderFirstFrameLog("  -> Is Mirrored: " + std::string(isMirrored ? "true" : "false") + ", setting u_flipUvs uniform.");
         }
 
         renderFirstFrameLog("  -> Final Model Matrix (Local Z-up -> World Y-up):\n" + glm::to_string(modelMatrix));
 
-        // Set boolean flags that control shader logic.
-        shader.setBool("is_eye", shape.isEye);
-        shader.setBool("is_model_space", shape.isModelSpace); // For model-space normals
-        shader.setBool("has_greyscale_to_palette", shape.hasGreyscaleToPaletteFlag);
-        shader.setFloat("greyscaleToPaletteScale", shape.greyscaleToPaletteScale);
-        if (m_logRenderPassesOnce) {
-            if (shape.hasGreyscaleToPaletteFlag) {
-                renderFirstFrameLog("  -> Greyscale-to-Palette enabled with scale: " + std::to_string(shape.greyscaleToPaletteScale));
-            }
-            else {
-                renderFirstFrameLog("  -> Greyscale-to-Palette disabled.");
-            }
-        }
-        shader.setFloat("materialGlossiness", shape.glossiness);
-        shader.setFloat("materialSpecularStrength", shape.specularStrength);
-        renderFirstFrameLog("  -> Setting material uniforms: Glossiness=" + std::to_string(shape.glossiness) + ", SpecularStrength=" + std::to_string(shape.specularStrength));
-        
-        shader.setFloat("rimlightPower", shape.rimlightPower);
-        shader.setFloat("subsurfaceRolloff", shape.subsurfaceRolloff);
-
-        shader.setBool("has_tint_color", shape.hasTintColor);
-        if (shape.hasTintColor) {
-            renderFirstFrameLog("  -> Has tint color, setting uniform.");
-            shader.setVec3("tint_color", shape.tintColor);
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have tint color.");
-        }
-
-        shader.setBool("has_emissive", shape.hasOwnEmitFlag);
-        if (shape.hasOwnEmitFlag) {
-            renderFirstFrameLog("  -> Has emissive properties, setting uniforms.");
-            shader.setVec3("emissiveColor", shape.emissiveColor);
-            shader.setFloat("emissiveMultiple", shape.emissiveMultiple);
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have emissive properties.");
-        }
+        // Material flags and properties were written to the material buffer at load time.
+        glBindBufferRange(GL_UNIFORM_BUFFER, kMaterialBlockBinding, materialBuffer, shape.materialOffset, kMaterialBlockSize);
+        renderFirstFrameLog("  -> Material block at offset " + std::to_string(shape.materialOffset) + ": Glossiness=" + std::to_string(shape.glossiness)
+            + ", SpecularStrength=" + std::to_string(shape.specularStrength));
 
         // --- Skinning ---
         // Tell the vertex shader whether this mesh is skinned.
-        shader.setBool("uIsSkinned", shape.isSkinned);
+        glUniform1i(isSkinnedLocation, shape.isSkinned ? 1 : 0);
         if (shape.isSkinned && !shape.skinToBonePose_transforms_zUp.empty()) {
             renderFirstFrameLog("  -> Is skinned, uploading bone matrices.");
             GLsizei boneCount = shape.skinToBonePose_transforms_zUp.size();
@@ -1191,148 +1757,33 @@ void NifModel::draw(Shader& shader, const glm::vec3& cameraPos, const glm::mat4&
             renderFirstFrameLog("  -> Is not skinned.");
         }
 
-        // --- Pass special lighting flags to the shader ---
-        shader.setBool("has_hair_soft_lighting", shape.hasHairSoftLightingFlag);
-        shader.setBool("has_soft_lighting", shape.hasSoftLightingFlag);
-        if (m_logRenderPassesOnce) {
-            if (shape.hasHairSoftLightingFlag || shape.hasSoftLightingFlag) {
-                renderFirstFrameLog("  -> Special lighting uniforms set: HairSoft=" + std::string(shape.hasHairSoftLightingFlag ? "true" : "false") + ", Soft=" + std::string(shape.hasSoftLightingFlag ? "true" : "false"));
-            }
-        }
-        // --- END NEW BLOCK ---
-
-        // --- NEW: Pass compatibility flags ---
-        shader.setBool("u_suppressSpecularOnVertexColor", suppressSpecularOnVColor);
-        shader.setBool("has_vertex_colors", shape.hasVertexColors);
-        if (m_logRenderPassesOnce) {
-            renderFirstFrameLog("  -> Setting compatibility uniforms: SuppressSpecular=" + std::string(suppressSpecularOnVColor ? "true" : "false") + ", HasVertexColors=" + std::string(shape.hasVertexColors ? "true" : "false"));
-        }
-
         if (m_logRenderPassesOnce) checkGlErrors(("After setting uniforms for '" + shape.name + "'").c_str());
 
-
         // --- Texture Binding ---
-        // Bind the diffuse texture to texture unit 0.
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, shape.diffuseTextureID);
-
-        // For each subsequent texture, set a boolean uniform to tell the fragment shader
-        // whether a valid texture exists. If it does, activate the corresponding texture
-        // unit and bind the texture.
-        shader.setBool("has_normal_map", shape.normalTextureID != 0);
-        if (shape.normalTextureID != 0) {
-            renderFirstFrameLog("  -> Has normal map, binding texture.");
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, shape.normalTextureID);
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have normal map.");
-        }
-
-        shader.setBool("has_skin_map", shape.skinTextureID != 0);
-        if (shape.skinTextureID != 0) {
-            renderFirstFrameLog("  -> Has skin map, binding texture.");
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, shape.skinTextureID);
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have skin map.");
-        }
-
-        shader.setBool("has_detail_map", shape.detailTextureID != 0);
-        if (shape.detailTextureID != 0) {
-            renderFirstFrameLog("  -> Has detail map, binding texture.");
-            glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_2D, shape.detailTextureID);
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have detail map.");
-        }
-
-        shader.setBool("has_specular", shape.hasSpecularFlag);
-        shader.setBool("has_specular_map", shape.specularTextureID != 0);
-        if (shape.specularTextureID != 0) {
-            renderFirstFrameLog("  -> Has specular map, binding texture.");
-            glActiveTexture(GL_TEXTURE4);
-            glBindTexture(GL_TEXTURE_2D, shape.specularTextureID);
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have specular map.");
-        }
-
-        shader.setBool("has_face_tint_map", shape.faceTintColorMaskID != 0);
-        if (shape.faceTintColorMaskID != 0) {
-            renderFirstFrameLog("  -> Has face tint map, binding texture.");
-            glActiveTexture(GL_TEXTURE5);
-            glBindTexture(GL_TEXTURE_2D, shape.faceTintColorMaskID);
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have face tint map.");
-        }
-
-        // --- Environment Mapping ---
-        // An "effective" environment map exists only if the material flag is set AND a texture is assigned.
-        bool useEffectiveEnvMap = shape.hasEnvMapFlag && shape.environmentMapID != 0;
-        shader.setBool("has_environment_map", useEffectiveEnvMap);
-        shader.setBool("has_eye_environment_map", shape.hasEyeEnvMapFlag);
-        // --- MODIFIED: Pass all environment map properties to the shader ---
-        if (useEffectiveEnvMap || shape.hasEyeEnvMapFlag) {
-            renderFirstFrameLog("  -> Has effective env map or eye env map flag, setting env map uniforms.");
-            shader.setBool("is_envmap_cube", shape.environmentMapTarget == GL_TEXTURE_CUBE_MAP);
-            shader.setFloat("envMapScale", shape.envMapScale);
-
-            // NEW: Pass the separate eye cubemap scale
-            shader.setFloat("eyeCubemapScale", shape.eyeCubemapScale);
-            // NEW: Pass a boolean indicating if a dedicated environment mask texture exists.
-            bool hasEnvMask = shape.environmentMaskID != 0;
-            shader.setBool("has_env_mask", hasEnvMask);
-
-            if (m_logRenderPassesOnce) {
-                renderFirstFrameLog("    -> Is Cubemap: " + std::string(shape.environmentMapTarget == GL_TEXTURE_CUBE_MAP ? "true" : "false"));
-                renderFirstFrameLog("    -> Env Map Scale: " + std::to_string(shape.envMapScale));
-                renderFirstFrameLog("    -> Eye Cubemap Scale: " + std::to_string(shape.eyeCubemapScale));
-                renderFirstFrameLog("    -> Has Env Mask Texture: " + std::string(hasEnvMask ? "true" : "false"));
-
-                // --- NEW LOGGING BLOCK ---
-                // This log explains the logic the shader will use to determine reflection strength, matching the new shader code.
-                if (hasEnvMask) {
-                    renderFirstFrameLog("    -> [Shader Logic] Reflection strength will be determined by the dedicated environment mask texture (slot 5).");
-                }
-                else if (shape.specularTextureID != 0) { 
-                    renderFirstFrameLog("    -> [Shader Logic] No dedicated mask found. Shader will FALL BACK to using the specular map texture (slot 7) for reflection strength.");
-                }
-                else {
-                    renderFirstFrameLog("    -> [Shader Logic] No mask or specular map found. Shader will use a default reflection strength of 1.0.");
-                }
-                // --- END NEW LOGGING BLOCK ---
-            }
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have an active environment map.");
-        }
-
+        // The diffuse array is always bound (a missing diffuse samples as black, as before).
+        // The other slots are only sampled when the material block says they exist, so a
+        // missing texture leaves whatever is bound on its unit.
+        bindTexture(kUnitDiffuse, GL_TEXTURE_2D_ARRAY, shape.diffuseTextureID);
+        if (shape.normalTextureID != 0) bindTexture(kUnitNormal, GL_TEXTURE_2D_ARRAY, shape.normalTextureID);
+        if (shape.skinTextureID != 0) bindTexture(kUnitSkin, GL_TEXTURE_2D_ARRAY, shape.skinTextureID);
+        if (shape.detailTextureID != 0) bindTexture(kUnitDetail, GL_TEXTURE_2D_ARRAY, shape.detailTextureID);
+        if (shape.specularTextureID != 0) bindTexture(kUnitSpecular, GL_TEXTURE_2D_ARRAY, shape.specularTextureID);
+        if (shape.faceTintColorMaskID != 0) bindTexture(kUnitFaceTint, GL_TEXTURE_2D_ARRAY, shape.faceTintColorMaskID);
         if (shape.environmentMapID != 0) {
-            renderFirstFrameLog("  -> Has environment map texture, binding it.");
-            glActiveTexture(GL_TEXTURE6);
-            glBindTexture(shape.environmentMapTarget, shape.environmentMapID);
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have an environment map texture ID.");
-        }
-
-        if (shape.environmentMaskID != 0) {
-            renderFirstFrameLog("  -> Has environment mask, binding it.");
-            glActiveTexture(GL_TEXTURE7);
-            glBindTexture(GL_TEXTURE_2D, shape.environmentMaskID);
-        }
-        else {
-            renderFirstFrameLog("  -> Does not have an environment mask ID.");
+            if (shape.environmentMapTarget == GL_TEXTURE_CUBE_MAP) {
+                bindTexture(kUnitEnvMapCube, GL_TEXTURE_CUBE_MAP, shape.environmentMapID);
+            }
+            else {
+                bindTexture(kUnitEnvMap2D, GL_TEXTURE_2D_ARRAY, shape.environmentMapID);
+            }
         }
+        if (shape.environmentMaskID != 0) bindTexture(kUnitEnvMask, GL_TEXTURE_2D_ARRAY, shape.environmentMaskID);
         if (m_logRenderPassesOnce) checkGlErrors(("After binding textures for '" + shape.name + "'").c_str());
 
         // --- Draw Call ---
         // With all uniforms and textures set, issue the command to draw the shape's geometry.
         shape.draw();
+        ++shapesDrawn;
         if (m_logRenderPassesOnce) checkGlErrors(("IMMEDIATELY AFTER shape.draw() for '" + shape.name + "'").c_str());
         };
 
@@ -1364,8 +1815,6 @@ void NifModel::draw(Shader& shader, const glm::vec3& cameraPos, const glm::mat4&
     renderFirstFrameLog("--- Pass 2: Alpha-Test (Cutout) Objects (" + std::to_string(alphaTestShapes.size()) + " shapes) ---");
     shader.setBool("use_alpha_test", true); // Enable alpha testing in the shader.
     for (const auto& shape : alphaTestShapes) {
-        shader.setFloat("alpha_threshold", shape.alphaThreshold);
-
         // For thin meshes like hair, disable back-face culling to ensure they are visible from both sides.
         if (shape.doubleSided) {
             renderFirstFrameLog("Shape '" + shape.name + "' is double-sided, disabling cull face.");
@@ -1407,7 +1856,6 @@ void NifModel::draw(Shader& shader, const glm::vec3& cameraPos, const glm::mat4&
             if (shape.alphaTest) {
                 renderFirstFrameLog("  -> Shape '" + shape.name + "' in transparent pass also has alpha test enabled.");
                 shader.setBool("use_alpha_test", true);
-                shader.setFloat("alpha_threshold", shape.alphaThreshold);
             }
             else {
                 renderFirstFrameLog("  -> Shape '" + shape.name + "' in transparent pass is blend-only.");
@@ -1439,7 +1887,9 @@ void NifModel::draw(Shader& shader, const glm::vec3& cameraPos, const glm::mat4&
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
     glActiveTexture(GL_TEXTURE0); // Reset active texture unit to the default.
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
     if (m_logRenderPassesOnce) checkGlErrors("End of NifModel::draw");
+    renderFirstFrameLog(std::to_string(textureBinds) + " texture bind(s) for " + std::to_string(shapesDrawn) + " shape(s).");
 
     // After the first frame has been fully drawn and logged, set the flag to false.
     m_logRenderPassesOnce = false;
@@ -1466,8 +1916,9 @@ void NifModel::drawDepthOnly(Shader& depthShader) {
         if (isAlphaTested) {
             // Bind the diffuse texture to unit 0 for the alpha test
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, shape.diffuseTextureID);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, shape.diffuseTextureID);
             depthShader.setInt("texture_diffuse1", 0);
+            depthShader.setInt("layer_diffuse", shape.diffuseLayer);
             depthShader.setFloat("alpha_threshold", shape.alphaThreshold);
         }
 
@@ -1498,6 +1949,17 @@ void NifModel::drawDepthOnly(Shader& depthShader) {
 }
 
 void NifModel::cleanup() {
+    // Hand the texture references back so the cache can evict them if it needs the room.
+    if (textureOwner) {
+        std::vector<TextureInfo> released;
+        for (const auto* shapes : { &opaqueShapes, &alphaTestShapes, &transparentShapes }) {
+            for (const auto& shape : *shapes) {
+                released.insert(released.end(), shape.textureRefs.begin(), shape.textureRefs.end());
+            }
+        }
+        textureOwner->releaseTextures(released);
+    }
+
     for (auto& shape : opaqueShapes) shape.cleanup();
     opaqueShapes.clear();
     for (auto& shape : alphaTestShapes) shape.cleanup();
@@ -1505,14 +1967,120 @@ void NifModel::cleanup() {
     for (auto& shape : transparentShapes) shape.cleanup();
     transparentShapes.clear();
     texturePaths.clear();
+    releasedNifBytes = 0;
+
+    if (materialBuffer != 0) {
+        glDeleteBuffers(1, &materialBuffer);
+        materialBuffer = 0;
+        materialBufferBytes = 0;
+    }
+}
+
+void NifModel::buildMaterialBuffer() {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max<GLint>(alignment, 16);
+    const size_t stride = (static_cast<size_t>(kMaterialBlockSize) + alignment - 1) / alignment * alignment;
+
+    std::vector<char> blocks(stride * (opaqueShapes.size() + alphaTestShapes.size() + transparentShapes.size()));
+    if (blocks.empty()) {
+        return;
+    }
+
+    size_t index = 0;
+    for (auto* shapes : { &opaqueShapes, &alphaTestShapes, &transparentShapes }) {
+        for (auto& shape : *shapes) {
+            MaterialBlock block{};
+            block.tintColor = shape.tintColor;
+            block.greyscaleToPaletteScale = shape.greyscaleToPaletteScale;
+            block.emissiveColor = shape.emissiveColor;
+            block.emissiveMultiple = shape.emissiveMultiple;
+            block.glossiness = shape.glossiness;
+            block.specularStrength = shape.specularStrength;
+            block.rimlightPower = shape.rimlightPower;
+            block.subsurfaceRolloff = shape.subsurfaceRolloff;
+            block.envMapScale = shape.envMapScale;
+            block.eyeCubemapScale = shape.eyeCubemapScale;
+            block.alphaThreshold = shape.alphaThreshold;
+
+            block.diffuseLayer = shape.diffuseLayer;
+            block.normalLayer = shape.normalLayer;
+            block.skinLayer = shape.skinLayer;
+            block.detailLayer = shape.detailLayer;
+            block.specularLayer = shape.specularLayer;
+            block.faceTintLayer = shape.faceTintLayer;
+            block.envMapLayer = shape.environmentMapLayer;
+            block.envMaskLayer = shape.environmentMaskLayer;
+
+            block.isEye = shape.isEye;
+            block.isModelSpace = shape.isModelSpace; // For model-space normals
+            block.hasGreyscaleToPalette = shape.hasGreyscaleToPaletteFlag;
+            block.hasTintColor = shape.hasTintColor;
+            block.hasEmissive = shape.hasOwnEmitFlag;
+            block.hasHairSoftLighting = shape.hasHairSoftLightingFlag;
+            block.hasSoftLighting = shape.hasSoftLightingFlag;
+            block.hasVertexColors = shape.hasVertexColors;
+            block.hasNormalMap = shape.normalTextureID != 0;
+            block.hasSkinMap = shape.skinTextureID != 0;
+            block.hasDetailMap = shape.detailTextureID != 0;
+            block.hasSpecular = shape.hasSpecularFlag;
+            block.hasSpecularMap = shape.specularTextureID != 0;
+            block.hasFaceTintMap = shape.faceTintColorMaskID != 0;
+            // An "effective" environment map exists only if the material flag is set AND a texture is assigned.
+            block.hasEnvironmentMap = shape.hasEnvMapFlag && shape.environmentMapID != 0;
+            block.hasEyeEnvironmentMap = shape.hasEyeEnvMapFlag;
+            block.isEnvmapCube = shape.environmentMapTarget == GL_TEXTURE_CUBE_MAP;
+            block.hasEnvMask = shape.environmentMaskID != 0;
+
+            shape.materialOffset = static_cast<GLintptr>(index * stride);
+            std::memcpy(blocks.data() + shape.materialOffset, &block, sizeof(block));
+            ++index;
+        }
+    }
+
+    glGenBuffers(1, &materialBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(blocks.size()), blocks.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    materialBufferBytes = blocks.size();
+}
+
+std::vector<NifModel::BufferMemoryUsage> NifModel::getBufferMemoryUsage() const {
+    std::vector<BufferMemoryUsage> usage;
+    for (const auto* shapes : { &opaqueShapes, &alphaTestShapes, &transparentShapes }) {
+        for (const auto& shape : *shapes) {
+            usage.push_back({ shape.name, shape.vertexBytes, shape.indexBytes });
+        }
+    }
+    std::sort(usage.begin(), usage.end(), [](const BufferMemoryUsage& a, const BufferMemoryUsage& b) {
+        return a.vertexBytes + a.indexBytes > b.vertexBytes + b.indexBytes;
+    });
+    return usage;
 }
 
 std::vector<std::string> NifModel::getTextures() const {
     return texturePaths;
 }
 
+std::vector<std::string> NifModel::listTextures(const nifly::NifFile& nif) {
+    std::vector<std::string> paths;
+    for (auto* shape : nif.GetShapes()) {
+        if (!shape || (shape->flags & 1)) continue; // Hidden shapes are never drawn.
+        const nifly::NiShader* shader = nif.GetShader(shape);
+        if (!shader || !shader->HasTextureSet()) continue;
+        if (auto* textureSet = nif.GetHeader().GetBlock<nifly::BSShaderTextureSet>(shader->TextureSetRef())) {
+            for (const auto& tex : textureSet->textures) {
+                if (!tex.get().empty()) {
+                    paths.push_back(tex.get());
+                }
+            }
+        }
+    }
+    return paths;
+}
+
 void NifModel::renderFirstFrameLog(const std::string& message) {
     if (m_logRenderPassesOnce) {
         std::cout << "[Render Logic] " << message << std::endl;
     }
-}
\ No newline at end of file
+}
@@ -12,16 +12,20 @@
 
 #include <NifFile.hpp>
 
+#include "TextureManager.h"
+
 // Forward-declare classes to avoid circular dependencies
 class Shader;
-class TextureManager;
 class Skeleton;
+class ThreadPool;
 
 struct MeshShape {
     std::string name;
     bool visible = true;
     GLuint VAO = 0, VBO = 0, EBO = 0;
     GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_SHORT; // GL_UNSIGNED_INT for shapes with more than 65,535 vertices.
+    size_t vertexBytes = 0, indexBytes = 0; // Sizes of VBO and EBO, for memory reports.
 
     // This matrix transforms a vertex from this shape's local model space
     // into the NIF file's overall root coordinate space.
@@ -43,6 +47,14 @@ struct MeshShape {
     GLuint detailTextureID = 0; // Slot 3: _detail.dds
     GLuint faceTintColorMaskID = 0; // Slot 6: Face Tint Mask
     GLuint specularTextureID = 0; // Slot 7: _s.dds
+    // The 2D slots are GL_TEXTURE_2D_ARRAYs shared with other textures (see TextureInfo);
+    // these are the layers to sample in them.
+    GLint diffuseLayer = 0;
+    GLint normalLayer = 0;
+    GLint skinLayer = 0;
+    GLint detailLayer = 0;
+    GLint faceTintLayer = 0;
+    GLint specularLayer = 0;
     bool isModelSpace = false;
     bool isEye = false; // NEW: Flag for eye-specific shader logic
 
@@ -94,14 +106,22 @@ struct MeshShape {
 
     // --- Shader Properties
     GLuint environmentMapID = 0;   // Slot 4: _e.dds or _em.dds
-    GLenum environmentMapTarget = GL_TEXTURE_2D;
+    GLenum environmentMapTarget = GL_TEXTURE_2D_ARRAY; // Or GL_TEXTURE_CUBE_MAP.
+    GLint environmentMapLayer = 0;
     GLuint environmentMaskID = 0;  // Slot 5: _m.dds
+    GLint environmentMaskLayer = 0;
     float envMapScale = 1.0f;
     float eyeCubemapScale = 1.0f; // NEW: Separate scale for eye reflections
     float greyscaleToPaletteScale = 1.0f; // NEW: Scale for greyscale colorization
     glm::vec3 emissiveColor = glm::vec3(0.0f);
     float emissiveMultiple = 1.0f;
 
+    // One TextureManager reference per loaded slot; released by NifModel::cleanup().
+    std::vector<TextureInfo> textureRefs;
+
+    // Where this shape's material block starts in NifModel's material buffer.
+    GLintptr materialOffset = 0;
+
     void draw() const;
     void cleanup();
 };
@@ -113,15 +133,45 @@ public:
 
     bool load(const std::string& path, TextureManager& textureManager, const Skeleton* skeleton);
     bool load(const std::vector<char>& data, const std::string& nifPath, TextureManager& textureManager, const Skeleton* skeleton);
+    // Builds the model from a NIF the caller already parsed (see parse()), so callers that
+    // inspect the file themselves don't parse it twice. The model keeps a reference to it.
+    // If 'compiled' is given, it receives the processed model in the form loadCompiled() takes.
+    bool load(std::shared_ptr<nifly::NifFile> parsed, const std::string& nifPath, TextureManager& textureManager, const Skeleton* skeleton,
+        std::vector<char>* compiled = nullptr);
+    // Rebuilds a model from the output of load(): uploads the stored buffers and loads the
+    // textures without parsing the NIF. Returns false, leaving the model empty, if the data is damaged.
+    bool loadCompiled(const char* data, size_t size, const std::string& nifPath, TextureManager& textureManager);
+    // Returns nullptr if the data isn't a NIF nifly can read.
+    static std::shared_ptr<nifly::NifFile> parse(const std::vector<char>& data);
+    static std::shared_ptr<nifly::NifFile> parse(const char* data, size_t size);
     void draw(Shader& shader, const glm::vec3& cameraPos, const glm::mat4& nifRootToWorld_conversionMatrix_zUpToYUp, bool suppressSpecularOnVColor);
     void drawDepthOnly(Shader& depthShader);
     void cleanup();
 
+    // Which draw list a shape is sorted into.
+    enum class RenderPass : uint32_t { Opaque, AlphaTest, Transparent };
+
     std::vector<MeshShape>& getOpaqueShapes() { return opaqueShapes; }
     std::vector<MeshShape>& getAlphaTestShapes() { return alphaTestShapes; }
     std::vector<MeshShape>& getTransparentShapes() { return transparentShapes; }
 
     std::vector<std::string> getTextures() const;
+    // Every texture path referenced by the NIF's shader texture sets, without loading anything.
+    static std::vector<std::string> listTextures(const nifly::NifFile& nif);
+
+    // GPU buffer memory held by this model, for memory reports. Textures are owned by the
+    // TextureManager and reported there.
+    struct BufferMemoryUsage {
+        std::string shape;
+        size_t vertexBytes = 0;
+        size_t indexBytes = 0;
+    };
+    std::vector<BufferMemoryUsage> getBufferMemoryUsage() const; // Largest first.
+    size_t getMaterialBufferBytes() const { return materialBufferBytes; }
+    // How much the process's resident memory fell when load() released the parsed NIF. Only
+    // measured when setMeasureReleasedMemory(true) was called before load(); 0 otherwise.
+    size_t getReleasedNifBytes() const { return releasedNifBytes; }
+    void setMeasureReleasedMemory(bool measure) { measureReleasedMemory = measure; }
 
     // --- Accessors for Bounds ---
     // Note: All bounds are stored in the NIF file's root coordinate space, which is Z-up.
@@ -143,11 +193,21 @@ public:
     glm::vec3 getBoundsSize_nifRootSpace_zUp() const { return maxBounds_nifRootSpace_zUp - minBounds_nifRootSpace_zUp; }
 
 private:
-    nifly::NifFile nif;
     std::vector<MeshShape> opaqueShapes;
     std::vector<MeshShape> alphaTestShapes;
     std::vector<MeshShape> transparentShapes;
+    std::vector<MeshShape>& shapesFor(RenderPass pass);
     std::vector<std::string> texturePaths;
+    TextureManager* textureOwner = nullptr; // Holds the references in each shape's textureRefs.
+    std::unique_ptr<ThreadPool> shapeWorkers; // Prepares shapes in load(); created on first use.
+
+    // Every shape's material parameters, one std140 'Material' block each, written once after
+    // loading so drawing a shape only has to bind its range.
+    GLuint materialBuffer = 0;
+    size_t materialBufferBytes = 0;
+    size_t releasedNifBytes = 0;
+    bool measureReleasedMemory = false;
+    void buildMaterialBuffer();
 
     // --- Bounding Box Members ---
     // These define the AABB for the entire model in the NIF's root coordinate space.
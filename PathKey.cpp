@@ -0,0 +1,123 @@
+#include "PathKey.h"
+#include <cstring>
+#include <utility>
+
+namespace {
+    constexpr std::string_view kTexturesPrefix = "textures\\";
+    constexpr std::string_view kMeshesPrefix = "meshes\\";
+
+    constexpr char normalizeChar(char c) {
+        if (c == '/') return '\\';
+        if (c >= 'A' && c <= 'Z') return static_cast<char>(c - 'A' + 'a');
+        return c;
+    }
+
+    // Case- and separator-insensitive check against an already-normalised pattern.
+    bool startsWithNormalized(std::string_view s, std::string_view pattern) {
+        if (s.size() < pattern.size()) return false;
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            if (normalizeChar(s[i]) != pattern[i]) return false;
+        }
+        return true;
+    }
+
+    bool endsWithNormalized(std::string_view s, std::string_view pattern) {
+        return s.size() >= pattern.size() && startsWithNormalized(s.substr(s.size() - pattern.size()), pattern);
+    }
+
+    // 64-bit FNV-1a, folded to size_t on 32-bit targets.
+    constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+    constexpr uint64_t kFnvPrime = 1099511628211ull;
+}
+
+PathKey::PathKey(std::string_view rawPath) {
+    while (!rawPath.empty() && (rawPath.front() == '\\' || rawPath.front() == '/')) {
+        rawPath.remove_prefix(1);
+    }
+    if (rawPath.empty()) {
+        return;
+    }
+
+    // Decide the top-level folder up front so the characters only need to be visited once.
+    std::string_view prefix;
+    if (startsWithNormalized(rawPath, kTexturesPrefix)) {
+        rootFolder = Root::Textures;
+    }
+    else if (startsWithNormalized(rawPath, kMeshesPrefix)) {
+        rootFolder = Root::Meshes;
+    }
+    else if (endsWithNormalized(rawPath, ".dds")) {
+        rootFolder = Root::Textures;
+        prefix = kTexturesPrefix;
+    }
+    else if (endsWithNormalized(rawPath, ".nif") || endsWithNormalized(rawPath, ".tri")) {
+        rootFolder = Root::Meshes;
+        prefix = kMeshesPrefix;
+    }
+
+    const size_t total = prefix.size() + rawPath.size();
+    char* out = inlinePath;
+    if (total > kInlineCapacity) {
+        longPath = std::make_unique<char[]>(total);
+        out = longPath.get();
+    }
+
+    uint64_t h = kFnvOffset;
+    size_t n = 0;
+    for (char c : prefix) {
+        out[n++] = c;
+        h = (h ^ static_cast<unsigned char>(c)) * kFnvPrime;
+    }
+    for (char c : rawPath) {
+        c = normalizeChar(c);
+        out[n++] = c;
+        h = (h ^ static_cast<unsigned char>(c)) * kFnvPrime;
+    }
+
+    length = static_cast<uint32_t>(total);
+    hashValue = static_cast<size_t>(h ^ (h >> 32));
+}
+
+PathKey::PathKey(const PathKey& other) {
+    *this = other;
+}
+
+PathKey& PathKey::operator=(const PathKey& other) {
+    if (this == &other) {
+        return *this;
+    }
+    length = other.length;
+    hashValue = other.hashValue;
+    rootFolder = other.rootFolder;
+    if (other.longPath) {
+        longPath = std::make_unique<char[]>(length);
+        std::memcpy(longPath.get(), other.longPath.get(), length);
+    }
+    else {
+        longPath.reset();
+        std::memcpy(inlinePath, other.inlinePath, length);
+    }
+    return *this;
+}
+
+PathKey::PathKey(PathKey&& other) noexcept {
+    *this = std::move(other);
+}
+
+PathKey& PathKey::operator=(PathKey&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    length = other.length;
+    hashValue = other.hashValue;
+    rootFolder = other.rootFolder;
+    longPath = std::move(other.longPath);
+    if (!longPath) {
+        std::memcpy(inlinePath, other.inlinePath, length);
+    }
+    // Leave the source as an empty key rather than a length pointing at the inline buffer.
+    other.length = 0;
+    other.hashValue = 0;
+    other.rootFolder = Root::Other;
+    return *this;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// A normalised, case-insensitive asset path used as the lookup key by the asset, archive
+// and texture managers.
+//
+// Normalisation matches the layout of paths inside Bethesda archives: '/' becomes '\',
+// ASCII letters are lowercased, leading separators are dropped and bare ".dds" paths get
+// a "textures\" prefix (".nif"/".tri" get "meshes\"). It is done in a single pass into an
+// inline buffer, so typical paths never touch the heap, and the hash is computed alongside.
+class PathKey {
+public:
+    enum class Root : uint8_t { Other, Textures, Meshes };
+
+    PathKey() = default;
+    explicit PathKey(std::string_view rawPath);
+
+    PathKey(const PathKey& other);
+    PathKey& operator=(const PathKey& other);
+    PathKey(PathKey&& other) noexcept;
+    PathKey& operator=(PathKey&& other) noexcept;
+
+    std::string_view view() const { return { data(), length }; }
+    std::string str() const { return std::string(view()); }
+    bool empty() const { return length == 0; }
+    size_t size() const { return length; }
+    size_t hash() const { return hashValue; }
+    Root root() const { return rootFolder; }
+
+    bool operator==(const PathKey& other) const {
+        return hashValue == other.hashValue && view() == other.view();
+    }
+    bool operator!=(const PathKey& other) const { return !(*this == other); }
+
+private:
+    // Sized so that "textures\" plus a deep actor texture path still fits inline, while
+    // keeping the key close to a heap-backed std::string for the large BSA content maps.
+    static constexpr size_t kInlineCapacity = 96;
+
+    const char* data() const { return longPath ? longPath.get() : inlinePath; }
+
+    char inlinePath[kInlineCapacity] = {};
+    std::unique_ptr<char[]> longPath; // Only used when the path does not fit inline.
+    uint32_t length = 0;
+    size_t hashValue = 0;
+    Root rootFolder = Root::Other;
+};
+
+namespace std {
+    template <>
+    struct hash<PathKey> {
+        size_t operator()(const PathKey& key) const noexcept { return key.hash(); }
+    };
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+// The process's resident set size (working set on Windows) in bytes, or 0 if the platform
+// doesn't report it. Cheap enough to call around individual loads.
+size_t ProcessResidentBytes();
+
+// Hands freed heap pages back to the OS where the allocator keeps them cached (glibc's
+// malloc_trim), so a resident-size sample taken after freeing memory reflects the free.
+// Does nothing on other platforms, whose allocators already return large blocks.
+void ReleaseFreeHeapMemory();
@@ -4,6 +4,9 @@
 #include "BsaManager.h"
 #include "Skeleton.h"
 #include "CommonMatrices.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include "ProcessMemory.h"
 #include <iostream>
 #include <stdexcept>
 #include <fstream>
@@ -14,6 +17,9 @@
 #include <iomanip> // For std::setw, std::setfill
 #include <sstream> // For std::stringstream
 #include <array>   // For std::array
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <cmath>
 
 #include <glad/glad.h>
@@ -77,6 +83,15 @@ void checkGlErrors(const char* location) {
     }
 }
 
+// Time per frame the interactive viewer spends uploading queued texture data.
+constexpr double kInteractiveUploadBudgetMs = 4.0;
+
+// Texture LOD cap for saved portraits. A head texture wraps all the way around the head, so only
+// about half of its width is visible; the safety factor covers that plus headroom for trilinear
+// filtering. An absolute camera can put the model anywhere, so it is assumed to fill the image.
+constexpr float kAbsoluteCameraCoverage = 1.0f;
+constexpr float kPortraitTexelSafety = 2.0f;
+
 
 // --- Global Callback Prototypes ---
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -109,6 +124,9 @@ Renderer::Renderer(int width, int height, const std::string& app_dir)
 }
 
 Renderer::~Renderer() {
+    // The model holds texture references, so it must go before the TextureManager does.
+    model.reset();
+
     glDeleteVertexArrays(1, &m_arrowVAO);
     glDeleteBuffers(1, &m_arrowVBO);
     glDeleteVertexArrays(1, &m_axesVAO);
@@ -125,6 +143,26 @@ Renderer::~Renderer() {
     glfwTerminate();
 }
 
+uint32_t Renderer::portraitTextureSizeCap() const {
+    // The cap is needed before the model (and so its head bounds) is loaded. Mugshot framing is
+    // relative to the head, though: the frame is the head's height plus the top and bottom
+    // offsets, so the head covers 1 / (1 + top - bottom) of the image height whatever its size.
+    // The head is no wider than it is tall, so its height in pixels bounds both directions.
+    bool useAbsoluteCamera = (camX != 0.0f || camY != 0.0f || camZ != 0.0f || camPitch != 0.0f || camYaw != 0.0f);
+    float needed;
+    if (useAbsoluteCamera) {
+        needed = static_cast<float>(std::max(imageXRes, imageYRes)) * kAbsoluteCameraCoverage;
+    }
+    else {
+        float frameOverHead = std::max(1.0f + headTopOffset - headBottomOffset, 0.05f);
+        needed = static_cast<float>(imageYRes) / frameOverHead;
+    }
+    needed *= kPortraitTexelSafety;
+    uint32_t cap = 1;
+    while (cap < needed && cap < (1u << 15)) cap <<= 1;
+    return cap;
+}
+
 void Renderer::updateAssetManagerPaths() {
     // --- Assemble final list of paths for the AssetManager ---
     std::vector<std::filesystem::path> finalPaths;
@@ -140,7 +178,10 @@ void Renderer::updateAssetManagerPaths() {
         }
     }
     // 3. Pass the complete, prioritized list to the AssetManager.
-    assetManager.setActiveDirectories(finalPaths, appDirectory);
+    if (assetManager.setActiveDirectories(finalPaths, appDirectory)) {
+        // Only drop the cached textures that the new folder set now resolves elsewhere.
+        textureManager.revalidate();
+    }
 }
 
 void Renderer::init(bool headless) {
@@ -199,6 +240,7 @@ void Renderer::init(bool headless) {
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         throw std::runtime_error("Failed to initialize GLAD");
     }
+    textureManager.detectFormatSupport();
 
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
     glEnable(GL_MULTISAMPLE);
@@ -375,6 +417,14 @@ void Renderer::run() {
         int display_w, display_h;
         glfwGetFramebufferSize(window, &display_w, &display_h);
         glViewport(0, 0, display_w, display_h);
+        // Stream in queued texture data a little at a time so a large load doesn't stall the UI,
+        // but finish it all before a frame that is about to be saved.
+        if (screenshotPath.empty()) {
+            textureManager.processUploadQueue(kInteractiveUploadBudgetMs);
+        }
+        else {
+            textureManager.flushUploads();
+        }
         renderFrame();
 
         // 4. NOW that all UI is defined, finalize the ImGui draw data.
@@ -718,6 +768,8 @@ void Renderer::renderUI() {
                 }
             }
             ImGui::Separator();
+            ImGui::Checkbox("GPU Memory", &m_showMemoryPanel);
+            ImGui::Separator();
             // --- NEW: Light Browser ---
             // This section provides a list of all lights for easy management,
             // especially for deleting lights that have moved off-screen.
@@ -787,6 +839,112 @@ void Renderer::renderUI() {
 
         ImGui::EndMainMenuBar();
     }
+
+    if (m_showMemoryPanel) {
+        renderMemoryPanel();
+    }
+}
+
+void Renderer::renderMemoryPanel() {
+    // Textures this large are almost always an upscaled mod texture nobody will see in a portrait.
+    constexpr GLsizei kLargeTextureSize = 4096;
+    constexpr size_t kListedConsumers = 20;
+
+    ImGui::SetNextWindowSize(ImVec2(560, 420), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("GPU Memory", &m_showMemoryPanel)) {
+        ImGui::End();
+        return;
+    }
+
+    auto megabytes = [](size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+    std::vector<TextureManager::TextureMemoryUsage> textures = textureManager.getTextureMemoryUsage();
+    std::vector<NifModel::BufferMemoryUsage> buffers;
+    if (model) {
+        buffers = model->getBufferMemoryUsage();
+    }
+
+    size_t inUseBytes = 0;
+    for (const auto& texture : textures) {
+        if (texture.refCount > 0) inUseBytes += texture.bytes;
+    }
+    size_t bufferBytes = model ? model->getMaterialBufferBytes() : 0;
+    for (const auto& buffer : buffers) bufferBytes += buffer.vertexBytes + buffer.indexBytes;
+
+    ImGui::Text("Textures: %.1f MB resident (%.1f MB used by this model), %zu cached",
+        megabytes(textureManager.getResidentBytes()), megabytes(inUseBytes), textures.size());
+    ImGui::Text("Unused texture array layers: %.1f MB", megabytes(textureManager.getArrayPoolStats().unusedBytes));
+    ImGui::Text("Mesh and material buffers: %.2f MB", megabytes(bufferBytes));
+    ImGui::Text("Process resident memory: %.1f MB (%.2f MB freed by releasing the parsed NIF)",
+        megabytes(ProcessResidentBytes()), megabytes(model ? model->getReleasedNifBytes() : 0));
+
+    if (ImGui::CollapsingHeader("Textures by Format", ImGuiTreeNodeFlags_DefaultOpen)) {
+        std::map<std::string, std::pair<size_t, size_t>> formats; // Count, bytes.
+        for (const auto& texture : textures) {
+            auto& format = formats[TextureManager::formatName(texture.internalFormat)];
+            ++format.first;
+            format.second += texture.bytes;
+        }
+        if (ImGui::BeginTable("formats", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+            ImGui::TableSetupColumn("Format");
+            ImGui::TableSetupColumn("Textures");
+            ImGui::TableSetupColumn("MB");
+            ImGui::TableHeadersRow();
+            for (const auto& [name, format] : formats) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(name.c_str());
+                ImGui::TableNextColumn(); ImGui::Text("%zu", format.first);
+                ImGui::TableNextColumn(); ImGui::Text("%.1f", megabytes(format.second));
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Largest Textures", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (ImGui::BeginTable("textures", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+            ImGui::TableSetupColumn("Path", ImGuiTableColumnFlags_WidthStretch, 4.0f);
+            ImGui::TableSetupColumn("Size");
+            ImGui::TableSetupColumn("Format");
+            ImGui::TableSetupColumn("MB");
+            ImGui::TableHeadersRow();
+            for (size_t i = 0; i < textures.size() && i < kListedConsumers; ++i) {
+                const auto& texture = textures[i];
+                bool large = std::max(texture.width, texture.height) >= kLargeTextureSize;
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                if (large) ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.45f, 0.3f, 1.0f));
+                ImGui::TextUnformatted(texture.path.c_str());
+                if (large) ImGui::PopStyleColor();
+                if (ImGui::IsItemHovered()) {
+                    std::string mips;
+                    for (size_t level = 0; level < texture.mipBytes.size(); ++level) {
+                        mips += "mip " + std::to_string(level) + ": " + std::to_string(texture.mipBytes[level] >> 10) + " KB\n";
+                    }
+                    ImGui::SetTooltip("%s%s", texture.refCount > 0 ? "" : "(cached, not drawn)\n", mips.c_str());
+                }
+                ImGui::TableNextColumn(); ImGui::Text("%dx%d", texture.width, texture.height);
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(TextureManager::formatName(texture.internalFormat).c_str());
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", megabytes(texture.bytes));
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    if (!buffers.empty() && ImGui::CollapsingHeader("Largest Meshes")) {
+        if (ImGui::BeginTable("buffers", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+            ImGui::TableSetupColumn("Shape", ImGuiTableColumnFlags_WidthStretch, 4.0f);
+            ImGui::TableSetupColumn("Vertex KB");
+            ImGui::TableSetupColumn("Index KB");
+            ImGui::TableHeadersRow();
+            for (size_t i = 0; i < buffers.size() && i < kListedConsumers; ++i) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(buffers[i].shape.c_str());
+                ImGui::TableNextColumn(); ImGui::Text("%zu", buffers[i].vertexBytes >> 10);
+                ImGui::TableNextColumn(); ImGui::Text("%zu", buffers[i].indexBytes >> 10);
+            }
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
 }
 
 void Renderer::shutdownUI() {
@@ -1306,7 +1464,24 @@ void Renderer::HandleFramebufferSize(int width, int height) {
 
 // --- Model Loading and Util ---
 
+// SkeletonHint as stored in a .npcmesh header.
+static uint32_t PackSkeletonHint(const SkeletonHint& hint) {
+    return (hint.female ? 1u : 0u) | (hint.male ? 2u : 0u) | (hint.beast ? 4u : 0u);
+}
+
+static SkeletonHint UnpackSkeletonHint(uint32_t bits) {
+    SkeletonHint hint;
+    hint.female = (bits & 1u) != 0;
+    hint.male = (bits & 2u) != 0;
+    hint.beast = (bits & 4u) != 0;
+    return hint;
+}
+
 void Renderer::detectAndSetSkeleton(const nifly::NifFile& nif) {
+    applySkeletonHint(detectSkeletonHint(nif));
+}
+
+SkeletonHint Renderer::detectSkeletonHint(const nifly::NifFile& nif) {
     bool hasFemale = false;
     bool hasMale = false;
     bool isBeast = false;
@@ -1340,8 +1515,16 @@ void Renderer::detectAndSetSkeleton(const nifly::NifFile& nif) {
         }
     }
 
-    if (hasFemale) {
-        if (isBeast && femaleBeastSkeleton.isLoaded()) {
+    SkeletonHint hint;
+    hint.female = hasFemale;
+    hint.male = hasMale;
+    hint.beast = isBeast;
+    return hint;
+}
+
+void Renderer::applySkeletonHint(const SkeletonHint& hint) {
+    if (hint.female) {
+        if (hint.beast && femaleBeastSkeleton.isLoaded()) {
             activeSkeleton = &femaleBeastSkeleton;
             currentSkeletonType = SkeletonType::FemaleBeast;
             std::cout << "[Skeleton Detect] Female Beast skeleton auto-selected." << std::endl;
@@ -1352,8 +1535,8 @@ void Renderer::detectAndSetSkeleton(const nifly::NifFile& nif) {
             std::cout << "[Skeleton Detect] Female skeleton auto-selected." << std::endl;
         }
     }
-    else if (hasMale) {
-        if (isBeast && maleBeastSkeleton.isLoaded()) {
+    else if (hint.male) {
+        if (hint.beast && maleBeastSkeleton.isLoaded()) {
             activeSkeleton = &maleBeastSkeleton;
             currentSkeletonType = SkeletonType::MaleBeast;
             std::cout << "[Skeleton Detect] Male Beast skeleton auto-selected." << std::endl;
@@ -1371,18 +1554,8 @@ void Renderer::detectAndSetSkeleton(const nifly::NifFile& nif) {
     }
 }
 
-void Renderer::loadNifModel(const std::string& path) {
-    // Allow calling with an empty path to trigger a reload of the current model
-    if (!path.empty()) {
-        currentNifPath = path;
-    }
-    if (currentNifPath.empty()) {
-        return; // Nothing to load or reload
-    }
-
-    // --- This part is the same: update data folders and tell the AssetManager ---
-    std::string nifRootDirectory;
-    std::string pathLower = currentNifPath;
+void Renderer::addNifDataFolder(const std::string& nifPath) {
+    std::string pathLower = nifPath;
     std::transform(pathLower.begin(), pathLower.end(), pathLower.begin(), ::tolower);
 
     size_t meshesPos = pathLower.rfind("\\meshes\\");
@@ -1390,19 +1563,42 @@ void Renderer::loadNifModel(const std::string& path) {
         meshesPos = pathLower.rfind("/meshes/");
     }
     if (meshesPos != std::string::npos) {
-        nifRootDirectory = currentNifPath.substr(0, meshesPos);
+        std::string nifRootDirectory = nifPath.substr(0, meshesPos);
         auto it = std::find(dataFolders.begin(), dataFolders.end(), nifRootDirectory);
         if (it == dataFolders.end()) {
             dataFolders.push_back(nifRootDirectory);
         }
     }
+}
+
+void Renderer::loadNifModel(const std::string& path) {
+    // Allow calling with an empty path to trigger a reload of the current model
+    if (!path.empty()) {
+        currentNifPath = path;
+    }
+    if (currentNifPath.empty()) {
+        return; // Nothing to load or reload
+    }
+
+    // --- This part is the same: update data folders and tell the AssetManager ---
+    addNifDataFolder(currentNifPath);
 
     // --- Assemble final list of paths for the AssetManager ---
     updateAssetManagerPaths();
 
+    // Each stage of the load is timed; the NifModel logs its own per-shape breakdown.
+    auto stageStart = std::chrono::high_resolution_clock::now();
+    auto stageMs = [&stageStart]() {
+        auto now = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - stageStart).count();
+        stageStart = now;
+        return ms;
+    };
+
     // --- RECOMMENDED CHANGE: Load NIF data through the AssetManager ---
     std::cout << "[NIF Load] Extracting: " << currentNifPath << std::endl;
     std::vector<char> nifData = assetManager.extractFile(currentNifPath);
+    double extractMs = stageMs();
 
     if (nifData.empty()) {
         std::cerr << "Renderer failed to load NIF model data via AssetManager." << std::endl;
@@ -1419,29 +1615,107 @@ void Renderer::loadNifModel(const std::string& path) {
         ss << std::setw(2) << static_cast<int>(byte);
     }
     currentNifHash = ss.str();
-
-    // Use the in-memory data for skeleton detection
-    nifly::NifFile tempNif;
-    std::stringstream nifStream(std::string(nifData.begin(), nifData.end()));
-    if (tempNif.Load(nifStream) == 0) {
-        detectAndSetSkeleton(tempNif);
-    }
-    else {
-        std::cerr << "Could not pre-load NIF from memory for skeleton detection." << std::endl;
-        activeSkeleton = nullptr;
-        currentSkeletonType = SkeletonType::None;
-    }
+    double hashMs = stageMs();
 
     if (!model) {
         model = std::make_unique<NifModel>();
     }
 
-    textureManager.cleanup(); // clear the texture cache before reloading the model in case new data folders were added.
+    // Saved portraits never sample mips larger than the output needs, so don't load them.
+    // The interactive viewer can zoom in, so it keeps every level.
+    uint32_t textureSizeCap = (isHeadless || batchExporting) ? portraitTextureSizeCap() : 0;
+    textureManager.setMaxTextureSize(textureSizeCap);
+    size_t dedupSavedBefore = textureManager.getDedupSavedBytes();
+
+    // A compiled copy is keyed by the NIF's contents and the program version, and is only used
+    // if it was posed with the same skeleton that this load selects.
+    const uint64_t meshKey = contentHash64(hash_bytes.data(), hash_bytes.size(),
+        contentHash64(PROGRAM_VERSION.data(), PROGRAM_VERSION.size()));
+    bool loaded = false;
+    if (meshCache.isOpen()) {
+        const char* payload = nullptr;
+        size_t payloadSize = 0;
+        MeshDiskCache::Provenance provenance;
+        std::unique_ptr<MappedFile> compiledFile = meshCache.lookup(meshKey, payload, payloadSize, provenance);
+        if (compiledFile) {
+            applySkeletonHint(UnpackSkeletonHint(provenance.skeletonHint));
+            double skeletonMs = stageMs();
+            uint64_t fingerprint = activeSkeleton ? activeSkeleton->getFingerprint() : 0;
+            if (fingerprint == provenance.skeletonFingerprint) {
+                loaded = model->loadCompiled(payload, payloadSize, currentNifPath, textureManager);
+                std::cout << "[Profile] NIF load stages (mesh cache hit): extract " << extractMs << " ms, hash " << hashMs
+                    << " ms, skeleton selection " << skeletonMs << " ms, model rebuild " << stageMs() << " ms\n";
+            }
+            else {
+                std::cout << "[Mesh Cache] Cached copy was posed with a different skeleton; rebuilding." << std::endl;
+            }
+        }
+    }
 
-    // You will need to update NifModel::load to also accept a vector<char>
-    if (model->load(nifData, currentNifPath, textureManager, activeSkeleton)) {
+    if (!loaded) {
+        // Parse once; skeleton detection and the model build both work on the same parsed file.
+        std::shared_ptr<nifly::NifFile> parsedNif = NifModel::parse(nifData);
+        double parseMs = stageMs();
+        if (!parsedNif) {
+            std::cerr << "Error: Failed to load NIF from memory: " << currentNifPath << std::endl;
+            model->cleanup();
+            return;
+        }
+        SkeletonHint skeletonHint = detectSkeletonHint(*parsedNif);
+        applySkeletonHint(skeletonHint);
+        double skeletonMs = stageMs();
+
+        std::vector<char> compiled;
+        model->setMeasureReleasedMemory(measureReleasedNifMemory || m_showMemoryPanel);
+        loaded = model->load(std::move(parsedNif), currentNifPath, textureManager, activeSkeleton,
+            meshCache.isOpen() ? &compiled : nullptr);
+        std::cout << "[Profile] NIF load stages: extract " << extractMs << " ms, hash " << hashMs << " ms, parse " << parseMs
+            << " ms, skeleton detection " << skeletonMs << " ms, model build " << stageMs() << " ms\n";
+        if (loaded && !compiled.empty()) {
+            MeshDiskCache::Provenance provenance;
+            provenance.skeletonFingerprint = activeSkeleton ? activeSkeleton->getFingerprint() : 0;
+            provenance.skeletonHint = PackSkeletonHint(skeletonHint);
+            // Synchronous, on the GL thread: a cache miss also pays for writing the file. That
+            // only happens on a model's first load, and its buffers are already uploaded by now.
+            meshCache.store(meshKey, compiled, provenance);
+        }
+    }
+    if (loaded) {
         saveConfig();
 
+        size_t dedupSavedNow = textureManager.getDedupSavedBytes();
+        if (dedupSavedNow > dedupSavedBefore) {
+            std::cout << "[Profile] Texture dedup: " << ((dedupSavedNow - dedupSavedBefore) >> 10) << " KB of VRAM saved by this load, "
+                << (dedupSavedNow >> 20) << " MB over " << textureManager.getDedupHits() << " shared load(s) so far\n";
+        }
+
+        if (textureSizeCap > 0) {
+            std::cout << "[Profile] Texture LOD cap " << textureSizeCap << " px: "
+                << (textureManager.getLodSkippedBytes() >> 20) << " MB of mip data skipped so far\n";
+        }
+
+        if (isHeadless) {
+            textureManager.flushUploads(); // The next frame rendered is the one that gets saved.
+        }
+
+        const SharedAssetCache& sharedCache = assetManager.getSharedCache();
+        if (sharedCache.isOpen()) {
+            std::cout << "[Profile] Shared asset cache: " << sharedCache.hitCount() << " hits, "
+                << sharedCache.missCount() << " misses so far\n";
+        }
+        const TextureDiskCache& diskCache = textureManager.getDiskCache();
+        if (diskCache.isOpen()) {
+            std::cout << "[Profile] Texture disk cache: " << diskCache.hitCount() << " hits, "
+                << diskCache.missCount() << " misses, " << diskCache.writeCount() << " written so far\n";
+        }
+        if (meshCache.isOpen()) {
+            std::cout << "[Profile] Mesh disk cache: " << meshCache.hitCount() << " hits, "
+                << meshCache.missCount() << " misses, " << meshCache.writeCount() << " written so far\n";
+        }
+        TextureManager::ArrayPoolStats arrayPool = textureManager.getArrayPoolStats();
+        std::cout << "[Profile] Texture arrays: " << arrayPool.layersUsed << "/" << arrayPool.layersAllocated
+            << " layers used in " << arrayPool.arrays << " array(s), " << (arrayPool.unusedBytes >> 10) << " KB unused\n";
+
         // Check which camera mode to use. Mugshot mode is used only if all absolute camera parameters are zero.
         bool useAbsoluteCamera = (camX != 0.0f || camY != 0.0f || camZ != 0.0f || camPitch != 0.0f || camYaw != 0.0f);
 
@@ -1733,6 +2007,146 @@ std::string selectFolderDialog_ModernWindows(const std::string& title) {
     return folderPath;
 }
 
+void Renderer::warmTextures(const std::vector<std::string>& texturePaths) {
+    if (texturePaths.empty()) {
+        return;
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    updateAssetManagerPaths();
+    // Load at the size the portraits will sample, so the pinned copies get used as they are.
+    textureManager.setMaxTextureSize((isHeadless || batchExporting) ? portraitTextureSizeCap() : 0);
+    textureManager.prefetchTextures(texturePaths);
+    textureManager.pinTextures(texturePaths);
+    textureManager.flushUploads();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cout << "[Profile] Warm pool: pinned " << textureManager.getPinnedCount() << " of " << texturePaths.size()
+        << " texture(s) in " << duration.count() << " ms\n";
+}
+
+bool Renderer::warmTexturesFromList(const std::string& listPath) {
+    std::ifstream in(listPath);
+    if (!in) {
+        std::cerr << "Error: Could not open warm texture list: " << listPath << std::endl;
+        return false;
+    }
+    std::vector<std::string> paths;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        paths.push_back(line.substr(first, last - first + 1));
+    }
+    warmTextures(paths);
+    return true;
+}
+
+// Textures referenced by more than one of the given NIFs (or all of them, for a single NIF).
+// These are the race's shared base textures; per-NPC face tints only show up once.
+std::vector<std::string> Renderer::findSharedTextures(const std::vector<std::filesystem::path>& nifPaths) {
+    std::unordered_map<PathKey, std::pair<std::string, size_t>> uses; // Path as first seen, NIFs using it.
+    for (const auto& nifPath : nifPaths) {
+        std::vector<char> nifData = assetManager.extractFile(nifPath.string());
+        std::shared_ptr<nifly::NifFile> nif = nifData.empty() ? nullptr : NifModel::parse(nifData);
+        if (!nif) {
+            continue;
+        }
+        std::unordered_set<PathKey> seen;
+        for (const auto& texture : NifModel::listTextures(*nif)) {
+            PathKey key(texture);
+            if (!seen.insert(key).second) continue;
+            auto& use = uses[key];
+            if (use.first.empty()) use.first = texture;
+            ++use.second;
+        }
+    }
+
+    size_t minUses = std::min<size_t>(nifPaths.size(), 2);
+    std::vector<std::string> shared;
+    for (const auto& [key, use] : uses) {
+        if (use.second >= minUses) shared.push_back(use.first);
+    }
+    std::sort(shared.begin(), shared.end());
+    return shared;
+}
+
+nlohmann::json Renderer::buildMemoryReport() const {
+    nlohmann::json report;
+    report["nif"] = currentNifPath;
+
+    size_t textureBytes = 0, inUseBytes = 0;
+    std::map<std::string, std::pair<size_t, size_t>> formats; // Count, bytes.
+    nlohmann::json textureList = nlohmann::json::array();
+    for (const auto& texture : textureManager.getTextureMemoryUsage()) {
+        std::string format = TextureManager::formatName(texture.internalFormat);
+        textureBytes += texture.bytes;
+        if (texture.refCount > 0) inUseBytes += texture.bytes;
+        ++formats[format].first;
+        formats[format].second += texture.bytes;
+        textureList.push_back({
+            { "path", texture.path },
+            { "format", format },
+            { "width", texture.width },
+            { "height", texture.height },
+            { "bytes", texture.bytes },
+            { "mip_bytes", texture.mipBytes },
+            { "in_use", texture.refCount > 0 },
+            { "paths", texture.paths },
+        });
+    }
+    nlohmann::json formatList = nlohmann::json::array();
+    for (const auto& [name, format] : formats) {
+        formatList.push_back({ { "format", name }, { "textures", format.first }, { "bytes", format.second } });
+    }
+
+    size_t vertexBytes = 0, indexBytes = 0, materialBytes = 0;
+    nlohmann::json bufferList = nlohmann::json::array();
+    if (model) {
+        for (const auto& buffer : model->getBufferMemoryUsage()) {
+            vertexBytes += buffer.vertexBytes;
+            indexBytes += buffer.indexBytes;
+            bufferList.push_back({ { "shape", buffer.shape }, { "vertex_bytes", buffer.vertexBytes }, { "index_bytes", buffer.indexBytes } });
+        }
+        materialBytes = model->getMaterialBufferBytes();
+    }
+
+    size_t unusedArrayBytes = textureManager.getArrayPoolStats().unusedBytes;
+    report["totals"] = {
+        { "texture_bytes", textureBytes },
+        { "texture_bytes_in_use", inUseBytes },
+        { "unused_array_layer_bytes", unusedArrayBytes },
+        { "vertex_bytes", vertexBytes },
+        { "index_bytes", indexBytes },
+        { "material_bytes", materialBytes },
+        { "total_bytes", textureBytes + unusedArrayBytes + vertexBytes + indexBytes + materialBytes },
+    };
+    // CPU side: what the process holds now, and what dropping the parsed NIF gave back.
+    report["process"] = {
+        { "resident_bytes", ProcessResidentBytes() },
+        { "parsed_nif_released_bytes", model ? model->getReleasedNifBytes() : 0 },
+    };
+    report["texture_formats"] = std::move(formatList);
+    report["textures"] = std::move(textureList);
+    report["buffers"] = std::move(bufferList);
+    return report;
+}
+
+bool Renderer::writeMemoryReport(const std::string& path) const {
+    nlohmann::json report = buildMemoryReport();
+    if (path == "-") {
+        std::cout << std::setw(4) << report << std::endl;
+        return true;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: Could not write memory report to " << path << std::endl;
+        return false;
+    }
+    out << std::setw(4) << report << std::endl;
+    return true;
+}
+
 void Renderer::processDirectory() {
     // 1. Prompt for the input directory using the new function
     std::string inputPath = selectFolderDialog_ModernWindows("Select Input Directory with NIF files");
@@ -1774,11 +2188,22 @@ void Renderer::processDirectory() {
 
     // 5. Process each NIF file
     std::cout << "--- Starting batch process for " << nifFiles.size() << " files. The UI will be unresponsive. ---" << std::endl;
+    batchExporting = true;
+    if (warmScanCount > 0) {
+        // loadNifModel adds each NIF's data folder as it goes; warming runs first, so add the
+        // batch's folders now or the shared textures would resolve against the old roots.
+        for (const auto& nifPath : nifFiles) {
+            addNifDataFolder(nifPath.string());
+        }
+        std::vector<std::filesystem::path> scanned(nifFiles.begin(), nifFiles.begin() + std::min<size_t>(nifFiles.size(), warmScanCount));
+        warmTextures(findSharedTextures(scanned));
+    }
     for (const auto& nifPath : nifFiles) {
         std::cout << "Processing: " << nifPath.filename().string() << std::endl;
 
         // Load the model. This also sets up the automatic "mugshot" camera.
         loadNifModel(nifPath.string());
+        textureManager.flushUploads();
 
         // Explicitly render one frame with the new model
         renderFrame();
@@ -1792,6 +2217,8 @@ void Renderer::processDirectory() {
         glfwPollEvents();
     }
 
+    batchExporting = false;
+
     // 6. Notify user of completion
     std::string completionMessage = "Batch process complete. " + std::to_string(nifFiles.size()) + " files were exported.";
     tinyfd_messageBox("Process Complete", completionMessage.c_str(), "ok", "info", 1);
@@ -1855,6 +2282,8 @@ void Renderer::loadConfig() {
 
         // Load lighting settings
         lightingProfilePath = data.value("lighting_profile_path", "lighting.json");
+
+        setTextureBudgetMB(data.value("texture_budget_mb", 1024));
     }
     catch (const std::exception& e) {
         std::cerr << "Error loading config file: " << e.what() << std::endl;
@@ -1884,6 +2313,7 @@ void Renderer::saveConfig() {
         data["camera_fov"] = m_cameraFovY;
 
         data["lighting_profile_path"] = lightingProfilePath;
+        data["texture_budget_mb"] = textureBudgetMB;
 
         std::ofstream o(configPath);
         o << std::setw(4) << data << std::endl;
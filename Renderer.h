@@ -1,6 +1,7 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <algorithm>
 #include <string>
 #include <memory>
 #include "Shader.h"
@@ -8,6 +9,7 @@
 #include "NifModel.h"
 #include "AssetManager.h"
 #include "TextureManager.h"
+#include "MeshDiskCache.h"
 #include "BsaManager.h"
 #include "Skeleton.h"
 #include "Version.h"
@@ -18,6 +20,12 @@
 
 struct GLFWwindow;
 enum class SkeletonType { None, Female, Male, FemaleBeast, MaleBeast, Custom };
+// What a NIF's shape and texture names say about the skeleton it was made for.
+struct SkeletonHint {
+    bool female = false;
+    bool male = false;
+    bool beast = false;
+};
 struct Light {
     int type = 0; // 0=disabled, 1=ambient, 2=directional
     // Light direction is stored in the NIF's coordinate system (Z-up).
@@ -50,10 +58,30 @@ public:
     void loadNifModel(const std::string& path);
     void loadCustomSkeleton(const std::string& path);
     void detectAndSetSkeleton(const nifly::NifFile& nif);
+    static SkeletonHint detectSkeletonHint(const nifly::NifFile& nif);
+    void applySkeletonHint(const SkeletonHint& hint);
     void setGameDataDirectory(const std::string& path) { gameDataDirectory = path; }
     void setDataFolders(const std::vector<std::string>& folders);
+    bool enableSharedAssetCache(const std::string& name, size_t megabytes) { return assetManager.enableSharedCache(name, megabytes << 20); }
+    bool enableTextureDiskCache(const std::string& directory) { return textureManager.enableDiskCache(directory); }
+    bool enableMeshCache(const std::string& directory) { return meshCache.open(directory); }
     std::vector<std::string>& getDataFolders() { return dataFolders; }
 
+    // --- Texture Warm Pool ---
+    // Loads textures most NPCs share (race skin, eyes, brows, mouth) and pins them in VRAM, so
+    // the first portrait of each race doesn't pay for them and the budget never evicts them.
+    void warmTextures(const std::vector<std::string>& texturePaths);
+    // Reads the texture paths from a text file, one per line ('#' starts a comment).
+    bool warmTexturesFromList(const std::string& listPath);
+    // Adds the data folder of a NIF under '<folder>\meshes\' to the data folders, if it isn't
+    // listed yet. loadNifModel does this itself; call it first when warming ahead of a load.
+    void addNifDataFolder(const std::string& nifPath);
+    // Before a batch export, scans its first 'count' NIFs and warms the textures they share.
+    void setWarmScanCount(int count) { warmScanCount = std::max(count, 0); }
+    // Measure how much memory releasing each parsed NIF gives back, for the memory report.
+    // The memory panel turns this on for itself while it is open.
+    void setMeasureReleasedNifMemory(bool measure) { measureReleasedNifMemory = measure; }
+
     // --- Public Setters for Configurable Options ---
     void setBackgroundColor(const glm::vec3& color) { backgroundColor = color; }
     void setMugshotTopOffset(float offset) { headTopOffset = offset; }
@@ -64,10 +92,20 @@ public:
         camX = x; camY = y; camZ = z; camPitch = p; camYaw = yw;
     }
     void setFov(float fov) { m_cameraFovY = fov; }
+    void setTextureBudgetMB(int megabytes) {
+        textureBudgetMB = megabytes;
+        textureManager.setBudgetBytes(static_cast<size_t>(std::max(megabytes, 0)) << 20);
+    }
     void setLightingProfile(const std::string& path) { lightingProfilePath = path; }
     void setLightingProfileFromJsonString(const std::string& jsonString);
     bool TryParseLightingJson(const std::string& jsonString, std::vector<Light>& outLights) const;
 
+    // --- Diagnostics ---
+    // VRAM used by the loaded model's buffers and by every cached texture, as JSON.
+    nlohmann::json buildMemoryReport() const;
+    // Writes buildMemoryReport() to 'path', or to stdout for "-".
+    bool writeMemoryReport(const std::string& path) const;
+
     // --- Public Input Handlers ---
     void HandleMouseButton(int button, int action, int mods);
     void HandleCursorPosition(double xpos, double ypos);
@@ -89,7 +127,10 @@ private:
     void renderUI();
     void shutdownUI();
     void updateAssetManagerPaths();
+    uint32_t portraitTextureSizeCap() const;
+    std::vector<std::string> findSharedTextures(const std::vector<std::filesystem::path>& nifPaths);
     void logLightAngles(int lightIndex, int directionalLightCounter) const;
+    void renderMemoryPanel();
 
     // --- Core Members ---
     GLFWwindow* window = nullptr;
@@ -100,6 +141,7 @@ private:
     std::unique_ptr<NifModel> model;
     AssetManager assetManager;
     TextureManager textureManager;
+    MeshDiskCache meshCache;
     std::string appDirectory;
     int screenWidth, screenHeight;
     bool isHeadless = false;
@@ -167,6 +209,10 @@ private:
     int imageXRes = 750;
     int imageYRes = 750;
 
+    // VRAM budget for textures kept cached between model loads
+    int textureBudgetMB = 1024;
+    int warmScanCount = 0;
+
     // --- NEW: Mugshot framing offsets ---
     float headTopOffset = 0.20f;    // Default: 20% margin at the top
     float headBottomOffset = -0.05f; // Default: -5% margin (overshoot) at the bottom
@@ -177,6 +223,7 @@ private:
     // --- Add these for high-level load profiling ---
     std::chrono::high_resolution_clock::time_point nifLoadStartTime;
     bool newModelLoaded = false;
+    bool batchExporting = false; // processDirectory() is rendering straight to PNGs
 
     // Arrow resources
     unsigned int m_arrowVAO;      // <-- Add this
@@ -198,6 +245,9 @@ private:
     unsigned int m_labelVAO;
     unsigned int m_labelVBO;
 
+    bool m_showMemoryPanel = false;
+    bool measureReleasedNifMemory = false;
+
     // --- NEW: Compatibility Toggles ---
     bool m_suppressSpecularOnVertexColor = false;
 
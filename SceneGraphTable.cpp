@@ -0,0 +1,92 @@
+#include "SceneGraphTable.h"
+
+SceneGraphTable::SceneGraphTable(const nifly::NifFile& nif) : nif(nif) {
+    const auto& header = nif.GetHeader();
+    const uint32_t blockCount = header.GetNumBlocks();
+    parents.assign(blockCount, kNone);
+    depths.assign(blockCount, 0);
+    globalTransforms.resize(blockCount);
+    blockIndex.reserve(blockCount);
+
+    // Parents, from every node's child list. The first node to claim a child wins, as it does in
+    // GetParentNode.
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        auto* block = header.GetBlock<nifly::NiObject>(i);
+        if (!block) continue;
+        blockIndex.emplace(block, i);
+        if (auto* node = dynamic_cast<nifly::NiNode*>(block)) {
+            for (const auto& childRef : node->childRefs) {
+                const uint32_t child = childRef.index;
+                if (child < blockCount && child != i && parents[child] == kNone) {
+                    parents[child] = i;
+                }
+            }
+        }
+    }
+
+    // Root transforms and depths, composing each object onto its parent's once the parent is
+    // finished. Every block is resolved exactly once, so this is linear in the block count. A
+    // parent cycle (only possible in a malformed file) is cut where it closes, so the parent
+    // links always form a forest.
+    enum : uint8_t { Pending, Visiting, Done };
+    std::vector<uint8_t> state(blockCount, Pending);
+    std::vector<uint32_t> chain;
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        chain.clear();
+        for (uint32_t b = i; b != kNone && state[b] == Pending; b = parents[b]) {
+            state[b] = Visiting;
+            chain.push_back(b);
+        }
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            const uint32_t b = *it;
+            nifly::MatTransform local;
+            if (auto* object = header.GetBlock<nifly::NiAVObject>(b)) {
+                local = object->GetTransformToParent();
+            }
+            uint32_t& p = parents[b];
+            if (p != kNone && state[p] != Done) {
+                p = kNone;
+            }
+            if (p != kNone) {
+                // ComposeTransforms pre-multiplies, so this is parent * local.
+                globalTransforms[b] = globalTransforms[p].ComposeTransforms(local);
+                depths[b] = depths[p] + 1;
+            }
+            else {
+                globalTransforms[b] = local;
+            }
+            state[b] = Done;
+        }
+    }
+}
+
+uint32_t SceneGraphTable::indexOf(const nifly::NiObject* object) const {
+    auto it = blockIndex.find(object);
+    return it != blockIndex.end() ? it->second : kNone;
+}
+
+const nifly::MatTransform& SceneGraphTable::toGlobal(uint32_t block) const {
+    return block < globalTransforms.size() ? globalTransforms[block] : identity;
+}
+
+uint32_t SceneGraphTable::lowestCommonAncestor(const std::vector<uint32_t>& parents, const std::vector<uint32_t>& depths,
+    const std::vector<uint32_t>& blocks) {
+    if (blocks.empty() || blocks[0] >= parents.size()) return kNone;
+
+    // Fold the blocks into a running answer. Each step lifts the deeper of the two to the other's
+    // depth, then lifts both until they meet. The answer only ever moves up, so across the whole
+    // list it climbs at most the first block's depth.
+    uint32_t lca = blocks[0];
+    for (size_t i = 1; i < blocks.size(); ++i) {
+        uint32_t other = blocks[i];
+        if (other >= parents.size()) return kNone;
+        while (depths[other] > depths[lca]) other = parents[other];
+        while (depths[lca] > depths[other]) lca = parents[lca];
+        while (lca != other) {
+            lca = parents[lca];
+            other = parents[other];
+            if (lca == kNone || other == kNone) return kNone; // Different trees.
+        }
+    }
+    return lca;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <NifFile.hpp>
+
+// Every scene graph object's parent and NIF-root transform, indexed by block id and built in a
+// single pass over the file.
+//
+// nifly's GetParentNode scans the whole block list on each call, so walking an object up to the
+// root that way costs O(depth x blocks), and NifModel::load does it for every shape and every
+// bone. With the table built once per NIF, each lookup is O(1). The table only reads the file;
+// once built, it can be shared between threads.
+class SceneGraphTable {
+public:
+    static constexpr uint32_t kNone = 0xFFFFFFFF;
+
+    explicit SceneGraphTable(const nifly::NifFile& nif);
+
+    size_t size() const { return parents.size(); }
+
+    // Block id of 'object', or kNone if it isn't in this file.
+    uint32_t indexOf(const nifly::NiObject* object) const;
+
+    // Block id of the first NiNode that lists 'block' as a child (as GetParentNode would
+    // return), or kNone for the root and for blocks outside the scene graph.
+    uint32_t parent(uint32_t block) const { return block < parents.size() ? parents[block] : kNone; }
+
+    // The deepest block that is 'blocks[i]' or an ancestor of it for every i, or kNone if the
+    // blocks don't share a tree (or the list is empty). Linear in the number of blocks plus their
+    // depths.
+    uint32_t lowestCommonAncestor(const std::vector<uint32_t>& blocks) const { return lowestCommonAncestor(parents, depths, blocks); }
+
+    // The same over any forest given as parent links (kNone for roots) and depths, with every
+    // block id below parents.size().
+    static uint32_t lowestCommonAncestor(const std::vector<uint32_t>& parents, const std::vector<uint32_t>& depths,
+        const std::vector<uint32_t>& blocks);
+
+    // Transform from the object's local space to the NIF root space (Z-up, row-major), including
+    // the root's own transform. Identity for a null object or one outside the file.
+    const nifly::MatTransform& toGlobal(uint32_t block) const;
+    const nifly::MatTransform& toGlobal(const nifly::NiAVObject* object) const { return toGlobal(indexOf(object)); }
+
+private:
+    const nifly::NifFile& nif;
+    std::unordered_map<const nifly::NiObject*, uint32_t> blockIndex;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> depths;
+    std::vector<nifly::MatTransform> globalTransforms;
+    nifly::MatTransform identity;
+};
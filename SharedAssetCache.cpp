@@ -0,0 +1,636 @@
+#include "SharedAssetCache.h"
+#include "PathKey.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared-memory atomics must be lock-free to work across processes.");
+
+namespace {
+    constexpr uint64_t kMagic = 0x4E50434153534554ull; // "NPCASSET"
+    constexpr uint32_t kLayoutVersion = 2;
+    constexpr uint32_t kPageSize = 64 * 1024;
+    constexpr uint32_t kNoPage = 0xFFFFFFFFu;
+
+    // Two table slots per page, so live entries (one page or more each) never fill more than
+    // half the table and probe sequences stay short.
+    constexpr size_t kBytesPerEntry = kPageSize / 2;
+    constexpr uint32_t kMinEntries = 1024;
+
+    // Blobs larger than this share of the cache are not worth evicting everything else for.
+    constexpr uint32_t kMaxBlobShareDivisor = 4;
+
+    // The table is rebuilt once tombstones take up this share of it.
+    constexpr uint32_t kTombstoneShareDivisor = 4;
+
+    // Writers give up rather than stall a render if another process holds the lock this long,
+    // and then skip inserting for a while instead of paying the wait on every extraction.
+    constexpr auto kWriterLockTimeout = std::chrono::milliseconds(50);
+    constexpr auto kInsertBackoff = std::chrono::seconds(1);
+    // Attaching processes wait this long for the creator to finish initialising the region.
+    constexpr auto kAttachTimeout = std::chrono::seconds(2);
+
+    enum EntryState : uint32_t { kEmpty = 0, kLive = 1, kTombstone = 2 };
+
+    constexpr size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint32_t currentProcessId() {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+        return static_cast<uint32_t>(getpid());
+#endif
+    }
+
+    // False only when no process with this id is running. An id the system has already reused
+    // reads as alive, which leaves the lock held rather than breaking a live writer's.
+    bool processIsAlive(uint32_t pid) {
+#ifdef _WIN32
+        HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+        if (!process) return GetLastError() != ERROR_INVALID_PARAMETER;
+        const bool running = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+        CloseHandle(process);
+        return running;
+#else
+        return kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+#endif
+    }
+
+    uint64_t hashKey(uint64_t archiveFingerprint, const PathKey& key) {
+        uint64_t h = 14695981039346656037ull;
+        for (int i = 0; i < 8; ++i) {
+            h = (h ^ ((archiveFingerprint >> (i * 8)) & 0xFF)) * 1099511628211ull;
+        }
+        for (char c : key.view()) {
+            h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return h;
+    }
+}
+
+struct SharedAssetCache::Header {
+    uint64_t magic;
+    uint32_t layoutVersion;
+    uint32_t pageSize;
+    uint32_t entryCount; // Power of two.
+    uint32_t pageCount;
+    uint64_t entriesOffset;
+    uint64_t linksOffset;
+    uint64_t pagesOffset;
+    uint64_t totalBytes;
+    std::atomic<uint32_t> ready;
+    std::atomic<uint32_t> writerLock; // The owner's process id, 0 when free.
+    // Everything below is only touched while holding writerLock.
+    uint32_t clockHand;
+    uint32_t freeHead;
+    uint32_t freeCount;
+    uint32_t tombstoneCount;
+};
+
+// The stored blob is the normalised path followed by the file data, so a lookup can confirm
+// the key byte for byte instead of trusting the hash alone.
+struct SharedAssetCache::Entry {
+    std::atomic<uint32_t> sequence;   // Odd while a writer is changing the entry.
+    std::atomic<uint32_t> referenced; // Clock bit, set by readers on every hit.
+    uint32_t state;
+    uint32_t firstPage;
+    uint64_t keyHash;
+    uint64_t archiveFingerprint;
+    uint64_t dataSize;
+    uint32_t pathLength;
+    uint32_t pageCount;
+};
+
+SharedAssetCache::~SharedAssetCache() {
+    close();
+}
+
+SharedAssetCache::Header* SharedAssetCache::header() const {
+    return reinterpret_cast<Header*>(base);
+}
+
+SharedAssetCache::Entry* SharedAssetCache::entries() const {
+    return reinterpret_cast<Entry*>(base + header()->entriesOffset);
+}
+
+uint32_t* SharedAssetCache::pageLinks() const {
+    return reinterpret_cast<uint32_t*>(base + header()->linksOffset);
+}
+
+char* SharedAssetCache::page(uint32_t index) const {
+    return base + header()->pagesOffset + static_cast<size_t>(index) * header()->pageSize;
+}
+
+bool SharedAssetCache::open(const std::string& name, size_t capacityBytes) {
+    close();
+
+    // --- Layout ---
+    const uint32_t pageCount = static_cast<uint32_t>(std::max<size_t>(capacityBytes / kPageSize, 16));
+    uint32_t entryCount = kMinEntries;
+    while (entryCount < capacityBytes / kBytesPerEntry) entryCount <<= 1;
+    const size_t entriesOffset = alignUp(sizeof(Header), 64);
+    const size_t linksOffset = alignUp(entriesOffset + sizeof(Entry) * entryCount, 64);
+    const size_t pagesOffset = alignUp(linksOffset + sizeof(uint32_t) * pageCount, 4096);
+    const size_t totalBytes = pagesOffset + static_cast<size_t>(pageCount) * kPageSize;
+
+    // --- Create or attach ---
+    bool created = false;
+#ifdef _WIN32
+    std::wstring wideName = L"Local\\" + std::wstring(name.begin(), name.end());
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(static_cast<unsigned long long>(totalBytes) >> 32),
+        static_cast<DWORD>(totalBytes & 0xFFFFFFFFull), wideName.c_str());
+    if (!mapping) {
+        std::cerr << "Shared asset cache: CreateFileMapping failed (" << GetLastError() << ")." << std::endl;
+        return false;
+    }
+    created = GetLastError() != ERROR_ALREADY_EXISTS;
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, totalBytes);
+    if (!view) {
+        std::cerr << "Shared asset cache: MapViewOfFile failed (" << GetLastError() << ")." << std::endl;
+        CloseHandle(mapping);
+        return false;
+    }
+    mappingHandle = mapping;
+#else
+    // POSIX shared memory outlives its processes, so a later batch starts warm. Entries are
+    // keyed on the archive's size and modification time, so leftover data is never stale.
+    std::string shmName = "/" + name;
+    int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        created = true;
+        if (ftruncate(fd, static_cast<off_t>(totalBytes)) != 0) {
+            std::cerr << "Shared asset cache: could not size " << shmName << "." << std::endl;
+            ::close(fd);
+            shm_unlink(shmName.c_str());
+            return false;
+        }
+    }
+    else {
+        fd = shm_open(shmName.c_str(), O_RDWR, 0600);
+        struct stat st {};
+        // The creator may not have sized the region yet.
+        auto deadline = std::chrono::steady_clock::now() + kAttachTimeout;
+        while (fd >= 0 && fstat(fd, &st) == 0 && st.st_size == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        if (fd < 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != totalBytes) {
+            std::cerr << "Shared asset cache: could not attach to " << shmName
+                << " (missing, or created with a different capacity)." << std::endl;
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+    }
+    void* view = mmap(nullptr, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        std::cerr << "Shared asset cache: mmap failed." << std::endl;
+        return false;
+    }
+#endif
+    base = static_cast<char*>(view);
+    mappedBytes = totalBytes;
+
+    Header* h = header();
+    if (created) {
+        // Fresh mappings are zero-filled, so every entry already starts out empty.
+        h->magic = kMagic;
+        h->layoutVersion = kLayoutVersion;
+        h->pageSize = kPageSize;
+        h->entryCount = entryCount;
+        h->pageCount = pageCount;
+        h->entriesOffset = entriesOffset;
+        h->linksOffset = linksOffset;
+        h->pagesOffset = pagesOffset;
+        h->totalBytes = totalBytes;
+        h->clockHand = 0;
+        h->tombstoneCount = 0;
+        uint32_t* links = pageLinks();
+        for (uint32_t i = 0; i < pageCount; ++i) {
+            links[i] = (i + 1 < pageCount) ? i + 1 : kNoPage;
+        }
+        h->freeHead = 0;
+        h->freeCount = pageCount;
+        h->ready.store(1, std::memory_order_release);
+    }
+    else {
+        auto deadline = std::chrono::steady_clock::now() + kAttachTimeout;
+        while (h->ready.load(std::memory_order_acquire) == 0) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                std::cerr << "Shared asset cache: timed out waiting for '" << name << "' to be initialised. "
+                    << "If a process crashed while creating it, remove the region and retry." << std::endl;
+                close();
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        if (h->magic != kMagic || h->layoutVersion != kLayoutVersion || h->totalBytes != totalBytes) {
+            std::cerr << "Shared asset cache: existing region '" << name << "' has an incompatible layout." << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    std::cout << "--- Shared asset cache '" << name << "' " << (created ? "created" : "attached") << ": "
+        << (totalBytes >> 20) << " MB, " << entryCount << " entries ---" << std::endl;
+    return true;
+}
+
+void SharedAssetCache::close() {
+    if (!base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+    CloseHandle(static_cast<HANDLE>(mappingHandle));
+    mappingHandle = nullptr;
+#else
+    munmap(base, mappedBytes);
+#endif
+    base = nullptr;
+    mappedBytes = 0;
+}
+
+bool SharedAssetCache::tryLockWriter() {
+    const uint32_t self = currentProcessId();
+    auto deadline = std::chrono::steady_clock::now() + kWriterLockTimeout;
+    std::atomic<uint32_t>& lock = header()->writerLock;
+    for (;;) {
+        uint32_t owner = 0;
+        if (lock.compare_exchange_weak(owner, self, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            // A process that died holding the lock can't release it. Take it over, and since the
+            // dead writer may have left entries or the free list half-updated, start afresh.
+            if (owner == 0 || processIsAlive(owner) ||
+                !lock.compare_exchange_strong(owner, self, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return false;
+            }
+            std::cerr << "Shared asset cache: process " << owner << " exited while writing to the cache; clearing it." << std::endl;
+            clearTable();
+            return true;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void SharedAssetCache::unlockWriter() {
+    header()->writerLock.store(0, std::memory_order_release);
+}
+
+// Writer lock held. Empties every slot and frees every page. Readers see each slot's sequence
+// end up even again but changed, so any read that overlapped this misses.
+void SharedAssetCache::clearTable() {
+    Header* h = header();
+    Entry* table = entries();
+    for (uint32_t i = 0; i < h->entryCount; ++i) {
+        Entry& entry = table[i];
+        // A writer that died mid-update leaves the sequence odd; only make it odd if it isn't.
+        if ((entry.sequence.load(std::memory_order_relaxed) & 1u) == 0) {
+            entry.sequence.fetch_add(1, std::memory_order_acq_rel);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.state = kEmpty;
+        entry.firstPage = kNoPage;
+        entry.pageCount = 0;
+        entry.referenced.store(0, std::memory_order_relaxed);
+        entry.sequence.fetch_add(1, std::memory_order_release);
+    }
+    uint32_t* links = pageLinks();
+    for (uint32_t i = 0; i < h->pageCount; ++i) {
+        links[i] = (i + 1 < h->pageCount) ? i + 1 : kNoPage;
+    }
+    h->freeHead = 0;
+    h->freeCount = h->pageCount;
+    h->clockHand = 0;
+    h->tombstoneCount = 0;
+}
+
+// Copies 'length' bytes starting 'offset' bytes into a page chain. Returns false if the chain
+// is inconsistent, which only happens when a writer recycled the pages mid-read.
+bool SharedAssetCache::copyFromPages(uint32_t firstPage, size_t offset, size_t length, char* dst) const {
+    const uint32_t pageSize = header()->pageSize;
+    const uint32_t pageCount = header()->pageCount;
+    const uint32_t* links = pageLinks();
+
+    uint32_t current = firstPage;
+    while (offset >= pageSize) {
+        if (current >= pageCount) return false;
+        current = links[current];
+        offset -= pageSize;
+    }
+    while (length > 0) {
+        if (current >= pageCount) return false;
+        size_t chunk = std::min<size_t>(length, pageSize - offset);
+        std::memcpy(dst, page(current) + offset, chunk);
+        dst += chunk;
+        length -= chunk;
+        offset = 0;
+        current = links[current];
+    }
+    return true;
+}
+
+// Seqlock read of one entry. With 'out' null it only confirms that the entry holds 'key'.
+bool SharedAssetCache::readEntry(const Entry& entry, uint64_t archiveFingerprint, const PathKey& key, std::vector<char>* out) const {
+    uint32_t before = entry.sequence.load(std::memory_order_acquire);
+    if (before & 1u) return false;
+
+    const uint32_t firstPage = entry.firstPage;
+    const uint32_t pathLength = entry.pathLength;
+    const uint64_t dataSize = entry.dataSize;
+    if (entry.state != kLive || entry.archiveFingerprint != archiveFingerprint || pathLength != key.size() || dataSize > mappedBytes) {
+        return false;
+    }
+
+    char storedPath[512];
+    std::string longPath;
+    char* pathBuffer = storedPath;
+    if (pathLength > sizeof(storedPath)) {
+        longPath.resize(pathLength);
+        pathBuffer = longPath.data();
+    }
+    bool ok = copyFromPages(firstPage, 0, pathLength, pathBuffer);
+    if (ok && out) {
+        out->resize(static_cast<size_t>(dataSize));
+        ok = copyFromPages(firstPage, pathLength, static_cast<size_t>(dataSize), out->data());
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!ok || entry.sequence.load(std::memory_order_relaxed) != before) return false;
+    return std::memcmp(pathBuffer, key.view().data(), pathLength) == 0;
+}
+
+SharedAssetCache::Entry* SharedAssetCache::findLive(uint64_t keyHash, uint64_t archiveFingerprint, const PathKey& key) const {
+    const uint32_t mask = header()->entryCount - 1;
+    Entry* table = entries();
+    for (uint32_t probe = 0; probe <= mask; ++probe) {
+        Entry& entry = table[(keyHash + probe) & mask];
+        uint32_t state = entry.state;
+        if (state == kEmpty) return nullptr;
+        if (state == kLive && entry.keyHash == keyHash && entry.archiveFingerprint == archiveFingerprint &&
+            readEntry(entry, archiveFingerprint, key, nullptr)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+bool SharedAssetCache::lookup(uint64_t archiveFingerprint, const PathKey& key, std::vector<char>& out) const {
+    if (!base || key.empty()) return false;
+
+    const uint64_t keyHash = hashKey(archiveFingerprint, key);
+    if (Entry* entry = findLive(keyHash, archiveFingerprint, key)) {
+        if (readEntry(*entry, archiveFingerprint, key, &out)) {
+            entry->referenced.store(1, std::memory_order_relaxed);
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    out.clear();
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+// Writer lock held.
+void SharedAssetCache::evict(Entry& entry) {
+    Header* h = header();
+    uint32_t* links = pageLinks();
+
+    entry.sequence.fetch_add(1, std::memory_order_acq_rel); // Now odd: readers back off.
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t current = entry.firstPage;
+    for (uint32_t i = 0; i < entry.pageCount && current < h->pageCount; ++i) {
+        uint32_t next = links[current];
+        links[current] = h->freeHead;
+        h->freeHead = current;
+        ++h->freeCount;
+        current = next;
+    }
+    if (entry.state == kLive) ++h->tombstoneCount;
+    entry.state = kTombstone;
+    entry.firstPage = kNoPage;
+    entry.pageCount = 0;
+
+    entry.sequence.fetch_add(1, std::memory_order_release);
+    reclaimTombstones(static_cast<uint32_t>(&entry - entries()));
+}
+
+// Writer lock held. A tombstone only has to stay while some live entry's probe sequence runs
+// past it, and none can once the next slot is empty. In that case the run of tombstones ending
+// at 'slot' becomes empty again, so evictions shorten probe sequences instead of leaving every
+// miss to walk further through the table.
+void SharedAssetCache::reclaimTombstones(uint32_t slot) {
+    Entry* table = entries();
+    const uint32_t mask = header()->entryCount - 1;
+    if (table[(slot + 1) & mask].state != kEmpty) return;
+    for (uint32_t i = slot; table[i].state == kTombstone; i = (i - 1) & mask) {
+        table[i].state = kEmpty;
+        --header()->tombstoneCount;
+    }
+}
+
+// Writer lock held. Tombstones whose next slot is occupied can't be reclaimed one at a time,
+// and enough evictions leave a table with no empty slots at all, so that every miss probes all
+// of it. Once tombstones reach a share of the table, every live entry is placed again in a
+// cleared one. Only the slots move, never the pages; a reader that races with this sees the
+// sequence change or a different key and misses, which a cache can afford.
+void SharedAssetCache::rebuildTable() {
+    struct Placement {
+        uint64_t keyHash;
+        uint64_t archiveFingerprint;
+        uint64_t dataSize;
+        uint32_t firstPage;
+        uint32_t pageCount;
+        uint32_t pathLength;
+        uint32_t referenced;
+    };
+    Header* h = header();
+    Entry* table = entries();
+    const uint32_t mask = h->entryCount - 1;
+
+    std::vector<Placement> live;
+    for (uint32_t i = 0; i <= mask; ++i) {
+        Entry& entry = table[i];
+        if (entry.state == kEmpty) continue;
+        if (entry.state == kLive) {
+            live.push_back({ entry.keyHash, entry.archiveFingerprint, entry.dataSize, entry.firstPage, entry.pageCount,
+                entry.pathLength, entry.referenced.load(std::memory_order_relaxed) });
+        }
+        entry.sequence.fetch_add(1, std::memory_order_acq_rel);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.state = kEmpty;
+        entry.firstPage = kNoPage;
+        entry.pageCount = 0;
+        entry.sequence.fetch_add(1, std::memory_order_release);
+    }
+    h->tombstoneCount = 0;
+
+    for (const Placement& placement : live) {
+        uint32_t i = static_cast<uint32_t>(placement.keyHash) & mask;
+        while (table[i].state != kEmpty) i = (i + 1) & mask;
+        publish(table[i], placement.keyHash, placement.archiveFingerprint, placement.firstPage, placement.pageCount,
+            placement.pathLength, placement.dataSize, placement.referenced);
+    }
+}
+
+// Writer lock held. Fills a free slot and makes it visible to readers.
+void SharedAssetCache::publish(Entry& slot, uint64_t keyHash, uint64_t archiveFingerprint, uint32_t firstPage, uint32_t pageCount,
+    uint32_t pathLength, uint64_t dataSize, uint32_t referenced) {
+    if (slot.state == kTombstone) --header()->tombstoneCount;
+    slot.sequence.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.keyHash = keyHash;
+    slot.archiveFingerprint = archiveFingerprint;
+    slot.firstPage = firstPage;
+    slot.pageCount = pageCount;
+    slot.pathLength = pathLength;
+    slot.dataSize = dataSize;
+    slot.referenced.store(referenced, std::memory_order_relaxed);
+    slot.state = kLive;
+    slot.sequence.fetch_add(1, std::memory_order_release);
+}
+
+// Writer lock held. Runs the clock hand until enough pages are free.
+bool SharedAssetCache::reserveSpace(uint32_t pagesNeeded) {
+    Header* h = header();
+    Entry* table = entries();
+    const uint32_t mask = h->entryCount - 1;
+
+    // Two full sweeps: the first may only clear reference bits.
+    for (uint32_t step = 0; h->freeCount < pagesNeeded && step < 2 * h->entryCount; ++step) {
+        Entry& entry = table[h->clockHand];
+        h->clockHand = (h->clockHand + 1) & mask;
+        if (entry.state != kLive) continue;
+        if (entry.referenced.exchange(0, std::memory_order_relaxed) != 0) continue; // Second chance.
+        evict(entry);
+    }
+    return h->freeCount >= pagesNeeded;
+}
+
+SharedAssetCache::TableStats SharedAssetCache::tableStats() const {
+    TableStats stats;
+    if (!base) return stats;
+    const Entry* table = entries();
+    stats.entries = header()->entryCount;
+    uint32_t firstEmpty = stats.entries;
+    for (uint32_t i = 0; i < stats.entries; ++i) {
+        const uint32_t state = table[i].state;
+        if (state == kLive) ++stats.live;
+        else if (state == kTombstone) ++stats.tombstones;
+        else if (firstEmpty == stats.entries) firstEmpty = i;
+    }
+    if (firstEmpty == stats.entries) {
+        stats.longestRun = stats.entries;
+        return stats;
+    }
+    // Runs can wrap around the end of the table, so walk it once starting after an empty slot.
+    uint32_t run = 0;
+    for (uint32_t step = 1; step <= stats.entries; ++step) {
+        const uint32_t i = (firstEmpty + step) & (stats.entries - 1);
+        run = table[i].state == kEmpty ? 0 : run + 1;
+        stats.longestRun = std::max(stats.longestRun, run);
+    }
+    return stats;
+}
+
+void SharedAssetCache::remove(const std::string& name) {
+#ifdef _WIN32
+    // The mapping goes away with the last handle to it.
+    (void)name;
+#else
+    shm_unlink(("/" + name).c_str());
+#endif
+}
+
+void SharedAssetCache::insert(uint64_t archiveFingerprint, const PathKey& key, const std::vector<char>& data) {
+    if (!base || key.empty() || data.empty()) return;
+
+    Header* h = header();
+    const size_t blobBytes = key.size() + data.size();
+    const uint32_t pagesNeeded = static_cast<uint32_t>((blobBytes + h->pageSize - 1) / h->pageSize);
+    if (pagesNeeded > h->pageCount / kMaxBlobShareDivisor) return;
+
+    const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    if (now < insertsPausedUntil.load(std::memory_order_relaxed)) return;
+    if (!tryLockWriter()) {
+        // Caching is best-effort. Another live process is holding the lock for a long time, so
+        // only read from the cache for a while, then try again.
+        insertsPausedUntil.store((std::chrono::steady_clock::now() + kInsertBackoff).time_since_epoch().count(), std::memory_order_relaxed);
+        if (!reportedBusyLock.exchange(true)) {
+            std::cerr << "Shared asset cache: writer lock is busy; skipping inserts for a while." << std::endl;
+        }
+        return;
+    }
+
+    const uint64_t keyHash = hashKey(archiveFingerprint, key);
+    if (findLive(keyHash, archiveFingerprint, key) || !reserveSpace(pagesNeeded)) {
+        unlockWriter();
+        return;
+    }
+    if (h->tombstoneCount >= h->entryCount / kTombstoneShareDivisor) {
+        rebuildTable();
+    }
+
+    // Find a reusable slot along the probe sequence.
+    Entry* table = entries();
+    const uint32_t mask = h->entryCount - 1;
+    Entry* slot = nullptr;
+    for (uint32_t probe = 0; probe <= mask; ++probe) {
+        Entry& candidate = table[(keyHash + probe) & mask];
+        if (candidate.state != kLive) {
+            slot = &candidate;
+            break;
+        }
+    }
+    if (!slot) {
+        // Table full of live entries: free the one under the clock hand for a later insert.
+        evict(table[h->clockHand]);
+        h->clockHand = (h->clockHand + 1) & mask;
+        unlockWriter();
+        return;
+    }
+
+    // Take pages from the free list and copy the path followed by the data.
+    uint32_t* links = pageLinks();
+    uint32_t firstPage = h->freeHead;
+    uint32_t current = firstPage;
+    size_t written = 0;
+    for (uint32_t i = 0; i < pagesNeeded; ++i) {
+        char* dst = page(current);
+        size_t chunk = std::min<size_t>(h->pageSize, blobBytes - written);
+        size_t pathPart = written < key.size() ? std::min(chunk, key.size() - written) : 0;
+        if (pathPart > 0) {
+            std::memcpy(dst, key.view().data() + written, pathPart);
+        }
+        if (chunk > pathPart) {
+            std::memcpy(dst + pathPart, data.data() + (written + pathPart - key.size()), chunk - pathPart);
+        }
+        written += chunk;
+        if (i + 1 < pagesNeeded) current = links[current];
+    }
+    h->freeHead = links[current];
+    links[current] = kNoPage;
+    h->freeCount -= pagesNeeded;
+
+    publish(*slot, keyHash, archiveFingerprint, firstPage, pagesNeeded, static_cast<uint32_t>(key.size()), data.size(), 1);
+
+    unlockWriter();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class PathKey;
+
+// A cache of extracted asset blobs that lives in named shared memory, so several render
+// processes on the same machine only decompress each archived file once between them.
+//
+// Entries are keyed by an archive fingerprint (name, size, modification time) plus the
+// normalised path, so a modified or replaced archive never serves stale data.
+//
+// Lookups are lock-free: every table entry carries a sequence counter (a seqlock), and a
+// reader retries or gives up if a writer touched the entry while it was copying. Inserts
+// and evictions are serialised by a process-shared spinlock that records its owner's process
+// id, so a lock left behind by a crashed process can be taken over. Blob data lives in a chain
+// of fixed-size pages, and space is reclaimed with a clock (second chance) sweep over entries.
+//
+// The cache is opt-in. Until open() succeeds, lookup() always misses and insert() does nothing.
+class SharedAssetCache {
+public:
+    SharedAssetCache() = default;
+    ~SharedAssetCache();
+
+    SharedAssetCache(const SharedAssetCache&) = delete;
+    SharedAssetCache& operator=(const SharedAssetCache&) = delete;
+
+    // Creates or attaches to the named region. Processes that share a cache must use the
+    // same name and capacity; the first process to create the region sets its layout.
+    bool open(const std::string& name, size_t capacityBytes);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    // Deletes the named region so the next open() creates it afresh. Processes still attached
+    // keep their mapping. POSIX regions otherwise outlive their processes; on Windows the
+    // region already goes away with its last handle, so this does nothing there.
+    static void remove(const std::string& name);
+
+    bool lookup(uint64_t archiveFingerprint, const PathKey& key, std::vector<char>& out) const;
+    void insert(uint64_t archiveFingerprint, const PathKey& key, const std::vector<char>& data);
+
+    // Per-process counters, for logging.
+    uint64_t hitCount() const { return hits.load(std::memory_order_relaxed); }
+    uint64_t missCount() const { return misses.load(std::memory_order_relaxed); }
+
+    // Table occupancy, for self-checks. 'longestRun' is the longest stretch of occupied (live or
+    // tombstone) slots, which bounds how far a miss probes. Not synchronised with writers.
+    struct TableStats {
+        uint32_t entries = 0;
+        uint32_t live = 0;
+        uint32_t tombstones = 0;
+        uint32_t longestRun = 0;
+    };
+    TableStats tableStats() const;
+
+private:
+    struct Header;
+    struct Entry;
+
+    Header* header() const;
+    Entry* entries() const;
+    uint32_t* pageLinks() const;
+    char* page(uint32_t index) const;
+
+    bool tryLockWriter();
+    void unlockWriter();
+    void clearTable();
+
+    Entry* findLive(uint64_t keyHash, uint64_t archiveFingerprint, const PathKey& key) const;
+    bool readEntry(const Entry& entry, uint64_t archiveFingerprint, const PathKey& key, std::vector<char>* out) const;
+    bool copyFromPages(uint32_t firstPage, size_t offset, size_t length, char* dst) const;
+    void evict(Entry& entry);
+    void reclaimTombstones(uint32_t slot);
+    void rebuildTable();
+    void publish(Entry& slot, uint64_t keyHash, uint64_t archiveFingerprint, uint32_t firstPage, uint32_t pageCount,
+        uint32_t pathLength, uint64_t dataSize, uint32_t referenced);
+    bool reserveSpace(uint32_t pagesNeeded);
+
+    char* base = nullptr;
+    size_t mappedBytes = 0;
+#ifdef _WIN32
+    void* mappingHandle = nullptr;
+#endif
+
+    std::atomic<int64_t> insertsPausedUntil{ 0 }; // steady_clock ticks; set after a lock timeout.
+    std::atomic<bool> reportedBusyLock{ false };
+    mutable std::atomic<uint64_t> hits{ 0 };
+    mutable std::atomic<uint64_t> misses{ 0 };
+};
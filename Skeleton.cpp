@@ -5,46 +5,58 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
 #include "CommonMatrices.h"
+#include "MemoryStream.h"
+#include "ContentHash.h"
 
 void Skeleton::clear() {
     boneWorldTransforms.clear();
+    fingerprint = 0;
 }
 
 bool Skeleton::loadFromFile(const std::string& path) {
     clear();
+    nifly::NifFile nif;
     if (nif.Load(path) != 0) {
         std::cerr << "Error: Failed to load skeleton file: " << path << std::endl;
         return false;
     }
     std::cout << "Successfully loaded skeleton: " << path << std::endl;
-    parseNif();
+    parseNif(nif);
     return true;
 }
 
 bool Skeleton::loadFromMemory(const std::vector<char>& buffer, const std::string& name) {
     clear();
 
-    // Use a stringstream to create an istream from the memory buffer
-    std::stringstream ss(std::string(buffer.begin(), buffer.end()));
+    // Parse the buffer in place rather than copying it into a stringstream.
+    MemoryInputStream stream(buffer.data(), buffer.size());
 
-    if (nif.Load(ss) != 0) { // Call Load with the stringstream
+    nifly::NifFile nif;
+    if (nif.Load(stream) != 0) {
         std::cerr << "Error: Failed to load skeleton from memory: " << name << std::endl;
         return false;
     }
 
     std::cout << "Successfully loaded skeleton from BSA: " << name << std::endl;
-    parseNif();
+    parseNif(nif);
     return true;
 }
 
-void Skeleton::parseNif() {
+void Skeleton::parseNif(const nifly::NifFile& nif) {
     auto* root = nif.GetRootNode();
     if (root) {
-        processNode(root, nifly::MatTransform()); // Start with identity parent transform
+        processNode(nif, root, nifly::MatTransform()); // Start with identity parent transform
+    }
+
+    // The map is ordered by name, so the same skeleton always hashes the same.
+    fingerprint = 0;
+    for (const auto& [boneName, transform] : boneWorldTransforms) {
+        fingerprint = contentHash64(boneName.data(), boneName.size(), fingerprint);
+        fingerprint = contentHash64(glm::value_ptr(transform), sizeof(transform), fingerprint);
     }
 }
 
-void Skeleton::processNode(nifly::NiNode* node, const nifly::MatTransform& parentTransform) {
+void Skeleton::processNode(const nifly::NifFile& nif, nifly::NiNode* node, const nifly::MatTransform& parentTransform) {
     if (!node) {
         return;
     }
@@ -77,7 +89,7 @@ void Skeleton::processNode(nifly::NiNode* node, const nifly::MatTransform& paren
 
     for (const auto& childRef : node->childRefs) { // Corrected to 'childRefs'
         if (auto* childNode = nif.GetHeader().GetBlock<nifly::NiNode>(childRef)) {
-            processNode(childNode, worldTransform);
+            processNode(nif, childNode, worldTransform);
         }
     }
 }
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -19,12 +20,16 @@ public:
     glm::mat4 getBoneTransform(const std::string& boneName) const;
     bool hasBone(const std::string& boneName) const;
     bool isLoaded() const { return !boneWorldTransforms.empty(); }
+    // A hash of every bone's name and transform, so caches of posed results can tell skeletons
+    // apart. 0 when nothing is loaded.
+    uint64_t getFingerprint() const { return fingerprint; }
     void clear();
 
 private:
-    void parseNif();
-    void processNode(nifly::NiNode* node, const nifly::MatTransform& parentTransform);
+    // Only the bone transforms are kept; the parsed file is dropped once they're read.
+    void parseNif(const nifly::NifFile& nif);
+    void processNode(const nifly::NifFile& nif, nifly::NiNode* node, const nifly::MatTransform& parentTransform);
 
-    nifly::NifFile nif;
     std::map<std::string, glm::mat4> boneWorldTransforms;
+    uint64_t fingerprint = 0;
 };
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "SkinningKernel.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SKINNING_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+// MSVC accepts any intrinsic without per-function target flags.
+#define SKINNING_TARGET_AVX2
+#else
+#define SKINNING_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define SKINNING_X86 0
+#endif
+
+namespace Skinning {
+
+namespace {
+
+    // The running reduction. Sums are kept in double so a large shape's centroid doesn't drift.
+    struct Accumulator {
+        float min[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        float max[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+        double sum[3] = { 0.0, 0.0, 0.0 };
+
+        void add(float x, float y, float z) {
+            const float p[3] = { x, y, z };
+            for (int c = 0; c < 3; ++c) {
+                min[c] = std::min(min[c], p[c]);
+                max[c] = std::max(max[c], p[c]);
+                sum[c] += p[c];
+            }
+        }
+
+        PosedBounds result(size_t count) const {
+            PosedBounds bounds;
+            for (int c = 0; c < 3; ++c) {
+                bounds.min[c] = min[c];
+                bounds.max[c] = max[c];
+                bounds.centroid[c] = count ? static_cast<float>(sum[c] / static_cast<double>(count)) : 0.0f;
+            }
+            return bounds;
+        }
+    };
+
+    // a * b for affine transforms.
+    Affine compose(const Affine& a, const Affine& b) {
+        Affine out;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                out.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + (c == 3 ? a.m[r][3] : 0.0f);
+            }
+        }
+        return out;
+    }
+
+    // One output coordinate. The vector paths evaluate in exactly this order (and without fused
+    // multiply-adds), so every backend poses a vertex to the same bits.
+    inline float transformRow(const float* row, float x, float y, float z) {
+        return ((row[0] * x + row[1] * y) + row[2] * z) + row[3];
+    }
+
+    // Poses vertex i against bones that already include the root transform.
+    inline void poseVertex(const Streams& v, size_t i, const Affine* rootBones, const Affine& toRoot, float out[3]) {
+        const float x = v.x[i], y = v.y[i], z = v.z[i];
+        if (v.weights[0]) {
+            float posed[3] = { 0.0f, 0.0f, 0.0f };
+            float total = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                const float w = v.weights[k][i];
+                const Affine& bone = rootBones[v.boneIds[k][i]];
+                for (int c = 0; c < 3; ++c) {
+                    posed[c] = posed[c] + w * transformRow(bone.m[c], x, y, z);
+                }
+                total = total + w;
+            }
+            if (total > 0.0f) {
+                for (int c = 0; c < 3; ++c) out[c] = posed[c] / total;
+                return;
+            }
+        }
+        for (int c = 0; c < 3; ++c) out[c] = transformRow(toRoot.m[c], x, y, z);
+    }
+
+    void reduceScalar(const Streams& v, size_t begin, const Affine* rootBones, const Affine& toRoot, Accumulator& acc) {
+        for (size_t i = begin; i < v.count; ++i) {
+            float p[3];
+            poseVertex(v, i, rootBones, toRoot, p);
+            acc.add(p[0], p[1], p[2]);
+        }
+    }
+
+#if SKINNING_X86
+    SKINNING_TARGET_AVX2 inline __m256 transformRowAVX2(__m256 m0, __m256 m1, __m256 m2, __m256 m3, __m256 x, __m256 y, __m256 z) {
+        return _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, x), _mm256_mul_ps(m1, y)), _mm256_mul_ps(m2, z)), m3);
+    }
+
+    SKINNING_TARGET_AVX2 void reduceAVX2(const Streams& v, const Affine* rootBones, const Affine& toRoot, Accumulator& acc) {
+        const float* boneBase = &rootBones[0].m[0][0];
+        const __m256i floatsPerBone = _mm256_set1_epi32(12);
+
+        __m256 minV[3], maxV[3];
+        __m256d sumLow[3], sumHigh[3];
+        for (int c = 0; c < 3; ++c) {
+            minV[c] = _mm256_set1_ps(std::numeric_limits<float>::max());
+            maxV[c] = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+            sumLow[c] = _mm256_setzero_pd();
+            sumHigh[c] = _mm256_setzero_pd();
+        }
+
+        const size_t vectorCount = v.count & ~size_t(7);
+        for (size_t i = 0; i < vectorCount; i += 8) {
+            const __m256 x = _mm256_loadu_ps(v.x + i);
+            const __m256 y = _mm256_loadu_ps(v.y + i);
+            const __m256 z = _mm256_loadu_ps(v.z + i);
+
+            __m256 rigid[3];
+            for (int c = 0; c < 3; ++c) {
+                rigid[c] = transformRowAVX2(_mm256_set1_ps(toRoot.m[c][0]), _mm256_set1_ps(toRoot.m[c][1]),
+                    _mm256_set1_ps(toRoot.m[c][2]), _mm256_set1_ps(toRoot.m[c][3]), x, y, z);
+            }
+
+            __m256 out[3] = { rigid[0], rigid[1], rigid[2] };
+            if (v.weights[0]) {
+                __m256 posed[3] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+                __m256 total = _mm256_setzero_ps();
+                for (int k = 0; k < 4; ++k) {
+                    const __m256 w = _mm256_loadu_ps(v.weights[k] + i);
+                    const __m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.boneIds[k] + i));
+                    const __m256i offsets = _mm256_mullo_epi32(ids, floatsPerBone);
+                    for (int c = 0; c < 3; ++c) {
+                        const float* row = boneBase + c * 4;
+                        const __m256 t = transformRowAVX2(_mm256_i32gather_ps(row, offsets, 4), _mm256_i32gather_ps(row + 1, offsets, 4),
+                            _mm256_i32gather_ps(row + 2, offsets, 4), _mm256_i32gather_ps(row + 3, offsets, 4), x, y, z);
+                        posed[c] = _mm256_add_ps(posed[c], _mm256_mul_ps(w, t));
+                    }
+                    total = _mm256_add_ps(total, w);
+                }
+                // Lanes with no weight divide by zero here, but keep their rigid position.
+                const __m256 weighted = _mm256_cmp_ps(total, _mm256_setzero_ps(), _CMP_GT_OQ);
+                for (int c = 0; c < 3; ++c) {
+                    out[c] = _mm256_blendv_ps(rigid[c], _mm256_div_ps(posed[c], total), weighted);
+                }
+            }
+
+            for (int c = 0; c < 3; ++c) {
+                minV[c] = _mm256_min_ps(minV[c], out[c]);
+                maxV[c] = _mm256_max_ps(maxV[c], out[c]);
+                sumLow[c] = _mm256_add_pd(sumLow[c], _mm256_cvtps_pd(_mm256_castps256_ps128(out[c])));
+                sumHigh[c] = _mm256_add_pd(sumHigh[c], _mm256_cvtps_pd(_mm256_extractf128_ps(out[c], 1)));
+            }
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            alignas(32) float lanesMin[8], lanesMax[8];
+            alignas(32) double lanesSum[4];
+            _mm256_store_ps(lanesMin, minV[c]);
+            _mm256_store_ps(lanesMax, maxV[c]);
+            _mm256_store_pd(lanesSum, _mm256_add_pd(sumLow[c], sumHigh[c]));
+            for (int lane = 0; lane < 8; ++lane) {
+                acc.min[c] = std::min(acc.min[c], lanesMin[lane]);
+                acc.max[c] = std::max(acc.max[c], lanesMax[lane]);
+            }
+            acc.sum[c] += (lanesSum[0] + lanesSum[1]) + (lanesSum[2] + lanesSum[3]);
+        }
+
+        reduceScalar(v, vectorCount, rootBones, toRoot, acc);
+    }
+#endif
+
+    Backend detectBackend() {
+#if SKINNING_X86
+        if (DetectedCpuFeatures().avx2) return Backend::AVX2;
+#endif
+        return Backend::Scalar;
+    }
+
+}
+
+void StreamStorage::resize(size_t count, bool skinned) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    for (int k = 0; k < 4; ++k) {
+        boneIds[k].assign(skinned ? count : 0, 0);
+        weights[k].assign(skinned ? count : 0, 0.0f);
+    }
+}
+
+Streams StreamStorage::view() const {
+    Streams v;
+    v.count = x.size();
+    v.x = x.data();
+    v.y = y.data();
+    v.z = z.data();
+    if (!weights[0].empty()) {
+        for (int k = 0; k < 4; ++k) {
+            v.boneIds[k] = boneIds[k].data();
+            v.weights[k] = weights[k].data();
+        }
+    }
+    return v;
+}
+
+const char* backendName(Backend backend) {
+    switch (backend) {
+    case Backend::Scalar: return "scalar";
+    case Backend::AVX2: return "AVX2";
+    }
+    return "?";
+}
+
+Backend bestBackend() {
+    static const Backend backend = detectBackend();
+    return backend;
+}
+
+PosedBounds posedBounds(const Streams& vertices, const Affine* bones, size_t boneCount, const Affine& toRoot) {
+    return posedBounds(vertices, bones, boneCount, toRoot, bestBackend());
+}
+
+PosedBounds posedBounds(const Streams& vertices, const Affine* bones, size_t boneCount, const Affine& toRoot, Backend backend) {
+    // Fold the root transform into each bone once rather than applying it per vertex. Skinning
+    // is a weighted average of affine transforms, so the result is the same.
+    Streams v = vertices;
+    std::vector<Affine> rootBones;
+    if (v.weights[0] && boneCount > 0) {
+        rootBones.reserve(boneCount);
+        for (size_t b = 0; b < boneCount; ++b) rootBones.push_back(compose(toRoot, bones[b]));
+    }
+    else {
+        for (int k = 0; k < 4; ++k) {
+            v.boneIds[k] = nullptr;
+            v.weights[k] = nullptr;
+        }
+    }
+
+    Accumulator acc;
+#if SKINNING_X86
+    if (backend == Backend::AVX2) {
+        reduceAVX2(v, rootBones.data(), toRoot, acc);
+        return acc.result(v.count);
+    }
+#else
+    (void)backend;
+#endif
+    reduceScalar(v, 0, rootBones.data(), toRoot, acc);
+    return acc.result(v.count);
+}
+
+}
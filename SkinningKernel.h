@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU linear blend skinning, reduced straight to the posed bounding box and centroid.
+//
+// NifModel needs each shape's posed extent to frame the camera, but never the posed vertices
+// themselves, so the kernel poses a vertex, folds it into the running min/max/sum and moves on.
+// Vertices are read in structure-of-arrays form so the AVX2 path can pose eight at a time; it
+// must produce the same bounds as the scalar path, and is selected at runtime from the CPU's
+// capabilities.
+namespace Skinning {
+
+    enum class Backend { Scalar, AVX2 };
+
+    const char* backendName(Backend backend);
+
+    // The fastest backend this CPU supports (detected once).
+    Backend bestBackend();
+
+    // An affine transform as the top three rows of a 4x4 matrix, row-major:
+    // out = m * (x, y, z, 1).
+    struct Affine {
+        float m[3][4];
+    };
+
+    // Read-only view of a vertex stream. Influence k of vertex i is bone boneIds[k][i] with
+    // weight weights[k][i]. Leave the bone arrays null for a rigid (unskinned) shape.
+    struct Streams {
+        size_t count = 0;
+        const float* x = nullptr;
+        const float* y = nullptr;
+        const float* z = nullptr;
+        const int32_t* boneIds[4] = {};
+        const float* weights[4] = {};
+    };
+
+    // Owns the arrays behind a Streams view.
+    struct StreamStorage {
+        std::vector<float> x, y, z;
+        std::vector<int32_t> boneIds[4];
+        std::vector<float> weights[4];
+
+        void resize(size_t count, bool skinned);
+        Streams view() const;
+    };
+
+    struct PosedBounds {
+        float min[3];
+        float max[3];
+        float centroid[3];
+    };
+
+    // Poses every vertex as sum_k(w_k * bones[id_k] * p) / sum_k(w_k), or leaves it in bind pose
+    // when its weights sum to zero, then applies 'toRoot'. Returns the bounds and centroid of the
+    // result. Every bone id must be below boneCount. An empty stream returns inverted bounds
+    // (min = FLT_MAX, max = -FLT_MAX) and a zero centroid.
+    PosedBounds posedBounds(const Streams& vertices, const Affine* bones, size_t boneCount, const Affine& toRoot);
+    PosedBounds posedBounds(const Streams& vertices, const Affine* bones, size_t boneCount, const Affine& toRoot, Backend backend);
+
+}
@@ -0,0 +1,195 @@
+#include "TextureDiskCache.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    constexpr uint32_t kMagic = 0x5845544E; // "NTEX"
+    constexpr uint32_t kFormatVersion = 1;
+    constexpr size_t kDataAlignment = 16;
+    constexpr uint32_t kMaxLevels = 16 * 6 * 256; // Levels x faces x layers; anything larger is corrupt.
+
+    enum Flags : uint32_t {
+        kCompressed = 1u << 0,
+        kGenerateMips = 1u << 1,
+    };
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t contentHash;
+        uint64_t contentSize;
+        uint64_t skippedBytes;
+        uint32_t lodCap;
+        uint32_t flags;
+        uint32_t target;
+        uint32_t internalFormat;
+        uint32_t externalFormat;
+        uint32_t type;
+        int32_t swizzles[4];
+        uint32_t dimensions;
+        int32_t width, height, depth;
+        int32_t storageLevels;
+        uint32_t levelCount;
+    };
+
+    struct FileLevel {
+        uint32_t target;
+        int32_t level;
+        int32_t width, height;
+        uint64_t size;
+        uint64_t offset; // From the start of the file.
+    };
+
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+bool TextureDiskCache::open(const std::filesystem::path& cacheDirectory) {
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDirectory, ec);
+    if (ec || !std::filesystem::is_directory(cacheDirectory, ec)) {
+        std::cerr << "Texture disk cache: could not create " << cacheDirectory.string() << " (" << ec.message() << ")." << std::endl;
+        directory.clear();
+        return false;
+    }
+    directory = cacheDirectory;
+    std::cout << "--- Texture disk cache: " << directory.string() << " ---" << std::endl;
+    return true;
+}
+
+std::filesystem::path TextureDiskCache::pathFor(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.npctex", static_cast<unsigned long long>(key));
+    return directory / name;
+}
+
+std::unique_ptr<MappedFile> TextureDiskCache::lookup(uint64_t key, TextureLayout& layout, Provenance& provenance) const {
+    if (!isOpen()) {
+        return nullptr;
+    }
+
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(pathFor(key)) || file->size() < sizeof(FileHeader)) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    const size_t tableEnd = sizeof(FileHeader) + static_cast<size_t>(header.levelCount) * sizeof(FileLevel);
+    if (header.magic != kMagic || header.version != kFormatVersion || header.key != key
+        || header.levelCount == 0 || header.levelCount > kMaxLevels || tableEnd > file->size()) {
+        // Written by another version, or a hash collision between keys; rebuilt on this load.
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    TextureLayout result;
+    result.target = header.target;
+    result.internalFormat = header.internalFormat;
+    result.externalFormat = header.externalFormat;
+    result.type = header.type;
+    std::memcpy(result.swizzles, header.swizzles, sizeof(result.swizzles));
+    result.dimensions = header.dimensions;
+    result.width = header.width;
+    result.height = header.height;
+    result.depth = header.depth;
+    result.storageLevels = header.storageLevels;
+    result.compressed = (header.flags & kCompressed) != 0;
+    result.generateMips = (header.flags & kGenerateMips) != 0;
+
+    result.levels.reserve(header.levelCount);
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        FileLevel stored;
+        std::memcpy(&stored, file->data() + sizeof(FileHeader) + i * sizeof(FileLevel), sizeof(stored));
+        if (stored.offset < tableEnd || stored.offset > file->size() || stored.size > file->size() - stored.offset) {
+            std::cerr << "Texture disk cache: " << pathFor(key).string() << " is truncated; ignoring it." << std::endl;
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        result.levels.push_back({ stored.target, stored.level, stored.width, stored.height,
+            static_cast<GLsizei>(stored.size), file->data() + stored.offset });
+    }
+
+    layout = std::move(result);
+    provenance.contentHash = header.contentHash;
+    provenance.contentSize = header.contentSize;
+    provenance.lodCap = header.lodCap;
+    provenance.skippedBytes = header.skippedBytes;
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return file;
+}
+
+void TextureDiskCache::store(uint64_t key, const TextureLayout& layout, const Provenance& provenance) const {
+    if (!isOpen() || layout.levels.empty()) {
+        return;
+    }
+
+    FileHeader header{};
+    header.magic = kMagic;
+    header.version = kFormatVersion;
+    header.key = key;
+    header.contentHash = provenance.contentHash;
+    header.contentSize = provenance.contentSize;
+    header.skippedBytes = provenance.skippedBytes;
+    header.lodCap = provenance.lodCap;
+    header.flags = (layout.compressed ? kCompressed : 0) | (layout.generateMips ? kGenerateMips : 0);
+    header.target = layout.target;
+    header.internalFormat = layout.internalFormat;
+    header.externalFormat = layout.externalFormat;
+    header.type = layout.type;
+    std::memcpy(header.swizzles, layout.swizzles, sizeof(header.swizzles));
+    header.dimensions = layout.dimensions;
+    header.width = layout.width;
+    header.height = layout.height;
+    header.depth = layout.depth;
+    header.storageLevels = layout.storageLevels;
+    header.levelCount = static_cast<uint32_t>(layout.levels.size());
+
+    std::vector<FileLevel> table(layout.levels.size());
+    size_t offset = alignUp(sizeof(FileHeader) + table.size() * sizeof(FileLevel), kDataAlignment);
+    for (size_t i = 0; i < table.size(); ++i) {
+        const TextureLayout::Level& level = layout.levels[i];
+        table[i] = { level.target, level.level, level.width, level.height, static_cast<uint64_t>(level.size), offset };
+        offset = alignUp(offset + static_cast<size_t>(level.size), kDataAlignment);
+    }
+
+    // Several workers or processes may build the same texture; each writes its own
+    // temporary file and the last rename wins with identical contents.
+    std::filesystem::path finalPath = pathFor(key);
+    std::filesystem::path tempPath = TemporarySiblingPath(finalPath);
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        static const char padding[kDataAlignment] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(FileLevel)));
+        size_t written = sizeof(header) + table.size() * sizeof(FileLevel);
+        for (size_t i = 0; i < table.size(); ++i) {
+            out.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+            out.write(static_cast<const char*>(layout.levels[i].data), static_cast<std::streamsize>(table[i].size));
+            written = table[i].offset + table[i].size;
+        }
+        if (!out) {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, finalPath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return;
+    }
+    writes.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+
+class MappedFile;
+
+// Everything needed to allocate a texture and fill it level by level, independent of the
+// file format it came from.
+struct TextureLayout {
+    // One glCompressedTexSubImage2D/glTexSubImage2D call.
+    struct Level {
+        GLenum target;      // The face target for cube maps, otherwise the texture target.
+        GLint level;
+        GLsizei width, height;
+        GLsizei size;
+        const void* data;   // Owned by whoever produced the layout.
+    };
+
+    GLenum target = GL_TEXTURE_2D;
+    GLenum internalFormat = 0;
+    GLenum externalFormat = 0;  // Unused for compressed formats.
+    GLenum type = 0;            // Unused for compressed formats.
+    GLint swizzles[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+    uint32_t dimensions = 2;    // Picks glTexStorage1D/2D/3D.
+    GLsizei width = 0, height = 0, depth = 1;
+    GLsizei storageLevels = 1;  // Levels to allocate; more than 'levels' has if the chain is generated.
+    bool compressed = false;
+    bool generateMips = false;
+    std::vector<Level> levels;
+};
+
+// An on-disk cache of textures in their ready-to-upload form (".npctex" files): a small
+// header, the level table and the level data exactly as glCompressedTexSubImage2D or
+// glTexSubImage2D takes it. Files are memory-mapped on lookup, so a warm load skips the
+// archive extraction and the DDS parse, and the upload reads straight from the page cache.
+//
+// Keys are chosen by the caller and must cover everything the blob was derived from (the
+// source file's fingerprint and any settings that changed the result). Files are written
+// under a temporary name and renamed into place, so concurrent processes can share a
+// directory. Nothing is ever evicted; delete the directory to reclaim the space.
+//
+// The cache is opt-in. Until open() succeeds, lookup() always misses and store() does nothing.
+class TextureDiskCache {
+public:
+    // What a blob was built from, stored alongside it.
+    struct Provenance {
+        uint64_t contentHash = 0;   // Of the source file, for deduplication.
+        uint64_t contentSize = 0;
+        uint32_t lodCap = 0;        // The size cap, if it dropped levels.
+        uint64_t skippedBytes = 0;  // Level data the cap dropped.
+    };
+
+    TextureDiskCache() = default;
+    TextureDiskCache(const TextureDiskCache&) = delete;
+    TextureDiskCache& operator=(const TextureDiskCache&) = delete;
+
+    bool open(const std::filesystem::path& directory);
+    bool isOpen() const { return !directory.empty(); }
+
+    // On a hit, fills 'layout' with levels pointing into the returned mapping, which must
+    // outlive any use of them.
+    std::unique_ptr<MappedFile> lookup(uint64_t key, TextureLayout& layout, Provenance& provenance) const;
+    void store(uint64_t key, const TextureLayout& layout, const Provenance& provenance) const;
+
+    // Per-process counters, for logging.
+    uint64_t hitCount() const { return hits.load(std::memory_order_relaxed); }
+    uint64_t missCount() const { return misses.load(std::memory_order_relaxed); }
+    uint64_t writeCount() const { return writes.load(std::memory_order_relaxed); }
+
+private:
+    std::filesystem::path pathFor(uint64_t key) const;
+
+    std::filesystem::path directory;
+    mutable std::atomic<uint64_t> hits{ 0 };
+    mutable std::atomic<uint64_t> misses{ 0 };
+    mutable std::atomic<uint64_t> writes{ 0 };
+};
@@ -6,8 +6,158 @@
 #include <fstream>
 #include <gli/gli.hpp>
 #include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <unordered_set>
+#include "ThreadPool.h"
+#include "BcnDecoder.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
 
-TextureManager::TextureManager(AssetManager& manager) : assetManager(manager) {}
+namespace {
+    // Extraction is mostly decompression inside libbsarch, so a handful of workers covers a
+    // full head (6-8 shapes x 8 slots) without starving the rest of the process.
+    constexpr size_t kMaxPrefetchThreads = 8;
+
+    // Array depth for the first array of a format; each further one doubles, up to the limit.
+    constexpr uint32_t kFirstArrayLayers = 1;
+    constexpr uint32_t kMaxArrayLayers = 16;
+
+    // Parameters shared by standalone textures and texture arrays. Expects the texture bound.
+    void applyTextureState(GLenum target, const TextureLayout& layout) {
+        glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, layout.storageLevels - 1);
+        glTexParameteri(target, GL_TEXTURE_SWIZZLE_R, layout.swizzles[0]);
+        glTexParameteri(target, GL_TEXTURE_SWIZZLE_G, layout.swizzles[1]);
+        glTexParameteri(target, GL_TEXTURE_SWIZZLE_B, layout.swizzles[2]);
+        glTexParameteri(target, GL_TEXTURE_SWIZZLE_A, layout.swizzles[3]);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        if (GLAD_GL_EXT_texture_filter_anisotropic) {
+            GLfloat maxAnisotropy;
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+            glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, maxAnisotropy);
+        }
+    }
+
+    // VRAM taken by each allocated mip level, every face and layer included. Levels generated
+    // on the GPU aren't in the file, so they are sized from the base level.
+    std::vector<size_t> mipLevelBytes(const TextureLayout& layout) {
+        std::vector<size_t> bytes(static_cast<size_t>(std::max<GLsizei>(layout.storageLevels, 1)), 0);
+        for (const auto& level : layout.levels) {
+            if (level.level >= 0 && static_cast<size_t>(level.level) < bytes.size()) {
+                bytes[level.level] += static_cast<size_t>(level.size);
+            }
+        }
+        if (layout.generateMips && bytes[0] > 0 && layout.width > 0 && layout.height > 0) {
+            const size_t basePixels = static_cast<size_t>(layout.width) * static_cast<size_t>(layout.height);
+            for (size_t level = 1; level < bytes.size(); ++level) {
+                if (bytes[level] != 0) continue;
+                size_t pixels = static_cast<size_t>(std::max<GLsizei>(layout.width >> level, 1))
+                    * static_cast<size_t>(std::max<GLsizei>(layout.height >> level, 1));
+                bytes[level] = bytes[0] * pixels / basePixels;
+            }
+        }
+        return bytes;
+    }
+
+    // Returns a copy of 'tex' without the mip levels larger than 'maxSize' on either axis, or an
+    // empty texture if nothing needs dropping (or the file has no smaller levels to fall back on).
+    gli::texture dropLargeLevels(const gli::texture& tex, uint32_t maxSize, size_t& skippedBytes) {
+        size_t firstKept = 0;
+        while (firstKept + 1 < tex.levels()) {
+            gli::extent3d extent = tex.extent(firstKept);
+            if (static_cast<uint32_t>(std::max(extent.x, extent.y)) <= maxSize) break;
+            ++firstKept;
+        }
+        if (firstKept == 0) {
+            return gli::texture();
+        }
+
+        gli::texture trimmed(tex.target(), tex.format(), tex.extent(firstKept), tex.layers(), tex.faces(),
+            tex.levels() - firstKept, tex.swizzles());
+        for (size_t layer = 0; layer < tex.layers(); ++layer) {
+            for (size_t face = 0; face < tex.faces(); ++face) {
+                for (size_t level = 0; level < trimmed.levels(); ++level) {
+                    std::memcpy(trimmed.data(layer, face, level), tex.data(layer, face, level + firstKept), trimmed.size(level));
+                }
+                for (size_t level = 0; level < firstKept; ++level) {
+                    skippedBytes += tex.size(level);
+                }
+            }
+        }
+        return trimmed;
+    }
+
+    // Maps a block-compressed gli format to the CPU decoder when the driver can't sample it.
+    bool needsCpuDecode(gli::format format, bool bptcSupported, bool s3tcSupported, Bcn::Format& bcnFormat, bool& srgb, bool& opaque) {
+        srgb = false;
+        opaque = false;
+        switch (format) {
+        case gli::FORMAT_RGBA_BP_SRGB_BLOCK16: srgb = true; // fallthrough
+        case gli::FORMAT_RGBA_BP_UNORM_BLOCK16: bcnFormat = Bcn::Format::BC7; return !bptcSupported;
+        case gli::FORMAT_RGB_DXT1_SRGB_BLOCK8: srgb = true; // fallthrough
+        case gli::FORMAT_RGB_DXT1_UNORM_BLOCK8: opaque = true; bcnFormat = Bcn::Format::BC1; return !s3tcSupported;
+        case gli::FORMAT_RGBA_DXT1_SRGB_BLOCK8: srgb = true; // fallthrough
+        case gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8: bcnFormat = Bcn::Format::BC1; return !s3tcSupported;
+        case gli::FORMAT_RGBA_DXT3_SRGB_BLOCK16: srgb = true; // fallthrough
+        case gli::FORMAT_RGBA_DXT3_UNORM_BLOCK16: bcnFormat = Bcn::Format::BC2; return !s3tcSupported;
+        case gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16: srgb = true; // fallthrough
+        case gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16: bcnFormat = Bcn::Format::BC3; return !s3tcSupported;
+        default: return false; // RGTC (BC4/BC5) is core since GL 3.0.
+        }
+    }
+
+    gli::texture decodeToRGBA8(const gli::texture& tex, Bcn::Format bcnFormat, bool srgb, bool opaque) {
+        gli::swizzles swizzles = tex.swizzles();
+        if (opaque) swizzles[3] = gli::SWIZZLE_ONE; // RGB DXT1 ignores its punch-through alpha.
+        gli::texture decoded(tex.target(), srgb ? gli::FORMAT_RGBA8_SRGB_PACK8 : gli::FORMAT_RGBA8_UNORM_PACK8,
+            tex.extent(), tex.layers(), tex.faces(), tex.levels(), swizzles);
+        for (size_t layer = 0; layer < tex.layers(); ++layer) {
+            for (size_t face = 0; face < tex.faces(); ++face) {
+                for (size_t level = 0; level < tex.levels(); ++level) {
+                    gli::extent3d extent = tex.extent(level);
+                    Bcn::decode(bcnFormat, tex.data(layer, face, level), static_cast<uint32_t>(extent.x), static_cast<uint32_t>(extent.y),
+                        static_cast<uint8_t*>(decoded.data(layer, face, level)));
+                }
+            }
+        }
+        return decoded;
+    }
+}
+
+struct TextureManager::PreparedTexture {
+    std::string relativePath;
+    std::string source;
+
+    // Everything the GL thread needs to allocate and fill the texture, so it never has to
+    // query gli. No levels when the file was not found or could not be parsed.
+    TextureLayout layout;
+    size_t dataBytes = 0;
+    uint64_t contentHash = 0;   // Of the file as extracted, before any trimming or decoding.
+    size_t contentSize = 0;
+    uint32_t lodCap = 0;        // The size cap, if it dropped any levels.
+    size_t skippedBytes = 0;    // Mip data dropped by the size cap.
+    const char* cpuDecodedFormat = nullptr; // Set when the driver lacked the format.
+    double cpuDecodeMs = 0.0;
+
+    // Owns the level data: the file parsed this run, or its blob mapped from the disk cache.
+    gli::texture texture;
+    std::unique_ptr<MappedFile> mapping;
+
+    bool loaded() const { return !layout.levels.empty(); }
+};
+
+TextureManager::TextureManager(AssetManager& manager)
+    : assetManager(manager),
+    prefetchPool(std::make_unique<ThreadPool>(std::min<size_t>(kMaxPrefetchThreads, std::max(1u, std::thread::hardware_concurrency())))) {
+}
 
 TextureManager::~TextureManager() {
     cleanup();
@@ -18,118 +168,770 @@ TextureInfo TextureManager::loadTexture(const std::string& relativePath) {
         return { 0, GL_TEXTURE_2D };
     }
 
-    auto it = textureCache.find(relativePath);
-    if (it != textureCache.end()) {
-        return it->second;
+    PathKey key(relativePath);
+    auto it = textureCache.find(key);
+    if (it == textureCache.end()) {
+        TextureInfo prefetched;
+        if (!takePrefetched(key, prefetched)) {
+            uint64_t fingerprint = 0;
+            std::unique_ptr<PreparedTexture> prepared = loadCached(relativePath, fingerprint);
+            if (!prepared) {
+                std::string source;
+                std::vector<char> fileData = assetManager.extractFile(relativePath, &source);
+                prepared = prepareTexture(relativePath, std::move(source), std::move(fileData), fingerprint);
+            }
+            finishLoad(key, std::move(prepared));
+        }
+        it = textureCache.find(key);
+    }
+
+    TextureInfo result = retain(it->second);
+    enforceBudget();
+    return result;
+}
+
+std::vector<TextureInfo> TextureManager::loadTextureSet(const std::vector<std::string>& relativePaths) {
+    std::vector<TextureInfo> results(relativePaths.size());
+    std::vector<PathKey> keys;
+    keys.reserve(relativePaths.size());
+    for (const auto& path : relativePaths) {
+        keys.emplace_back(path);
     }
 
-    std::vector<char> fileData = assetManager.extractFile(relativePath);
+    // Collect the slots that still need their file data, skipping duplicates within the set
+    // and anything a prefetch is already working on. Slots in the disk cache load right away.
+    std::vector<size_t> toExtract;
+    std::vector<std::string> extractPaths;
+    std::vector<uint64_t> fingerprints;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i].empty() || textureCache.count(keys[i]) > 0 || pendingTextures.count(keys[i]) > 0) continue;
+        bool duplicate = std::any_of(toExtract.begin(), toExtract.end(), [&](size_t j) { return keys[j] == keys[i]; });
+        if (duplicate) continue;
 
-    if (!fileData.empty()) {
-        TextureInfo texInfo = uploadDDSToGPU(fileData); // <-- Get the full struct
-        if (texInfo.id != 0) {
-            textureCache[relativePath] = texInfo;
-            return texInfo;
+        uint64_t fingerprint = 0;
+        if (auto cached = loadCached(relativePaths[i], fingerprint)) {
+            finishLoad(keys[i], std::move(cached));
+            continue;
         }
+        toExtract.push_back(i);
+        extractPaths.push_back(relativePaths[i]);
+        fingerprints.push_back(fingerprint);
+    }
+
+    std::vector<std::string> sources;
+    std::vector<std::vector<char>> fileData = assetManager.extractFiles(extractPaths, &sources);
+
+    // Parse the batch on the workers; this thread only allocates the textures and queues the uploads.
+    std::vector<std::future<std::unique_ptr<PreparedTexture>>> parsed;
+    parsed.reserve(toExtract.size());
+    for (size_t i = 0; i < toExtract.size(); ++i) {
+        parsed.push_back(prefetchPool->submit([this, path = extractPaths[i], source = std::move(sources[i]), data = std::move(fileData[i]), fingerprint = fingerprints[i]]() mutable {
+            return prepareTexture(path, std::move(source), std::move(data), fingerprint);
+        }));
+    }
+    for (size_t i = 0; i < toExtract.size(); ++i) {
+        finishLoad(keys[toExtract[i]], parsed[i].get());
+    }
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i].empty()) continue;
+        TextureInfo prefetched;
+        takePrefetched(keys[i], prefetched);
+        results[i] = retain(textureCache[keys[i]]); // Every non-empty path is now cached.
     }
 
-    std::cerr << "Warning: Texture not found or failed to load: " << relativePath << std::endl;
-    textureCache[relativePath] = { 0, GL_TEXTURE_2D };
-    return { 0, GL_TEXTURE_2D };
+    // Only evict once the whole set holds its references, so it cannot evict its own slots.
+    enforceBudget();
+    return results;
 }
 
+void TextureManager::releaseTextures(const std::vector<TextureInfo>& textures) {
+    for (const TextureInfo& info : textures) {
+        if (info.id == 0) continue;
 
-TextureInfo TextureManager::uploadDDSToGPU(const std::vector<char>& data) {
-    // START PROFILING ASSET GET/UPLOAD
-    auto start_get = std::chrono::high_resolution_clock::now();
+        auto gpu = gpuTextures.find(slotOf(info));
+        if (gpu == gpuTextures.end() || gpu->second.refCount == 0) continue;
+        --gpu->second.refCount;
+        destroyIfUnused(gpu);
+    }
+    enforceBudget();
+}
 
-    gli::texture tex = gli::load(data.data(), data.size());
-    if (tex.empty()) {
-        return { 0, GL_TEXTURE_2D };
+void TextureManager::detectFormatSupport() {
+    bptcSupported = GLAD_GL_ARB_texture_compression_bptc != 0;
+    s3tcSupported = GLAD_GL_EXT_texture_compression_s3tc != 0;
+    if (!bptcSupported || !s3tcSupported) {
+        std::cout << "[Texture] Driver lacks " << (!bptcSupported ? "BPTC (BC7) " : "") << (!s3tcSupported ? "S3TC (BC1-BC3) " : "")
+            << "support; those textures will be decoded on the CPU (" << Bcn::backendName(Bcn::bestBackend()) << ")" << std::endl;
     }
+}
 
-    gli::gl gl(gli::gl::PROFILE_GL33);
-    gli::gl::format const format = gl.translate(tex.format(), tex.swizzles());
-    GLenum target = gl.translate(tex.target());
+void TextureManager::setMaxTextureSize(uint32_t maxSize) {
+    uint32_t previous = maxTextureSize.exchange(maxSize);
+    bool raised = maxSize == 0 ? previous != 0 : (previous != 0 && maxSize > previous);
+    if (!raised) {
+        return;
+    }
 
-    GLuint textureID = 0;
-    glGenTextures(1, &textureID);
-    glBindTexture(target, textureID);
-    glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
-    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(tex.levels() - 1));
-    glTexParameteri(target, GL_TEXTURE_SWIZZLE_R, format.Swizzles[0]);
-    glTexParameteri(target, GL_TEXTURE_SWIZZLE_G, format.Swizzles[1]);
-    glTexParameteri(target, GL_TEXTURE_SWIZZLE_B, format.Swizzles[2]);
-    glTexParameteri(target, GL_TEXTURE_SWIZZLE_A, format.Swizzles[3]);
+    // Textures cut down for the old cap would now be too small, so load them again.
+    discardPending();
+    for (auto it = textureCache.begin(); it != textureCache.end();) {
+        auto next = std::next(it);
+        if (it->second.truncated) {
+            evict(it);
+        }
+        it = next;
+    }
+}
 
-    glm::tvec3<GLsizei> const extent(tex.extent());
-    GLsizei const faceTotal = static_cast<GLsizei>(tex.layers() * tex.faces());
+void TextureManager::setBudgetBytes(size_t bytes) {
+    budgetBytes = bytes;
+    enforceBudget();
+}
+
+TextureInfo TextureManager::retain(CacheEntry& entry) {
+    if (entry.info.id != 0) {
+        GpuTexture& gpu = gpuTextures.at(slotOf(entry.info));
+        gpu.lastUsed = ++useTick;
+        ++gpu.refCount;
+    }
+    return entry.info;
+}
+
+void TextureManager::evict(std::unordered_map<PathKey, CacheEntry>::iterator it) {
+    if (it->second.info.id != 0) {
+        auto gpu = gpuTextures.find(slotOf(it->second.info));
+        std::vector<PathKey>& keys = gpu->second.keys;
+        keys.erase(std::remove(keys.begin(), keys.end(), it->first), keys.end());
+        // A texture still drawn by a loaded model outlives its paths until the model lets go.
+        destroyIfUnused(gpu);
+    }
+    textureCache.erase(it);
+}
+
+void TextureManager::destroyIfUnused(std::unordered_map<uint64_t, GpuTexture>::iterator it) {
+    GpuTexture& gpu = it->second;
+    if (gpu.refCount > 0 || !gpu.keys.empty()) return;
+
+    auto indexed = contentIndex.find(gpu.content);
+    if (indexed != contentIndex.end() && indexed->second == it->first) {
+        contentIndex.erase(indexed);
+    }
+    dropQueuedUpload(gpu.info);
+    releaseStorage(gpu.info);
+    residentBytes -= gpu.bytes;
+    gpuTextures.erase(it);
+}
+
+void TextureManager::releaseStorage(const TextureInfo& info) {
+    if (info.target != GL_TEXTURE_2D_ARRAY) {
+        glDeleteTextures(1, &info.id);
+        return;
+    }
+    auto page = arrayPages.find(info.id);
+    if (page == arrayPages.end()) return;
+    page->second.usedLayers[info.layer] = false;
+    if (--page->second.layersInUse == 0) {
+        // The caller takes this layer's bytes off residentBytes; the spare layers go here.
+        residentBytes -= (page->second.usedLayers.size() - 1) * page->second.layerBytes;
+        glDeleteTextures(1, &info.id);
+        arrayPages.erase(page);
+    }
+    else {
+        // The layer stays allocated as a spare, so its memory is still resident.
+        residentBytes += page->second.layerBytes;
+    }
+}
+
+TextureManager::ArrayPoolStats TextureManager::getArrayPoolStats() const {
+    ArrayPoolStats stats;
+    stats.arrays = arrayPages.size();
+    for (const auto& [id, page] : arrayPages) {
+        stats.layersUsed += page.layersInUse;
+        stats.layersAllocated += page.usedLayers.size();
+        stats.unusedBytes += (page.usedLayers.size() - page.layersInUse) * page.layerBytes;
+    }
+    return stats;
+}
+
+std::vector<TextureManager::TextureMemoryUsage> TextureManager::getTextureMemoryUsage() const {
+    std::vector<TextureMemoryUsage> usage;
+    usage.reserve(gpuTextures.size());
+    for (const auto& [slot, gpu] : gpuTextures) {
+        TextureMemoryUsage texture;
+        texture.path = gpu.path;
+        texture.target = gpu.info.target;
+        texture.internalFormat = gpu.internalFormat;
+        texture.width = gpu.width;
+        texture.height = gpu.height;
+        texture.mipBytes = gpu.mipBytes;
+        texture.bytes = gpu.bytes;
+        texture.paths = gpu.keys.size();
+        texture.refCount = gpu.refCount;
+        usage.push_back(std::move(texture));
+    }
+    std::sort(usage.begin(), usage.end(), [](const TextureMemoryUsage& a, const TextureMemoryUsage& b) {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.path < b.path;
+    });
+    return usage;
+}
+
+std::string TextureManager::formatName(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return "BC1 RGB";
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: return "BC1";
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: return "BC2";
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return "BC3";
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: return "BC1 RGB sRGB";
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: return "BC1 sRGB";
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: return "BC2 sRGB";
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: return "BC3 sRGB";
+    case GL_COMPRESSED_RED_RGTC1: return "BC4";
+    case GL_COMPRESSED_SIGNED_RED_RGTC1: return "BC4 SNORM";
+    case GL_COMPRESSED_RG_RGTC2: return "BC5";
+    case GL_COMPRESSED_SIGNED_RG_RGTC2: return "BC5 SNORM";
+    case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB: return "BC7";
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB: return "BC7 sRGB";
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB: return "BC6H UF16";
+    case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT_ARB: return "BC6H SF16";
+    case GL_RGBA8: return "RGBA8";
+    case GL_SRGB8_ALPHA8: return "RGBA8 sRGB";
+    case GL_RGB8: return "RGB8";
+    case GL_SRGB8: return "RGB8 sRGB";
+    case GL_RG8: return "RG8";
+    case GL_R8: return "R8";
+    case GL_RGBA16F: return "RGBA16F";
+    case GL_RGBA32F: return "RGBA32F";
+    default: break;
+    }
+    char hex[16];
+    std::snprintf(hex, sizeof(hex), "0x%04X", static_cast<unsigned>(internalFormat));
+    return hex;
+}
+
+void TextureManager::enforceBudget() {
+    if (residentBytes <= budgetBytes) return;
+
+    const size_t texturesBefore = gpuTextures.size();
+    const size_t residentBefore = residentBytes;
+    while (residentBytes > budgetBytes) {
+        // Dropping some layers of a texture array frees nothing (they stay allocated as spares),
+        // so an array is only a candidate once none of its layers are in use, and then goes as a
+        // whole, ranked by its most recently used layer.
+        std::unordered_map<GLuint, uint64_t> idleArrays;
+        std::unordered_set<GLuint> busyArrays;
+        auto victim = gpuTextures.end();
+        uint64_t victimLastUsed = std::numeric_limits<uint64_t>::max();
+        for (auto it = gpuTextures.begin(); it != gpuTextures.end(); ++it) {
+            const GpuTexture& gpu = it->second;
+            if (gpu.info.target == GL_TEXTURE_2D_ARRAY) {
+                if (gpu.refCount > 0) {
+                    busyArrays.insert(gpu.info.id);
+                }
+                else {
+                    uint64_t& lastUsed = idleArrays[gpu.info.id];
+                    lastUsed = std::max(lastUsed, gpu.lastUsed);
+                }
+                continue;
+            }
+            if (gpu.refCount == 0 && gpu.lastUsed < victimLastUsed) {
+                victim = it;
+                victimLastUsed = gpu.lastUsed;
+            }
+        }
+        GLuint victimArray = 0;
+        for (const auto& [id, lastUsed] : idleArrays) {
+            if (lastUsed < victimLastUsed && !busyArrays.count(id)) {
+                victimArray = id;
+                victimLastUsed = lastUsed;
+            }
+        }
+        if (victim == gpuTextures.end() && victimArray == 0) break; // Everything left is in use.
+
+        // Dropping the last path sharing a texture deletes it (and invalidates 'victim').
+        std::vector<PathKey> keys;
+        if (victimArray != 0) {
+            for (const auto& [slot, gpu] : gpuTextures) {
+                if (gpu.info.id == victimArray) keys.insert(keys.end(), gpu.keys.begin(), gpu.keys.end());
+            }
+        }
+        else {
+            keys = victim->second.keys;
+        }
+        const size_t residentBeforeVictim = residentBytes;
+        for (const PathKey& key : keys) {
+            evict(textureCache.find(key));
+        }
+        if (residentBytes >= residentBeforeVictim) break; // Nothing freed; don't spin.
+    }
+
+    const size_t evicted = texturesBefore - gpuTextures.size();
+    if (evicted > 0) {
+        std::cout << "    [Texture Cache] Evicted " << evicted << " texture(s) (" << ((residentBefore - residentBytes) >> 20) << " MB); "
+            << (residentBytes >> 20) << " of " << (budgetBytes >> 20) << " MB resident\n";
+    }
+}
 
+void TextureManager::revalidate() {
+    // Prefetches may have resolved against the old directories.
+    discardPending();
+
+    size_t dropped = 0;
+    for (auto it = textureCache.begin(); it != textureCache.end();) {
+        if (assetManager.resolveSource(it->second.relativePath) == it->second.source) {
+            ++it;
+            continue;
+        }
+        auto next = std::next(it);
+        evict(it);
+        it = next;
+        ++dropped;
+    }
+
+    if (dropped > 0) {
+        std::cout << "[Texture Cache] Data folders changed; invalidated " << dropped << " of "
+            << (textureCache.size() + dropped) << " cached texture(s)\n";
+        if (!pinnedPaths.empty()) {
+            pinTextures(std::vector<std::string>(pinnedPaths)); // Pin whatever the paths resolve to now.
+        }
+    }
+}
+
+void TextureManager::pinTextures(const std::vector<std::string>& relativePaths) {
+    // Load the new set before releasing the old one, so textures in both are never dropped.
+    std::vector<TextureInfo> previous = std::move(pinnedTextures);
+    pinnedTextures.clear();
+    pinnedPaths = relativePaths;
+    for (const TextureInfo& info : loadTextureSet(relativePaths)) {
+        if (info.id != 0) {
+            pinnedTextures.push_back(info);
+        }
+    }
+    releaseTextures(previous);
+}
+
+void TextureManager::prefetchTextures(const std::vector<std::string>& relativePaths) {
+    size_t issued = 0;
+    for (const auto& path : relativePaths) {
+        if (path.empty()) continue;
+        PathKey key(path);
+        if (textureCache.count(key) > 0 || pendingTextures.count(key) > 0) continue;
+
+        pendingTextures.emplace(std::move(key), prefetchPool->submit([this, path]() {
+            uint64_t fingerprint = 0;
+            if (auto cached = loadCached(path, fingerprint)) {
+                return cached;
+            }
+            std::string source;
+            std::vector<char> fileData = assetManager.extractFile(path, &source);
+            return prepareTexture(path, std::move(source), std::move(fileData), fingerprint);
+        }));
+        ++issued;
+    }
+    if (issued > 0) {
+        std::cout << "    [Texture Prefetch] Issued " << issued << " texture(s) to " << prefetchPool->size() << " worker(s)\n";
+    }
+}
+
+bool TextureManager::takePrefetched(const PathKey& key, TextureInfo& result) {
+    auto pending = pendingTextures.find(key);
+    if (pending == pendingTextures.end()) {
+        return false;
+    }
+    std::unique_ptr<PreparedTexture> prepared = pending->second.get();
+    pendingTextures.erase(pending);
+    result = finishLoad(key, std::move(prepared));
+    return true;
+}
+
+uint64_t TextureManager::diskCacheKey(uint64_t sourceFingerprint, uint32_t maxSize) const {
+    // The blob also depends on the size cap and on which formats had to be decoded on the CPU.
+    uint64_t settings = (static_cast<uint64_t>(maxSize) << 2)
+        | (bptcSupported.load(std::memory_order_relaxed) ? 2u : 0u)
+        | (s3tcSupported.load(std::memory_order_relaxed) ? 1u : 0u);
+    return contentHash64(&settings, sizeof(settings), sourceFingerprint);
+}
+
+// Runs on either the GL thread or a prefetch worker, like prepareTexture().
+std::unique_ptr<TextureManager::PreparedTexture> TextureManager::loadCached(const std::string& relativePath, uint64_t& sourceFingerprint) const {
+    sourceFingerprint = 0;
+    if (!diskCache.isOpen()) {
+        return nullptr;
+    }
+
+    auto prepared = std::make_unique<PreparedTexture>();
+    sourceFingerprint = assetManager.sourceFingerprint(relativePath, &prepared->source);
+    if (sourceFingerprint == 0) {
+        return nullptr; // Missing files go through the normal path so they get reported.
+    }
+    TextureDiskCache::Provenance provenance;
+    prepared->mapping = diskCache.lookup(diskCacheKey(sourceFingerprint, maxTextureSize.load(std::memory_order_relaxed)),
+        prepared->layout, provenance);
+    if (!prepared->mapping) {
+        return nullptr;
+    }
+
+    prepared->relativePath = relativePath;
+    prepared->contentHash = provenance.contentHash;
+    prepared->contentSize = static_cast<size_t>(provenance.contentSize);
+    prepared->lodCap = provenance.lodCap;
+    prepared->skippedBytes = static_cast<size_t>(provenance.skippedBytes);
+    for (const auto& level : prepared->layout.levels) {
+        prepared->dataBytes += static_cast<size_t>(level.size);
+    }
+    return prepared;
+}
+
+// Runs on either the GL thread or a prefetch worker; it must not touch GL or the caches.
+std::unique_ptr<TextureManager::PreparedTexture> TextureManager::prepareTexture(const std::string& relativePath, std::string source,
+    std::vector<char>&& fileData, uint64_t sourceFingerprint) const {
+    auto prepared = std::make_unique<PreparedTexture>();
+    prepared->relativePath = relativePath;
+    prepared->source = std::move(source);
+    if (fileData.empty()) {
+        return prepared;
+    }
+    prepared->contentHash = contentHash64(fileData.data(), fileData.size());
+    prepared->contentSize = fileData.size();
+    gli::texture tex = gli::load(fileData.data(), fileData.size()); // gli copies the data.
+    assetManager.recycleBuffer(std::move(fileData));
+    if (tex.empty()) {
+        return prepared;
+    }
+
+    uint32_t maxSize = maxTextureSize.load(std::memory_order_relaxed);
+    if (maxSize > 0) {
+        gli::texture trimmed = dropLargeLevels(tex, maxSize, prepared->skippedBytes);
+        if (!trimmed.empty()) {
+            prepared->lodCap = maxSize;
+            tex = std::move(trimmed); // Frees the large levels before the texture waits in the upload queue.
+        }
+    }
+
+    Bcn::Format bcnFormat;
+    bool srgb = false, opaque = false;
+    if (needsCpuDecode(tex.format(), bptcSupported.load(std::memory_order_relaxed), s3tcSupported.load(std::memory_order_relaxed), bcnFormat, srgb, opaque)) {
+        auto decodeStart = std::chrono::high_resolution_clock::now();
+        tex = decodeToRGBA8(tex, bcnFormat, srgb, opaque);
+        prepared->cpuDecodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+        prepared->cpuDecodedFormat = Bcn::formatName(bcnFormat);
+    }
+
+    TextureLayout& layout = prepared->layout;
     switch (tex.target()) {
     case gli::TARGET_1D:
-        glTexStorage1D(target, static_cast<GLint>(tex.levels()), format.Internal, extent.x);
+        layout.dimensions = 1;
         break;
     case gli::TARGET_1D_ARRAY:
     case gli::TARGET_2D:
     case gli::TARGET_CUBE:
-        glTexStorage2D(target, static_cast<GLint>(tex.levels()), format.Internal, extent.x, extent.y);
+        layout.dimensions = 2;
         break;
     case gli::TARGET_2D_ARRAY:
     case gli::TARGET_3D:
     case gli::TARGET_CUBE_ARRAY:
-        glTexStorage3D(target, static_cast<GLint>(tex.levels()), format.Internal, extent.x, extent.y, extent.z);
+        layout.dimensions = 3;
         break;
     default:
-        return {};
+        return prepared; // Nothing glTexStorage can allocate; reported as a failed load.
+    }
+
+    gli::gl gl(gli::gl::PROFILE_GL33);
+    gli::gl::format format = gl.translate(tex.format(), tex.swizzles());
+    layout.target = gl.translate(tex.target());
+    layout.internalFormat = format.Internal;
+    layout.externalFormat = format.External;
+    layout.type = format.Type;
+    for (int i = 0; i < 4; ++i) {
+        layout.swizzles[i] = format.Swizzles[i];
+    }
+    layout.compressed = gli::is_compressed(tex.format());
+    glm::tvec3<GLsizei> const extent(tex.extent());
+    layout.width = extent.x;
+    layout.height = extent.y;
+    layout.depth = extent.z;
+
+    // Only generate a chain the file doesn't provide. Compressed formats can't be rendered to,
+    // so a single-level compressed texture stays single-level.
+    layout.storageLevels = static_cast<GLsizei>(tex.levels());
+    if (tex.levels() == 1 && !layout.compressed && tex.target() != gli::TARGET_3D) {
+        GLsizei largest = std::max(extent.x, extent.y);
+        GLsizei levels = 1;
+        while ((largest >> levels) > 0) ++levels;
+        layout.storageLevels = levels;
+        layout.generateMips = levels > 1;
     }
 
+    layout.levels.reserve(tex.layers() * tex.faces() * tex.levels());
     for (std::size_t layer = 0; layer < tex.layers(); ++layer) {
         for (std::size_t face = 0; face < tex.faces(); ++face) {
             for (std::size_t level = 0; level < tex.levels(); ++level) {
-                glm::tvec3<GLsizei> extent(tex.extent(level));
-                GLenum currentTarget = gli::is_target_cube(tex.target())
+                glm::tvec3<GLsizei> levelExtent(tex.extent(level));
+                TextureLayout::Level upload;
+                upload.target = gli::is_target_cube(tex.target())
                     ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face)
-                    : target;
+                    : layout.target;
+                upload.level = static_cast<GLint>(level);
+                upload.width = levelExtent.x;
+                upload.height = levelExtent.y;
+                upload.size = static_cast<GLsizei>(tex.size(level));
+                upload.data = tex.data(layer, face, level);
+                layout.levels.push_back(upload);
+            }
+        }
+    }
+    prepared->dataBytes = tex.size();
+    prepared->texture = std::move(tex); // Shares the storage, so the level pointers stay valid.
 
-                if (gli::is_compressed(tex.format())) {
-                    glCompressedTexSubImage2D(currentTarget, static_cast<GLint>(level), 0, 0, extent.x, extent.y,
-                        format.Internal, static_cast<GLsizei>(tex.size(level)), tex.data(layer, face, level));
-                }
-                else {
-                    glTexSubImage2D(currentTarget, static_cast<GLint>(level), 0, 0, extent.x, extent.y,
-                        format.External, format.Type, tex.data(layer, face, level));
-                }
+    if (sourceFingerprint != 0) {
+        TextureDiskCache::Provenance provenance;
+        provenance.contentHash = prepared->contentHash;
+        provenance.contentSize = prepared->contentSize;
+        provenance.lodCap = prepared->lodCap;
+        provenance.skippedBytes = prepared->skippedBytes;
+        diskCache.store(diskCacheKey(sourceFingerprint, maxSize), layout, provenance);
+    }
+    return prepared;
+}
+
+TextureInfo TextureManager::finishLoad(const PathKey& key, std::unique_ptr<PreparedTexture> prepared) {
+    CacheEntry entry;
+    entry.relativePath = prepared->relativePath;
+    entry.source = prepared->source;
+    entry.truncated = prepared->skippedBytes > 0;
+
+    ContentKey content{ prepared->contentHash, prepared->contentSize, prepared->lodCap };
+    auto shared = prepared->loaded() ? contentIndex.find(content) : contentIndex.end();
+    if (shared != contentIndex.end()) {
+        // Another path already holds (or is uploading) identical data; point this one at it.
+        GpuTexture& gpu = gpuTextures.at(shared->second);
+        gpu.keys.push_back(key);
+        gpu.lastUsed = ++useTick;
+        entry.info = gpu.info;
+        ++dedupHits;
+        dedupSavedBytes += gpu.bytes;
+        // The cap dropped those levels from this path's file too, dedup or not.
+        lodSkippedBytes += prepared->skippedBytes;
+    }
+    else {
+        std::vector<size_t> mipBytes;
+        size_t bytes = 0;
+        if (prepared->loaded()) {
+            mipBytes = mipLevelBytes(prepared->layout);
+            for (size_t levelBytes : mipBytes) bytes += levelBytes;
+            entry.info = createTexture(prepared->layout, bytes);
+        }
+        if (entry.info.id != 0) {
+            GpuTexture gpu;
+            gpu.info = entry.info;
+            gpu.bytes = bytes;
+            gpu.mipBytes = std::move(mipBytes);
+            gpu.path = prepared->relativePath;
+            gpu.internalFormat = prepared->layout.internalFormat;
+            gpu.width = prepared->layout.width;
+            gpu.height = prepared->layout.height;
+            gpu.lastUsed = ++useTick;
+            gpu.content = content;
+            gpu.keys.push_back(key);
+            lodSkippedBytes += prepared->skippedBytes;
+            if (prepared->cpuDecodedFormat) {
+                double megabytes = static_cast<double>(gpu.bytes) / (1024.0 * 1024.0);
+                std::cout << "    [Profile] CPU-decoded " << prepared->cpuDecodedFormat << " (" << Bcn::backendName(Bcn::bestBackend()) << "): "
+                    << prepared->relativePath << " at " << static_cast<long long>(megabytes * 1000.0 / std::max(prepared->cpuDecodeMs, 0.001)) << " MB/s\n";
             }
+            residentBytes += gpu.bytes;
+            contentIndex[content] = slotOf(entry.info);
+            gpuTextures.emplace(slotOf(entry.info), std::move(gpu));
+            uploadQueue.push_back({ entry.info, std::move(prepared), 0 });
+        }
+        else {
+            // Failed loads are cached too, so a missing file is not searched for again until
+            // revalidate() sees it appear.
+            std::cerr << "Warning: Texture not found or failed to load: " << prepared->relativePath << std::endl;
+            entry.info = { 0, GL_TEXTURE_2D };
+            entry.truncated = false;
         }
     }
 
-    if (tex.levels() > 1) {
-        glGenerateMipmap(target);
+    TextureInfo result = entry.info;
+    textureCache[key] = std::move(entry);
+    return result;
+}
+
+
+bool TextureManager::ArrayPage::fits(const TextureLayout& layout) const {
+    return internalFormat == layout.internalFormat && width == layout.width && height == layout.height
+        && storageLevels == layout.storageLevels && generateMips == layout.generateMips
+        && std::equal(std::begin(swizzles), std::end(swizzles), std::begin(layout.swizzles));
+}
+
+// Allocates the texture and sets its sampling state. The image data is uploaded later by
+// processUploadQueue(), so the id is valid (and the target known) as soon as this returns.
+TextureInfo TextureManager::createTexture(const TextureLayout& layout, size_t dataBytes) {
+    if (layout.target == GL_TEXTURE_2D && layout.dimensions == 2) {
+        return allocateArrayLayer(layout, dataBytes);
+    }
+
+    GLenum target = layout.target;
+    GLuint textureID = 0;
+    glGenTextures(1, &textureID);
+    glBindTexture(target, textureID);
+
+    switch (layout.dimensions) {
+    case 1:
+        glTexStorage1D(target, layout.storageLevels, layout.internalFormat, layout.width);
+        break;
+    case 2:
+        glTexStorage2D(target, layout.storageLevels, layout.internalFormat, layout.width, layout.height);
+        break;
+    case 3:
+        glTexStorage3D(target, layout.storageLevels, layout.internalFormat, layout.width, layout.height, layout.depth);
+        break;
+    default:
+        glDeleteTextures(1, &textureID);
+        return {};
+    }
+    applyTextureState(target, layout);
+    return { textureID, target, 0 };
+}
+
+TextureInfo TextureManager::allocateArrayLayer(const TextureLayout& layout, size_t dataBytes) {
+    uint32_t existing = 0;
+    for (auto& [id, page] : arrayPages) {
+        if (!page.fits(layout)) continue;
+        ++existing;
+        if (page.layersInUse == page.usedLayers.size()) continue;
+
+        GLint layer = static_cast<GLint>(std::find(page.usedLayers.begin(), page.usedLayers.end(), false) - page.usedLayers.begin());
+        page.usedLayers[layer] = true;
+        ++page.layersInUse;
+        // The spare was already counted; the caller counts it again as the new texture's bytes.
+        residentBytes -= page.layerBytes;
+        return { id, GL_TEXTURE_2D_ARRAY, layer };
+    }
+
+    // Every array of this format is full; start a deeper one.
+    uint32_t depth = kFirstArrayLayers;
+    while (existing-- > 0 && depth < kMaxArrayLayers) depth <<= 1;
+
+    GLuint textureID = 0;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, layout.storageLevels, layout.internalFormat, layout.width, layout.height, static_cast<GLsizei>(depth));
+    applyTextureState(GL_TEXTURE_2D_ARRAY, layout);
+
+    ArrayPage page;
+    page.internalFormat = layout.internalFormat;
+    page.width = layout.width;
+    page.height = layout.height;
+    page.storageLevels = layout.storageLevels;
+    std::copy(std::begin(layout.swizzles), std::end(layout.swizzles), std::begin(page.swizzles));
+    page.generateMips = layout.generateMips;
+    page.layerBytes = dataBytes;
+    page.usedLayers.assign(depth, false);
+    page.usedLayers[0] = true;
+    page.layersInUse = 1;
+    // Every layer is allocated up front, so the spares count against the budget too.
+    residentBytes += (depth - 1) * dataBytes;
+    arrayPages.emplace(textureID, std::move(page));
+    return { textureID, GL_TEXTURE_2D_ARRAY, 0 };
+}
+
+size_t TextureManager::processUploadQueue(double budgetMs) {
+    if (uploadQueue.empty()) {
+        return 0;
     }
 
-    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    auto start = std::chrono::high_resolution_clock::now();
+    auto elapsedMs = [&start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+
+    size_t mipsUploaded = 0;
+    size_t texturesCompleted = 0;
+    bool outOfTime = false;
+    while (!uploadQueue.empty() && !outOfTime) {
+        PendingUpload& upload = uploadQueue.front();
+        const TextureLayout& layout = upload.prepared->layout;
+        const bool arrayLayer = upload.info.target == GL_TEXTURE_2D_ARRAY;
+        glBindTexture(upload.info.target, upload.info.id);
+
+        while (upload.nextMip < layout.levels.size() && !outOfTime) {
+            const auto& mip = layout.levels[upload.nextMip++];
+            const void* pixels = uploadRing.stage(mip.data, static_cast<size_t>(mip.size));
+            if (arrayLayer && layout.compressed) {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip.level, 0, 0, upload.info.layer, mip.width, mip.height, 1,
+                    layout.internalFormat, mip.size, pixels);
+            }
+            else if (arrayLayer) {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip.level, 0, 0, upload.info.layer, mip.width, mip.height, 1,
+                    layout.externalFormat, layout.type, pixels);
+            }
+            else if (layout.compressed) {
+                glCompressedTexSubImage2D(mip.target, mip.level, 0, 0, mip.width, mip.height,
+                    layout.internalFormat, mip.size, pixels);
+            }
+            else {
+                glTexSubImage2D(mip.target, mip.level, 0, 0, mip.width, mip.height,
+                    layout.externalFormat, layout.type, pixels);
+            }
+            uploadRing.finishUpload();
+            ++mipsUploaded;
+            outOfTime = elapsedMs() >= budgetMs;
+        }
 
-    if (GLAD_GL_EXT_texture_filter_anisotropic) {
-        GLfloat maxAnisotropy;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
-        glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, maxAnisotropy);
+        if (upload.nextMip == layout.levels.size()) {
+            if (layout.generateMips) {
+                glGenerateMipmap(upload.info.target); // For an array this rebuilds every layer's chain.
+            }
+            uploadQueue.pop_front();
+            ++texturesCompleted;
+        }
     }
 
-    auto end_get = std::chrono::high_resolution_clock::now();
-    auto duration_get = std::chrono::duration_cast<std::chrono::milliseconds>(end_get - start_get);
-    std::cout << "    [Profile] Asset Get/Upload took: " << duration_get.count() << " ms\n";
+    const TextureUploadRing::Stats& ringStats = uploadRing.getStats();
+    std::cout << "    [Profile] Texture uploads: " << mipsUploaded << " mip level(s), " << texturesCompleted
+        << " texture(s) completed in " << static_cast<long long>(elapsedMs()) << " ms; " << uploadQueue.size() << " still queued"
+        << " (total " << (ringStats.stagedBytes >> 20) << " MB staged, " << (ringStats.directBytes >> 20) << " MB direct, "
+        << static_cast<long long>(ringStats.stallMs) << " ms stalled)\n";
+    return uploadQueue.size();
+}
 
-    return { textureID, target };
+void TextureManager::flushUploads() {
+    processUploadQueue(std::numeric_limits<double>::infinity());
+}
+
+void TextureManager::dropQueuedUpload(const TextureInfo& info) {
+    uploadQueue.erase(std::remove_if(uploadQueue.begin(), uploadQueue.end(),
+        [&info](const PendingUpload& upload) { return upload.info.id == info.id && upload.info.layer == info.layer; }), uploadQueue.end());
+}
+
+void TextureManager::discardPending() {
+    // Let in-flight prefetches finish; their results are simply dropped.
+    for (auto& [key, pending] : pendingTextures) {
+        if (pending.valid()) pending.wait();
+    }
+    pendingTextures.clear();
 }
 
 void TextureManager::cleanup() {
-    for (auto const& [path, texInfo] : textureCache) {
-        if (texInfo.id != 0) {
-            glDeleteTextures(1, &texInfo.id);
+    discardPending();
+
+    for (auto const& [slot, gpu] : gpuTextures) {
+        if (gpu.info.target != GL_TEXTURE_2D_ARRAY) {
+            glDeleteTextures(1, &gpu.info.id);
         }
     }
+    for (auto const& [id, page] : arrayPages) {
+        glDeleteTextures(1, &id);
+    }
+    uploadQueue.clear();
+    uploadRing.release();
+    pinnedPaths.clear();
+    pinnedTextures.clear();
     textureCache.clear();
+    gpuTextures.clear();
+    contentIndex.clear();
+    arrayPages.clear();
+    residentBytes = 0;
 }
\ No newline at end of file
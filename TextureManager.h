@@ -1,16 +1,33 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <glad/glad.h>
+#include "PathKey.h"
+#include "TextureDiskCache.h"
+#include "TextureUploadRing.h"
 
 // Forward-declare AssetManager to avoid a circular include dependency.
 class AssetManager;
+class ThreadPool;
+namespace gli { class texture; }
 
 // A struct to hold both the texture's GPU ID and its OpenGL target type.
+//
+// 2D textures are allocated as one layer of a GL_TEXTURE_2D_ARRAY shared with other textures
+// of the same format and size; 'target' is then GL_TEXTURE_2D_ARRAY, 'id' the array and
+// 'layer' the slice to sample. Shapes whose textures share arrays draw without rebinding.
 struct TextureInfo {
     GLuint id = 0;
     GLenum target = GL_TEXTURE_2D; // Default to 2D texture
+    GLint layer = 0;
 };
 
 class TextureManager {
@@ -19,17 +36,208 @@ public:
     explicit TextureManager(AssetManager& manager);
     ~TextureManager();
 
-    // MODIFICATION: Change the return type from GLuint to the new TextureInfo struct.
+    // Textures stay cached across model loads. Every texture with a non-zero id returned by
+    // loadTexture() or loadTextureSet() carries a reference that the caller must hand back to
+    // releaseTextures() once it stops drawing with it; unreferenced textures are evicted least-recently-used
+    // first whenever the cache is over its VRAM budget.
     TextureInfo loadTexture(const std::string& relativePath);
+    // Loads every slot of a texture set, extracting all uncached files in a single batch.
+    // The result has one entry per input path, in the same order.
+    std::vector<TextureInfo> loadTextureSet(const std::vector<std::string>& relativePaths);
+    void releaseTextures(const std::vector<TextureInfo>& textures);
+
+    // DDS parsing runs on worker threads; the loaders above only allocate each texture on the
+    // GL thread and queue its image data. The queue is drained here, mip level by mip level,
+    // until 'budgetMs' has been spent. Returns the number of textures still waiting. Until a
+    // texture's data arrives it samples as undefined (usually black).
+    size_t processUploadQueue(double budgetMs);
+    // Uploads everything still queued. Call before rendering a frame that will be saved.
+    void flushUploads();
+    const TextureUploadRing::Stats& getUploadStats() const { return uploadRing.getStats(); }
+
+    // Records which block-compressed formats the driver can sample. Call once the GL context
+    // exists; textures in a missing format are decoded to RGBA8 on the CPU instead.
+    void detectFormatSupport();
+
+    // Mip levels larger than 'maxSize' on either axis are dropped before upload (0 = no cap).
+    // Raising or removing the cap reloads the textures that were cut down.
+    void setMaxTextureSize(uint32_t maxSize);
+    size_t getLodSkippedBytes() const { return lodSkippedBytes; }
+
+    void setBudgetBytes(size_t bytes);
+    size_t getResidentBytes() const { return residentBytes; }
+
+    // How well the texture arrays are filled. Allocated layers that hold no texture still
+    // take VRAM but are not counted in getResidentBytes().
+    struct ArrayPoolStats {
+        size_t arrays = 0;
+        size_t layersUsed = 0;
+        size_t layersAllocated = 0;
+        size_t unusedBytes = 0;
+    };
+    ArrayPoolStats getArrayPoolStats() const;
+
+    // One resident texture, for memory reports. A texture shared by several identical paths
+    // is listed once, under the path that loaded it first.
+    struct TextureMemoryUsage {
+        std::string path;
+        GLenum target = 0;
+        GLenum internalFormat = 0;
+        GLsizei width = 0, height = 0;
+        std::vector<size_t> mipBytes; // Per mip level, every face included.
+        size_t bytes = 0;
+        size_t paths = 0;             // Cached paths resolving to this texture.
+        uint32_t refCount = 0;        // Non-zero while a loaded model draws with it.
+    };
+    // Largest first.
+    std::vector<TextureMemoryUsage> getTextureMemoryUsage() const;
+    static std::string formatName(GLenum internalFormat);
+
+    // Opts in to the on-disk cache of ready-to-upload textures (see TextureDiskCache). Call
+    // before loading anything; textures already cached in VRAM are not written out.
+    bool enableDiskCache(const std::filesystem::path& directory) { return diskCache.open(directory); }
+    const TextureDiskCache& getDiskCache() const { return diskCache; }
+
+    // Paths whose DDS data is byte-identical to an already resident texture share its id
+    // instead of uploading a copy. Counts every such load, and the VRAM it didn't allocate.
+    uint64_t getDedupHits() const { return dedupHits; }
+    size_t getDedupSavedBytes() const { return dedupSavedBytes; }
+
+    // Call after the AssetManager's data directories change. Drops only the cached textures
+    // whose path now resolves to a different file (or now resolves at all, for ones that
+    // were missing). Textures still in use stay alive until their last reference is released.
+    void revalidate();
+
+    // Starts extracting and parsing the given textures on worker threads. A later
+    // loadTexture()/loadTextureSet() for one of these paths only has to wait for its result
+    // and upload it. Paths that are already cached or in flight are skipped.
+    void prefetchTextures(const std::vector<std::string>& relativePaths);
+
+    // Loads the given textures and keeps a reference to each until the next call (or
+    // cleanup()), so the budget never evicts them. Meant for textures nearly every model
+    // uses. Replaces the previous pinned set; revalidate() reloads it if files moved.
+    void pinTextures(const std::vector<std::string>& relativePaths);
+    size_t getPinnedCount() const { return pinnedTextures.size(); }
 
     void cleanup();
 
 private:
-    TextureInfo uploadDDSToGPU(const std::vector<char>& data);
+    // The CPU-side half of a load (extraction + DDS parse), produced on a worker thread.
+    struct PreparedTexture;
+
+    // Identifies what a texture was built from: the file's bytes plus the size cap, if the
+    // cap actually dropped levels.
+    struct ContentKey {
+        uint64_t hash = 0;
+        size_t size = 0;
+        uint32_t lodCap = 0;
+        bool operator==(const ContentKey& other) const {
+            return hash == other.hash && size == other.size && lodCap == other.lodCap;
+        }
+    };
+    struct ContentKeyHash {
+        size_t operator()(const ContentKey& key) const {
+            return static_cast<size_t>(key.hash ^ (static_cast<uint64_t>(key.lodCap) << 32));
+        }
+    };
+
+    // One per path. Several entries may share a texture when their files are identical.
+    struct CacheEntry {
+        TextureInfo info;
+        std::string relativePath;
+        std::string source;     // Where the file was found; see AssetManager::resolveSource().
+        bool truncated = false; // Loaded with some mip levels dropped by the size cap.
+    };
+
+    // One per GL texture. It is deleted once no cache entry points at it and every reference
+    // handed out by the loaders has been released, so revalidate() and eviction can drop
+    // paths that loaded models still draw with.
+    struct GpuTexture {
+        TextureInfo info;
+        size_t bytes = 0;       // VRAM of every level, including ones generated on the GPU.
+        std::vector<size_t> mipBytes;
+        std::string path;       // The path that created it, for reports.
+        GLenum internalFormat = 0;
+        GLsizei width = 0, height = 0;
+        uint32_t refCount = 0;
+        uint64_t lastUsed = 0;
+        ContentKey content;
+        std::vector<PathKey> keys; // Cache entries using this texture.
+    };
+
+    // A GL_TEXTURE_2D_ARRAY holding textures with identical storage and sampling state. Each
+    // array for a given format is twice as deep as the previous one (up to a limit), so rare
+    // formats waste little space and common ones end up sharing a few large arrays.
+    struct ArrayPage {
+        GLenum internalFormat = 0;
+        GLsizei width = 0, height = 0;
+        GLsizei storageLevels = 1;
+        GLint swizzles[4] = {};
+        bool generateMips = false;  // glGenerateMipmap rebuilds every layer, so keep these apart.
+        size_t layerBytes = 0;
+        std::vector<bool> usedLayers;
+        uint32_t layersInUse = 0;
+
+        bool fits(const TextureLayout& layout) const;
+    };
+
+    // Identifies one texture: the GL object plus the layer for array-backed textures.
+    static uint64_t slotOf(const TextureInfo& info) { return (static_cast<uint64_t>(info.id) << 32) | static_cast<uint32_t>(info.layer); }
+
+    struct PendingUpload {
+        TextureInfo info;
+        std::unique_ptr<PreparedTexture> prepared;
+        size_t nextMip = 0;
+    };
+
+    // A non-zero 'sourceFingerprint' (see AssetManager::sourceFingerprint()) writes the
+    // result to the disk cache.
+    std::unique_ptr<PreparedTexture> prepareTexture(const std::string& relativePath, std::string source, std::vector<char>&& fileData, uint64_t sourceFingerprint) const;
+    // Returns nullptr on a disk cache miss, with 'sourceFingerprint' set for prepareTexture().
+    std::unique_ptr<PreparedTexture> loadCached(const std::string& relativePath, uint64_t& sourceFingerprint) const;
+    uint64_t diskCacheKey(uint64_t sourceFingerprint, uint32_t maxSize) const;
+    TextureInfo createTexture(const TextureLayout& layout, size_t dataBytes);
+    TextureInfo allocateArrayLayer(const TextureLayout& layout, size_t dataBytes);
+    void releaseStorage(const TextureInfo& info);
+    TextureInfo finishLoad(const PathKey& key, std::unique_ptr<PreparedTexture> prepared);
+    void dropQueuedUpload(const TextureInfo& info);
+    bool takePrefetched(const PathKey& key, TextureInfo& result);
+    TextureInfo retain(CacheEntry& entry);
+    void evict(std::unordered_map<PathKey, CacheEntry>::iterator it);
+    void destroyIfUnused(std::unordered_map<uint64_t, GpuTexture>::iterator it);
+    void enforceBudget();
+    void discardPending();
 
     // MODIFICATION: Holds a reference to the main AssetManager.
     AssetManager& assetManager;
 
     // This cache is for GPU texture IDs, which is still this class's responsibility.
-    std::unordered_map<std::string, TextureInfo> textureCache;
+    // Keyed on the normalised path so case and separator variants share one texture.
+    std::unordered_map<PathKey, CacheEntry> textureCache;
+    std::unordered_map<uint64_t, GpuTexture> gpuTextures; // Keyed by slotOf().
+    std::unordered_map<ContentKey, uint64_t, ContentKeyHash> contentIndex;
+    std::unordered_map<GLuint, ArrayPage> arrayPages;
+    size_t residentBytes = 0; // Live textures plus the spare layers allocated in texture arrays.
+    size_t budgetBytes = size_t(1024) << 20;
+    uint64_t useTick = 0;
+    std::atomic<uint32_t> maxTextureSize{ 0 }; // Read by the prefetch workers.
+    std::atomic<bool> bptcSupported{ true };
+    std::atomic<bool> s3tcSupported{ true };
+    size_t lodSkippedBytes = 0;
+    uint64_t dedupHits = 0;
+    size_t dedupSavedBytes = 0;
+
+    TextureDiskCache diskCache; // Read by the prefetch workers.
+
+    std::vector<std::string> pinnedPaths;
+    std::vector<TextureInfo> pinnedTextures; // One reference each; see pinTextures().
+
+    // Prefetches that have been issued but not yet uploaded. Only touched on the GL thread;
+    // the workers only ever see their own job.
+    std::unordered_map<PathKey, std::future<std::unique_ptr<PreparedTexture>>> pendingTextures;
+    std::unique_ptr<ThreadPool> prefetchPool;
+
+    // Allocated textures whose image data has not been uploaded yet, oldest first.
+    std::deque<PendingUpload> uploadQueue;
+    TextureUploadRing uploadRing;
 };
\ No newline at end of file
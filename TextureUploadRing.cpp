@@ -0,0 +1,128 @@
+#include "TextureUploadRing.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // Keeps every staged mip at an offset that satisfies any GL_UNPACK_ALIGNMENT and the
+    // block size of every compressed format.
+    constexpr size_t kStageAlignment = 64;
+
+    size_t alignUp(size_t value) {
+        return (value + kStageAlignment - 1) & ~(kStageAlignment - 1);
+    }
+}
+
+TextureUploadRing::TextureUploadRing(size_t bufferCount, size_t bufferBytes)
+    : bufferBytes(bufferBytes), buffers(bufferCount == 0 ? 1 : bufferCount) {
+}
+
+bool TextureUploadRing::ensureCreated() {
+    if (created) {
+        return buffers.front().id != 0;
+    }
+    created = true;
+
+    // Errors left by earlier calls would otherwise be read below as this allocation failing.
+    while (glGetError() != GL_NO_ERROR) {}
+
+    for (auto& buffer : buffers) {
+        glGenBuffers(1, &buffer.id);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bufferBytes), nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // Several error flags can be set at once; read them all so none is left for later callers.
+    bool failed = false;
+    while (glGetError() != GL_NO_ERROR) {
+        failed = true;
+    }
+    if (failed) {
+        std::cerr << "Warning: Could not allocate texture upload buffers; uploading from client memory." << std::endl;
+        release();
+        created = true; // Don't retry every upload.
+        return false;
+    }
+    return true;
+}
+
+void TextureUploadRing::advance() {
+    // Fence everything issued from the buffer we are leaving, then wait for the next one.
+    Buffer& leaving = buffers[current];
+    leaving.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    current = (current + 1) % buffers.size();
+    Buffer& next = buffers[current];
+    if (next.fence) {
+        auto start = std::chrono::high_resolution_clock::now();
+        GLenum result = glClientWaitSync(next.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(next.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+        }
+        stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        glDeleteSync(next.fence);
+        next.fence = nullptr;
+    }
+    next.used = 0;
+}
+
+const void* TextureUploadRing::stage(const void* data, size_t size) {
+    if (size == 0 || size > bufferBytes || !ensureCreated()) {
+        stats.directBytes += size;
+        return data;
+    }
+
+    if (buffers[current].used + size > bufferBytes) {
+        advance();
+    }
+    Buffer& buffer = buffers[current];
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+    // The range was either never used or its fence has signalled, so no synchronisation is needed.
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(buffer.used), static_cast<GLsizeiptr>(size),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        stats.directBytes += size;
+        return data;
+    }
+    std::memcpy(mapped, data, size);
+    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+        // The contents were lost (e.g. a display mode change); fall back for this upload.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        stats.directBytes += size;
+        return data;
+    }
+
+    const void* offset = reinterpret_cast<const void*>(static_cast<uintptr_t>(buffer.used));
+    buffer.used = alignUp(buffer.used + size);
+    bound = true;
+    stats.stagedBytes += size;
+    ++stats.stagedUploads;
+    return offset;
+}
+
+void TextureUploadRing::finishUpload() {
+    if (bound) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        bound = false;
+    }
+}
+
+void TextureUploadRing::release() {
+    for (auto& buffer : buffers) {
+        if (buffer.fence) {
+            glDeleteSync(buffer.fence);
+            buffer.fence = nullptr;
+        }
+        if (buffer.id != 0) {
+            glDeleteBuffers(1, &buffer.id);
+            buffer.id = 0;
+        }
+        buffer.used = 0;
+    }
+    current = 0;
+    created = false;
+    bound = false;
+}
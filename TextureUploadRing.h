@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+
+// Stages texture data through a small ring of pixel-unpack buffers instead of handing the
+// driver client memory, which it would have to copy synchronously inside glTex(Sub)Image.
+//
+// Each buffer is filled front to back; when the next mip doesn't fit, a fence is placed behind
+// the uploads issued from it and the ring moves on. A buffer is only written again once its
+// fence has signalled, so the mapping never has to synchronise with the GPU. Time spent
+// waiting on those fences is reported as stall time.
+//
+// GL objects are created on first use and must be released with the context still current.
+class TextureUploadRing {
+public:
+    struct Stats {
+        uint64_t stagedBytes = 0;  // Uploaded from a ring buffer.
+        uint64_t directBytes = 0;  // Uploaded from client memory (too large for a buffer).
+        uint64_t stagedUploads = 0;
+        double stallMs = 0.0;      // Time spent waiting for a buffer to come free.
+    };
+
+    explicit TextureUploadRing(size_t bufferCount = 4, size_t bufferBytes = size_t(16) << 20);
+    ~TextureUploadRing() = default; // release() needs a current context, so it is explicit.
+
+    TextureUploadRing(const TextureUploadRing&) = delete;
+    TextureUploadRing& operator=(const TextureUploadRing&) = delete;
+
+    // Copies 'size' bytes into the ring and leaves that buffer bound to GL_PIXEL_UNPACK_BUFFER.
+    // Returns what to pass as the data argument of the upload call: an offset into the bound
+    // buffer, or 'data' itself (with no buffer bound) if it could not be staged.
+    const void* stage(const void* data, size_t size);
+    // Unbinds the unpack buffer. Call right after the upload that used stage()'s result.
+    void finishUpload();
+
+    void release();
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Buffer {
+        GLuint id = 0;
+        GLsync fence = nullptr;
+        size_t used = 0;
+    };
+
+    bool ensureCreated();
+    void advance();
+
+    size_t bufferBytes;
+    std::vector<Buffer> buffers;
+    size_t current = 0;
+    bool created = false;
+    bool bound = false;
+    Stats stats;
+};
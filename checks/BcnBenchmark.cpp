@@ -0,0 +1,205 @@
+#include "Checks.h"
+#include "BcnDecoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    using Bcn::Backend;
+    using Bcn::Format;
+
+    // Blocks covering each format's modes (BC1 four-colour and punch-through, BC3/BC4/BC5
+    // eight- and six-value channels, BC7 modes 0-7) with the RGBA output of an independent
+    // decoder (Pillow's BCn decoder; BC4 and BC5 expanded the way decode() fills channels).
+    struct GoldenBlock {
+        Format format;
+        uint8_t block[16];
+        uint8_t rgba[64];
+    };
+
+    const GoldenBlock kGoldenBlocks[] = {
+        { Format::BC1,
+          { 0x57, 0x78, 0x84, 0x2E, 0xBA, 0x94, 0x4D, 0x33 },
+          { 0x5F, 0x4B, 0x89, 0xFF, 0x5F, 0x4B, 0x89, 0xFF, 0x44, 0x8F, 0x55, 0xFF, 0x5F, 0x4B, 0x89, 0xFF,
+            0x7B, 0x08, 0xBD, 0xFF, 0x29, 0xD3, 0x21, 0xFF, 0x29, 0xD3, 0x21, 0xFF, 0x5F, 0x4B, 0x89, 0xFF,
+            0x29, 0xD3, 0x21, 0xFF, 0x44, 0x8F, 0x55, 0xFF, 0x7B, 0x08, 0xBD, 0xFF, 0x29, 0xD3, 0x21, 0xFF,
+            0x44, 0x8F, 0x55, 0xFF, 0x7B, 0x08, 0xBD, 0xFF, 0x44, 0x8F, 0x55, 0xFF, 0x7B, 0x08, 0xBD, 0xFF } },
+        { Format::BC1,
+          { 0x38, 0xB9, 0x25, 0xE3, 0x68, 0xC1, 0xB7, 0xC2 },
+          { 0xBD, 0x24, 0xC6, 0xFF, 0xD2, 0x44, 0x77, 0xFF, 0xD2, 0x44, 0x77, 0xFF, 0xE7, 0x65, 0x29, 0xFF,
+            0xE7, 0x65, 0x29, 0xFF, 0xBD, 0x24, 0xC6, 0xFF, 0xBD, 0x24, 0xC6, 0xFF, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0xE7, 0x65, 0x29, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xD2, 0x44, 0x77, 0xFF,
+            0xD2, 0x44, 0x77, 0xFF, 0xBD, 0x24, 0xC6, 0xFF, 0xBD, 0x24, 0xC6, 0xFF, 0x00, 0x00, 0x00, 0x00 } },
+        { Format::BC2,
+          { 0xF6, 0x37, 0x4F, 0x8B, 0xB4, 0x54, 0x84, 0x13, 0x57, 0x78, 0x84, 0x2E, 0xBA, 0x94, 0x4D, 0x33 },
+          { 0x5F, 0x4B, 0x89, 0x66, 0x5F, 0x4B, 0x89, 0xFF, 0x44, 0x8F, 0x55, 0x77, 0x5F, 0x4B, 0x89, 0x33,
+            0x7B, 0x08, 0xBD, 0xFF, 0x29, 0xD3, 0x21, 0x44, 0x29, 0xD3, 0x21, 0xBB, 0x5F, 0x4B, 0x89, 0x88,
+            0x29, 0xD3, 0x21, 0x44, 0x44, 0x8F, 0x55, 0xBB, 0x7B, 0x08, 0xBD, 0x44, 0x29, 0xD3, 0x21, 0x55,
+            0x44, 0x8F, 0x55, 0x44, 0x7B, 0x08, 0xBD, 0x88, 0x44, 0x8F, 0x55, 0x33, 0x7B, 0x08, 0xBD, 0x11 } },
+        { Format::BC2,
+          { 0xBB, 0xC6, 0xFF, 0xDD, 0x34, 0xB0, 0xC0, 0xBA, 0x38, 0xB9, 0x25, 0xE3, 0x68, 0xC1, 0xB7, 0xC2 },
+          { 0xBD, 0x24, 0xC6, 0xBB, 0xCB, 0x39, 0x91, 0xBB, 0xCB, 0x39, 0x91, 0x66, 0xE7, 0x65, 0x29, 0xCC,
+            0xE7, 0x65, 0x29, 0xFF, 0xBD, 0x24, 0xC6, 0xFF, 0xBD, 0x24, 0xC6, 0xDD, 0xD9, 0x4F, 0x5D, 0xDD,
+            0xD9, 0x4F, 0x5D, 0x44, 0xE7, 0x65, 0x29, 0x33, 0xD9, 0x4F, 0x5D, 0x00, 0xCB, 0x39, 0x91, 0xBB,
+            0xCB, 0x39, 0x91, 0x00, 0xBD, 0x24, 0xC6, 0xCC, 0xBD, 0x24, 0xC6, 0xAA, 0xD9, 0x4F, 0x5D, 0xBB } },
+        { Format::BC3,
+          { 0xD8, 0x81, 0x51, 0xC5, 0xF5, 0x91, 0xCD, 0xB4, 0x57, 0x78, 0x84, 0x2E, 0xBA, 0x94, 0x4D, 0x33 },
+          { 0x5F, 0x4B, 0x89, 0x81, 0x5F, 0x4B, 0x89, 0xCB, 0x44, 0x8F, 0x55, 0xA6, 0x5F, 0x4B, 0x89, 0xCB,
+            0x7B, 0x08, 0xBD, 0xB2, 0x29, 0xD3, 0x21, 0xBF, 0x29, 0xD3, 0x21, 0xA6, 0x5F, 0x4B, 0x89, 0x8D,
+            0x29, 0xD3, 0x21, 0x81, 0x44, 0x8F, 0x55, 0xCB, 0x7B, 0x08, 0xBD, 0x99, 0x29, 0xD3, 0x21, 0x99,
+            0x44, 0x8F, 0x55, 0xB2, 0x7B, 0x08, 0xBD, 0x81, 0x44, 0x8F, 0x55, 0xA6, 0x7B, 0x08, 0xBD, 0xA6 } },
+        { Format::BC3,
+          { 0x6B, 0x9D, 0x1C, 0x54, 0xD9, 0xA7, 0x9B, 0xC7, 0x57, 0x78, 0x84, 0x2E, 0xBA, 0x94, 0x4D, 0x33 },
+          { 0x5F, 0x4B, 0x89, 0x89, 0x5F, 0x4B, 0x89, 0x7F, 0x44, 0x8F, 0x55, 0x6B, 0x5F, 0x4B, 0x89, 0x75,
+            0x7B, 0x08, 0xBD, 0x93, 0x29, 0xD3, 0x21, 0x75, 0x29, 0xD3, 0x21, 0x00, 0x5F, 0x4B, 0x89, 0x00,
+            0x29, 0xD3, 0x21, 0xFF, 0x44, 0x8F, 0x55, 0x89, 0x7B, 0x08, 0xBD, 0x00, 0x29, 0xD3, 0x21, 0x93,
+            0x44, 0x8F, 0x55, 0x9D, 0x7B, 0x08, 0xBD, 0xFF, 0x44, 0x8F, 0x55, 0x9D, 0x7B, 0x08, 0xBD, 0x00 } },
+        { Format::BC4,
+          { 0x56, 0x55, 0xF0, 0xB5, 0xFF, 0xB6, 0x77, 0xDC },
+          { 0x56, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF,
+            0x55, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF,
+            0x55, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF,
+            0x55, 0x00, 0x00, 0xFF, 0x56, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF, 0x55, 0x00, 0x00, 0xFF } },
+        { Format::BC4,
+          { 0x2B, 0xAF, 0xB2, 0xC4, 0xDC, 0x21, 0x54, 0xEC },
+          { 0x45, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0x45, 0x00, 0x00, 0xFF, 0x45, 0x00, 0x00, 0xFF,
+            0x7A, 0x00, 0x00, 0xFF, 0xAF, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF,
+            0xAF, 0x00, 0x00, 0xFF, 0x7A, 0x00, 0x00, 0xFF, 0x2B, 0x00, 0x00, 0xFF, 0x45, 0x00, 0x00, 0xFF,
+            0x94, 0x00, 0x00, 0xFF, 0x2B, 0x00, 0x00, 0xFF, 0x5F, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0xFF } },
+        { Format::BC5,
+          { 0x32, 0x14, 0xCD, 0x48, 0x3D, 0xB1, 0x76, 0x9A, 0x43, 0x7B, 0x86, 0xE1, 0x6F, 0xA9, 0xF8, 0x6A },
+          { 0x20, 0x00, 0x00, 0xFF, 0x14, 0x43, 0x00, 0xFF, 0x29, 0x00, 0x00, 0xFF, 0x25, 0x43, 0x00, 0xFF,
+            0x25, 0x00, 0x00, 0xFF, 0x2D, 0xFF, 0x00, 0xFF, 0x18, 0x59, 0x00, 0xFF, 0x14, 0x59, 0x00, 0xFF,
+            0x14, 0x7B, 0x00, 0xFF, 0x1C, 0x6F, 0x00, 0xFF, 0x2D, 0x4E, 0x00, 0xFF, 0x29, 0x64, 0x00, 0xFF,
+            0x18, 0xFF, 0x00, 0xFF, 0x25, 0x6F, 0x00, 0xFF, 0x1C, 0x4E, 0x00, 0xFF, 0x25, 0x59, 0x00, 0xFF } },
+        { Format::BC5,
+          { 0x33, 0xD7, 0x12, 0x4D, 0x4D, 0x47, 0x22, 0x90, 0xBB, 0xA9, 0x40, 0x86, 0x19, 0x7E, 0x37, 0xE4 },
+          { 0x53, 0xBB, 0x00, 0xFF, 0x53, 0xBB, 0x00, 0xFF, 0x95, 0xA9, 0x00, 0xFF, 0x00, 0xB5, 0x00, 0xFF,
+            0x95, 0xBB, 0x00, 0xFF, 0x53, 0xB5, 0x00, 0xFF, 0x74, 0xAE, 0x00, 0xFF, 0x53, 0xBB, 0x00, 0xFF,
+            0xFF, 0xAE, 0x00, 0xFF, 0x33, 0xAB, 0x00, 0xFF, 0xD7, 0xB0, 0x00, 0xFF, 0xD7, 0xB5, 0x00, 0xFF,
+            0x53, 0xB5, 0x00, 0xFF, 0x33, 0xBB, 0x00, 0xFF, 0x95, 0xA9, 0x00, 0xFF, 0x95, 0xAB, 0x00, 0xFF } },
+        { Format::BC7,
+          { 0xD5, 0x35, 0xE8, 0xA2, 0x9D, 0xEC, 0x16, 0xF2, 0x81, 0x2C, 0x3C, 0x7C, 0x95, 0xCC, 0xBB, 0x2A },
+          { 0xD0, 0xE2, 0x43, 0xFF, 0xE5, 0xDF, 0x1C, 0xFF, 0xC4, 0xE3, 0x59, 0xFF, 0xA5, 0xE7, 0x94, 0xFF,
+            0x34, 0x5A, 0x45, 0xFF, 0x1E, 0x4B, 0xB2, 0xFF, 0x17, 0x47, 0xD4, 0xFF, 0x1E, 0x4B, 0xB2, 0xFF,
+            0x25, 0xB3, 0x65, 0xFF, 0x3E, 0x9E, 0x5A, 0xFF, 0x18, 0xBD, 0x6B, 0xFF, 0x25, 0xB3, 0x65, 0xFF,
+            0x32, 0xA8, 0x5F, 0xFF, 0x59, 0x88, 0x4E, 0xFF, 0x32, 0xA8, 0x5F, 0xFF, 0x73, 0x73, 0x42, 0xFF } },
+        { Format::BC7,
+          { 0x2A, 0x16, 0x20, 0x9E, 0x1A, 0xCF, 0xF1, 0x98, 0x8F, 0xCF, 0xFE, 0x9A, 0xA1, 0x07, 0x98, 0x1B },
+          { 0x33, 0xA2, 0xA1, 0xFF, 0x00, 0xF1, 0xF9, 0xFF, 0x19, 0xCA, 0xCE, 0xFF, 0x0C, 0xDE, 0xE3, 0xFF,
+            0x25, 0xB7, 0xB8, 0xFF, 0x4C, 0x7B, 0x76, 0xFF, 0x25, 0xB7, 0xB8, 0xFF, 0x9C, 0xE1, 0xD2, 0xFF,
+            0x33, 0xA2, 0xA1, 0xFF, 0x8B, 0x72, 0xE3, 0xFF, 0x8B, 0x72, 0xE3, 0xFF, 0x9C, 0xE1, 0xD2, 0xFF,
+            0x97, 0xBD, 0xD7, 0xFF, 0x93, 0xA8, 0xDB, 0xFF, 0x93, 0xA8, 0xDB, 0xFF, 0x8B, 0x72, 0xE3, 0xFF } },
+        { Format::BC7,
+          { 0x8C, 0x2E, 0x8B, 0xB2, 0x50, 0x00, 0x1F, 0x47, 0x07, 0x2E, 0x0F, 0x1A, 0xA2, 0xDB, 0x9F, 0xAC },
+          { 0xBD, 0x00, 0x84, 0xFF, 0x91, 0xC4, 0x51, 0xFF, 0x91, 0xC4, 0x51, 0xFF, 0x8F, 0x9E, 0xA6, 0xFF,
+            0x9F, 0x2B, 0x76, 0xFF, 0x63, 0x84, 0x5A, 0xFF, 0x91, 0xC4, 0x51, 0xFF, 0x94, 0xE7, 0x00, 0xFF,
+            0x52, 0x3F, 0x5E, 0xFF, 0x63, 0x84, 0x5A, 0xFF, 0x9F, 0x2B, 0x76, 0xFF, 0x91, 0xC4, 0x51, 0xFF,
+            0x29, 0x42, 0x6B, 0xFF, 0xA5, 0x39, 0x42, 0xFF, 0x81, 0x59, 0x68, 0xFF, 0x81, 0x59, 0x68, 0xFF } },
+        { Format::BC7,
+          { 0x98, 0xBB, 0x35, 0x94, 0x35, 0xA5, 0x30, 0x76, 0x2F, 0x79, 0x50, 0x45, 0xBB, 0x74, 0xA2, 0x70 },
+          { 0xDD, 0x29, 0x97, 0xFF, 0xD7, 0xDD, 0x15, 0xFF, 0x62, 0xCE, 0x73, 0xFF, 0xA6, 0x1F, 0x8D, 0xFF,
+            0x6B, 0x14, 0x82, 0xFF, 0x6B, 0x14, 0x82, 0xFF, 0xD7, 0xDD, 0x15, 0xFF, 0x29, 0xC7, 0xA1, 0xFF,
+            0xA6, 0x1F, 0x8D, 0xFF, 0xDD, 0x29, 0x97, 0xFF, 0x62, 0xCE, 0x73, 0xFF, 0x62, 0xCE, 0x73, 0xFF,
+            0x29, 0xC7, 0xA1, 0xFF, 0x6B, 0x14, 0x82, 0xFF, 0x34, 0x0A, 0x78, 0xFF, 0x29, 0xC7, 0xA1, 0xFF } },
+        { Format::BC7,
+          { 0xD0, 0xB7, 0xCE, 0xD2, 0x37, 0x66, 0x96, 0xDD, 0x72, 0xDD, 0x6B, 0x98, 0xB3, 0x22, 0xE1, 0x35 },
+          { 0xBB, 0x74, 0xED, 0x8C, 0xB2, 0x87, 0xE3, 0x49, 0xBB, 0x61, 0xED, 0x8C, 0xB4, 0x9A, 0xE5, 0x5A,
+            0xBB, 0x87, 0xED, 0x8C, 0xAD, 0x9A, 0xDE, 0x29, 0xB4, 0x87, 0xE5, 0x5A, 0xB2, 0x74, 0xE3, 0x49,
+            0xB9, 0x74, 0xEA, 0x7C, 0xB4, 0x87, 0xE5, 0x5A, 0xB4, 0x9A, 0xE5, 0x5A, 0xBD, 0x87, 0xEF, 0x9C,
+            0xAF, 0x87, 0xE0, 0x39, 0xB6, 0x9A, 0xE8, 0x6B, 0xB2, 0x87, 0xE3, 0x49, 0xBB, 0x9A, 0xED, 0x8C } },
+        { Format::BC7,
+          { 0x20, 0x4F, 0x65, 0x32, 0xC0, 0x2D, 0x5B, 0x74, 0xAF, 0x03, 0x1E, 0x55, 0xAC, 0x00, 0xC5, 0x39 },
+          { 0x9C, 0x63, 0xBF, 0x16, 0x9C, 0x63, 0xBF, 0xDD, 0x9C, 0x63, 0xBF, 0x9C, 0x95, 0x02, 0xCB, 0x9C,
+            0x9C, 0x63, 0xBF, 0x16, 0x9F, 0x93, 0xB9, 0x16, 0x9F, 0x93, 0xB9, 0x16, 0x9F, 0x93, 0xB9, 0x16,
+            0x95, 0x02, 0xCB, 0x57, 0x95, 0x02, 0xCB, 0x57, 0x9F, 0x93, 0xB9, 0x16, 0x98, 0x32, 0xC5, 0xDD,
+            0x98, 0x32, 0xC5, 0x57, 0x98, 0x32, 0xC5, 0x9C, 0x98, 0x32, 0xC5, 0xDD, 0x9F, 0x93, 0xB9, 0x16 } },
+        { Format::BC7,
+          { 0xC0, 0x81, 0x6B, 0xA8, 0xF9, 0x09, 0x36, 0x9B, 0x76, 0x8D, 0x7F, 0x8C, 0xCE, 0x0C, 0x6E, 0x55 },
+          { 0x18, 0x76, 0x66, 0x37, 0x2F, 0x60, 0x45, 0x37, 0x50, 0x40, 0x15, 0x36, 0x34, 0x5B, 0x3E, 0x36,
+            0x5C, 0x34, 0x04, 0x36, 0x2F, 0x60, 0x45, 0x37, 0x4B, 0x45, 0x1D, 0x36, 0x34, 0x5B, 0x3E, 0x36,
+            0x57, 0x39, 0x0C, 0x36, 0x4B, 0x45, 0x1D, 0x36, 0x4B, 0x45, 0x1D, 0x36, 0x07, 0x87, 0x7F, 0x37,
+            0x57, 0x39, 0x0C, 0x36, 0x2A, 0x65, 0x4D, 0x37, 0x23, 0x6C, 0x57, 0x37, 0x23, 0x6C, 0x57, 0x37 } },
+        { Format::BC7,
+          { 0x80, 0x82, 0x57, 0x8D, 0xF9, 0xE6, 0xF0, 0xE0, 0x41, 0xAA, 0xBB, 0x28, 0x39, 0x9A, 0xF8, 0x1B },
+          { 0xF3, 0xF3, 0x18, 0x51, 0x61, 0xC3, 0x92, 0xA2, 0x69, 0x8F, 0x38, 0x74, 0x6D, 0x75, 0x0C, 0x5D,
+            0xBE, 0xC6, 0x5B, 0x73, 0x61, 0xC3, 0x92, 0xA2, 0x6D, 0x75, 0x0C, 0x5D, 0x69, 0x8F, 0x38, 0x74,
+            0xF3, 0xF3, 0x18, 0x51, 0x61, 0xC3, 0x92, 0xA2, 0x61, 0xC3, 0x92, 0xA2, 0x61, 0xC3, 0x92, 0xA2,
+            0xBE, 0xC6, 0x5B, 0x73, 0x61, 0xC3, 0x92, 0xA2, 0x6D, 0x75, 0x0C, 0x5D, 0x6D, 0x75, 0x0C, 0x5D } }
+    };
+
+    // Decodes each format's golden blocks side by side as one image, so the AVX2 pair kernels
+    // are covered too, and compares every block with the reference output.
+    bool checkGoldenBlocks(std::ostream& out, Format format, Backend backend) {
+        std::vector<const GoldenBlock*> golden;
+        for (const GoldenBlock& g : kGoldenBlocks) {
+            if (g.format == format) golden.push_back(&g);
+        }
+        const uint32_t width = uint32_t(golden.size()) * 4;
+        std::vector<uint8_t> blocks;
+        for (const GoldenBlock* g : golden) blocks.insert(blocks.end(), g->block, g->block + Bcn::blockBytes(format));
+        std::vector<uint8_t> decoded(size_t(width) * 4 * 4);
+        Bcn::decode(format, blocks.data(), width, 4, decoded.data(), backend);
+
+        bool allMatch = true;
+        for (size_t b = 0; b < golden.size(); ++b) {
+            for (int row = 0; row < 4; ++row) {
+                if (std::memcmp(&decoded[(row * width + b * 4) * 4], golden[b]->rgba + row * 16, 16) != 0) {
+                    out << "  " << Bcn::formatName(format) << "  " << Bcn::backendName(backend) << ": golden block " << b << " MISMATCH\n";
+                    allMatch = false;
+                    break;
+                }
+            }
+        }
+        return allMatch;
+    }
+
+}
+
+namespace Checks {
+
+bool bcnBenchmark(std::ostream& out, const std::vector<std::string>& args) {
+    const size_t megabytesPerFormat = args.empty() ? 64 : std::stoul(args[0]);
+    // 1024 x 1020 keeps a partial block row at the bottom, so the edge path is checked too.
+    const uint32_t width = 1024, height = 1020;
+    const size_t decodedBytes = size_t(width) * height * 4;
+    const size_t iterations = std::max<size_t>(1, (megabytesPerFormat << 20) / decodedBytes);
+
+    std::mt19937 rng(12345);
+    std::vector<uint8_t> blocks(size_t(width / 4) * ((height + 3) / 4) * 16);
+    for (auto& byte : blocks) byte = static_cast<uint8_t>(rng());
+
+    std::vector<uint8_t> reference(decodedBytes), decoded(decodedBytes);
+    bool allMatch = true;
+    const Backend best = Bcn::bestBackend();
+    out << "BCn decoder benchmark (" << width << "x" << height << ", best backend: " << Bcn::backendName(best) << ")\n";
+
+    for (Format format : { Format::BC1, Format::BC2, Format::BC3, Format::BC4, Format::BC5, Format::BC7 }) {
+        Bcn::decode(format, blocks.data(), width, height, reference.data(), Backend::Scalar);
+        for (Backend backend : { Backend::Scalar, Backend::SSE41, Backend::AVX2 }) {
+            if (static_cast<int>(backend) > static_cast<int>(best)) break;
+            // Backends without their own kernels for this format fall back to the one below.
+            if (Bcn::kernelBackend(format, backend) != backend) continue;
+            allMatch = checkGoldenBlocks(out, format, backend) && allMatch;
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < iterations; ++i) {
+                Bcn::decode(format, blocks.data(), width, height, decoded.data(), backend);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            bool match = decoded == reference;
+            allMatch = allMatch && match;
+
+            out << "  " << Bcn::formatName(format) << "  " << Bcn::backendName(backend) << ": "
+                << static_cast<long long>((iterations * decodedBytes) / (1024.0 * 1024.0) / std::max(seconds, 1e-9)) << " MB/s"
+                << (match ? "" : "  MISMATCH against scalar") << "\n";
+        }
+    }
+    return allMatch;
+}
+
+}
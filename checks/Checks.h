@@ -0,0 +1,51 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Self-checks and benchmarks for the renderer's CPU-side pieces. They build into their own
+// program, NPCPortraitCreatorChecks, and each one is also registered as a CTest test, so none
+// of them adds to the main program's command line.
+//
+// Each check writes what it measured to 'out' and returns false if anything failed. 'args'
+// holds the command-line arguments that follow the check's name.
+namespace Checks {
+
+    // Extracts files from 32 threads at once through a fresh AssetManager and compares every
+    // result (by size and content hash) with a serial extraction. Uses generated loose files
+    // plus a sample of the archives in the directories given as arguments.
+    bool extractStress(std::ostream& out, const std::vector<std::string>& args);
+
+    // Churns a private shared asset cache through many times more single-page files than it
+    // holds, then checks that every live entry is still found with its data, and that evicted
+    // slots were reclaimed so the longest probe run stays short.
+    bool sharedCacheCheck(std::ostream& out, const std::vector<std::string>& args);
+
+    // For every BCn format and each backend the CPU supports that has its own kernels: checks
+    // golden blocks against an independent decoder's output, checks random blocks decode to the
+    // scalar output byte for byte, and writes the throughput (decoded MB/s). The optional
+    // argument is the amount decoded per format and backend, in MB (default 64).
+    bool bcnBenchmark(std::ostream& out, const std::vector<std::string>& args);
+
+    // Builds a NIF of about 50 MB (or the size in MB given as the argument) in memory and parses
+    // it twice: in place through a MemoryInputStream, and through a std::stringstream copy as
+    // loads used to. Fails if either parse fails or the in-place parse's heap peak isn't lower.
+    bool parseMemoryCheck(std::ostream& out, const std::vector<std::string>& args);
+
+    // Poses a synthetic head of 30000 skinned vertices (or the count given as the argument)
+    // with each skinning backend the CPU supports and with the old per-vertex matrix blend that
+    // stored every posed position, checks the bounds agree and writes the throughput.
+    bool skinningBenchmark(std::ostream& out, const std::vector<std::string>& args);
+
+    // Compares SceneGraphTable::lowestCommonAncestor with a plain walk (try each ancestor of the
+    // first block, check that it is an ancestor of every other) on 20000 random forests, or as
+    // many as the argument gives.
+    bool lcaCheck(std::ostream& out, const std::vector<std::string>& args);
+
+    // Runs every index optimiser pass on a sphere mesh whose triangles and vertices have been
+    // shuffled, and checks that the result draws the same triangles with the same winding and a
+    // lower ACMR, and that optimizeVertexFetch alone keeps the triangle order.
+    bool indexCheck(std::ostream& out, const std::vector<std::string>& args);
+
+}
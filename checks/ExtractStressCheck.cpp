@@ -0,0 +1,109 @@
+#include "Checks.h"
+#include "AssetManager.h"
+#include "BsaManager.h"
+#include "ContentHash.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <random>
+#include <thread>
+
+namespace Checks {
+
+bool extractStress(std::ostream& out, const std::vector<std::string>& args) {
+    constexpr size_t kThreadCount = 32;
+    constexpr size_t kLooseFiles = 64;
+    constexpr size_t kArchiveSamplesPerDirectory = 96;
+    constexpr size_t kExtractionsPerThread = 400;
+
+    // Loose files with known contents, in a scratch data directory of their own.
+    std::error_code ec;
+    std::random_device seed;
+    const std::filesystem::path scratch = std::filesystem::temp_directory_path(ec) / ("npc_extract_stress_" + std::to_string(seed()));
+    std::filesystem::create_directories(scratch / "meshes" / "stress", ec);
+    if (ec) {
+        out << "Extraction stress test: could not create " << scratch.string() << " (" << ec.message() << ")\n";
+        return false;
+    }
+
+    struct Expected {
+        std::string path;
+        size_t size = 0;
+        uint64_t hash = 0;
+    };
+    std::vector<Expected> expected;
+    std::mt19937 rng(20240611);
+    for (size_t i = 0; i < kLooseFiles; ++i) {
+        std::vector<char> contents(1 + rng() % (256 << 10));
+        for (auto& byte : contents) byte = static_cast<char>(rng());
+        const std::string path = "meshes/stress/file" + std::to_string(i) + ".bin";
+        std::ofstream file(scratch / path, std::ios::binary);
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        expected.push_back({ path, contents.size(), contentHash64(contents.data(), contents.size()) });
+    }
+
+    AssetManager assets;
+    std::vector<std::filesystem::path> directories(args.begin(), args.end());
+    directories.push_back(scratch);
+    assets.setActiveDirectories(directories, scratch / "bsa_cache");
+
+    // Archived files: a sample of each directory's index, with a serial extraction as the reference.
+    size_t archived = 0;
+    for (const std::string& directory : args) {
+        BsaManager archives;
+        archives.loadArchives(directory, scratch / "bsa_cache");
+        for (const PathKey& key : archives.listFiles(kArchiveSamplesPerDirectory)) {
+            std::vector<char> contents = assets.extractFile(key.str());
+            if (contents.empty()) continue;
+            expected.push_back({ key.str(), contents.size(), contentHash64(contents.data(), contents.size()) });
+            ++archived;
+        }
+    }
+
+    std::atomic<size_t> extractions{ 0 }, mismatches{ 0 };
+    auto check = [&](const Expected& want, const std::vector<char>& got) {
+        extractions.fetch_add(1, std::memory_order_relaxed);
+        if (got.size() != want.size || contentHash64(got.data(), got.size()) != want.hash) {
+            if (mismatches.fetch_add(1) < 10) {
+                out << "  MISMATCH: " << want.path << " (" << got.size() << " bytes, expected " << want.size << ")\n";
+            }
+        }
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreadCount; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 pick(static_cast<uint32_t>(t));
+            for (size_t i = 0; i < kExtractionsPerThread; ++i) {
+                if (i % 8 == 7) {
+                    // Every eighth request is a small batch, which goes through the async reader.
+                    std::vector<size_t> batch;
+                    std::vector<std::string> paths;
+                    for (int b = 0; b < 4; ++b) {
+                        batch.push_back(pick() % expected.size());
+                        paths.push_back(expected[batch.back()].path);
+                    }
+                    std::vector<std::vector<char>> results = assets.extractFiles(paths);
+                    for (size_t b = 0; b < batch.size(); ++b) check(expected[batch[b]], results[b]);
+                }
+                else {
+                    const Expected& want = expected[pick() % expected.size()];
+                    check(want, assets.extractFile(want.path));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    out << "Extraction stress test: " << kThreadCount << " threads, " << extractions.load() << " extractions of " << kLooseFiles
+        << " loose and " << archived << " archived files in " << seconds << " s, " << mismatches.load() << " mismatches\n";
+
+    std::filesystem::remove_all(scratch, ec);
+    return mismatches.load() == 0;
+}
+
+}
@@ -0,0 +1,111 @@
+#include "Checks.h"
+#include "IndexOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    // Each triangle rotated to start at its smallest index (which keeps its winding), in
+    // sorted order, with 'names' mapping the indices to the original vertex numbers first.
+    std::vector<uint64_t> CanonicalTriangles(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& names) {
+        std::vector<uint64_t> triangles;
+        triangles.reserve(indices.size() / 3);
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            uint64_t v[3] = { names[indices[t]], names[indices[t + 1]], names[indices[t + 2]] };
+            const int first = v[0] <= v[1] && v[0] <= v[2] ? 0 : (v[1] <= v[2] ? 1 : 2);
+            triangles.push_back((v[first] << 42) | (v[(first + 1) % 3] << 21) | v[(first + 2) % 3]);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+}
+
+namespace Checks {
+
+bool indexCheck(std::ostream& out, const std::vector<std::string>&) {
+    // A latitude/longitude sphere, so the overdraw pass sees normals in every direction.
+    const uint32_t rings = 200, segments = 200;
+    std::vector<float> positions;
+    for (uint32_t r = 0; r <= rings; ++r) {
+        const float theta = 3.14159265f * float(r) / float(rings);
+        for (uint32_t s = 0; s <= segments; ++s) {
+            const float phi = 6.28318531f * float(s) / float(segments);
+            positions.insert(positions.end(), { std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta) });
+        }
+    }
+    const size_t vertexCount = positions.size() / 3;
+    std::vector<uint32_t> indices;
+    for (uint32_t r = 0; r < rings; ++r) {
+        for (uint32_t s = 0; s < segments; ++s) {
+            const uint32_t a = r * (segments + 1) + s, b = a + segments + 1;
+            indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+
+    // Shuffle the vertex numbers, the triangle order and where each triangle starts, as an
+    // exporter that paid no attention to the cache might.
+    std::mt19937 rng(2718);
+    std::vector<uint32_t> vertexOrder(vertexCount);
+    std::iota(vertexOrder.begin(), vertexOrder.end(), 0u);
+    std::shuffle(vertexOrder.begin(), vertexOrder.end(), rng);
+    std::vector<float> shuffledPositions(positions.size());
+    for (size_t v = 0; v < vertexCount; ++v) {
+        std::copy_n(&positions[v * 3], 3, &shuffledPositions[size_t(vertexOrder[v]) * 3]);
+    }
+    std::vector<uint32_t> triangleOrder(indices.size() / 3);
+    std::iota(triangleOrder.begin(), triangleOrder.end(), 0u);
+    std::shuffle(triangleOrder.begin(), triangleOrder.end(), rng);
+    std::vector<uint32_t> input;
+    input.reserve(indices.size());
+    for (uint32_t t : triangleOrder) {
+        const int rotation = int(rng() % 3);
+        for (int k = 0; k < 3; ++k) input.push_back(vertexOrder[indices[t * 3 + (k + rotation) % 3]]);
+    }
+
+    std::vector<uint32_t> identity(vertexCount);
+    std::iota(identity.begin(), identity.end(), 0u);
+    const std::vector<uint64_t> expected = CanonicalTriangles(input, identity);
+    auto inverse = [vertexCount](const std::vector<uint32_t>& remap) {
+        std::vector<uint32_t> names(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) names[remap[v]] = uint32_t(v);
+        return names;
+    };
+
+    std::vector<uint32_t> optimized = input;
+    const auto start = std::chrono::high_resolution_clock::now();
+    IndexOptimizer::optimizeVertexCache(optimized, vertexCount);
+    const auto afterCache = std::chrono::high_resolution_clock::now();
+    IndexOptimizer::optimizeOverdraw(optimized, shuffledPositions.data(), sizeof(float) * 3, vertexCount);
+    const auto afterOverdraw = std::chrono::high_resolution_clock::now();
+    const std::vector<uint32_t> remap = IndexOptimizer::optimizeVertexFetch(optimized, vertexCount);
+    const auto end = std::chrono::high_resolution_clock::now();
+    auto ms = [](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+
+    const double acmrBefore = IndexOptimizer::acmr(input, vertexCount);
+    const double acmrAfter = IndexOptimizer::acmr(optimized, vertexCount);
+    const bool sameTriangles = CanonicalTriangles(optimized, inverse(remap)) == expected;
+
+    // Blended shapes only get their vertices renumbered; their triangle order must survive.
+    std::vector<uint32_t> fetchOnly = input;
+    const std::vector<uint32_t> names = inverse(IndexOptimizer::optimizeVertexFetch(fetchOnly, vertexCount));
+    bool sameOrder = fetchOnly.size() == input.size();
+    for (size_t i = 0; sameOrder && i < input.size(); ++i) sameOrder = names[fetchOnly[i]] == input[i];
+
+    out << "Index optimiser check (" << input.size() / 3 << " shuffled sphere triangles, " << vertexCount << " vertices)\n"
+        << "  ACMR " << acmrBefore << " -> " << acmrAfter << " (" << IndexOptimizer::kReportCacheSize << "-entry FIFO cache)"
+        << (acmrAfter < acmrBefore ? "" : "  NOT REDUCED") << "\n"
+        << "  vertex cache " << ms(start, afterCache) << " ms, overdraw " << ms(afterCache, afterOverdraw)
+        << " ms, vertex fetch " << ms(afterOverdraw, end) << " ms\n"
+        << "  triangles and winding " << (sameTriangles ? "preserved" : "CHANGED") << "; fetch-only triangle order "
+        << (sameOrder ? "preserved" : "CHANGED") << "\n";
+    return acmrAfter < acmrBefore && sameTriangles && sameOrder;
+}
+
+}
@@ -0,0 +1,65 @@
+#include "Checks.h"
+#include "SceneGraphTable.h"
+#include <algorithm>
+#include <numeric>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Checks {
+
+bool lcaCheck(std::ostream& out, const std::vector<std::string>& args) {
+    constexpr uint32_t kNone = SceneGraphTable::kNone;
+    const size_t trials = args.empty() ? 20000 : std::stoul(args[0]);
+    std::mt19937 rng(4711);
+    size_t mismatches = 0;
+    for (size_t trial = 0; trial < trials; ++trial) {
+        // A random forest: node k's parent is an earlier node (or none, for a few roots), then
+        // the ids are shuffled so parents don't always come first, as in a NIF's block list.
+        const uint32_t count = 1 + rng() % 300;
+        std::vector<uint32_t> ids(count);
+        std::iota(ids.begin(), ids.end(), 0u);
+        std::shuffle(ids.begin(), ids.end(), rng);
+        std::vector<uint32_t> parents(count, kNone), depths(count, 0);
+        for (uint32_t k = 1; k < count; ++k) {
+            if (rng() % 50 == 0) continue;
+            // Bias towards recent nodes so some chains get deep.
+            const uint32_t parent = rng() % 2 ? k - 1 - rng() % std::min<uint32_t>(k, 4) : rng() % k;
+            parents[ids[k]] = ids[parent];
+            depths[ids[k]] = depths[ids[parent]] + 1;
+        }
+        // Bones from anywhere would nearly always meet at a root, so half the trials draw them
+        // from one random subtree, like a skeleton under an NPC's root node.
+        std::vector<uint32_t> pool;
+        const uint32_t subtree = rng() % 2 ? rng() % count : kNone;
+        for (uint32_t b = 0; b < count; ++b) {
+            uint32_t p = b;
+            while (p != kNone && p != subtree) p = parents[p];
+            if (p == subtree) pool.push_back(b);
+        }
+        std::vector<uint32_t> blocks(1 + rng() % 120);
+        for (uint32_t& block : blocks) block = pool[rng() % pool.size()];
+
+        // The reference: the first ancestor of blocks[0] that every other block descends from.
+        auto isAncestor = [&parents](uint32_t ancestor, uint32_t node) {
+            for (uint32_t p = node; p != kNone; p = parents[p]) {
+                if (p == ancestor) return true;
+            }
+            return false;
+        };
+        uint32_t expected = kNone;
+        for (uint32_t candidate = blocks[0]; candidate != kNone && expected == kNone; candidate = parents[candidate]) {
+            if (std::all_of(blocks.begin() + 1, blocks.end(), [&](uint32_t b) { return isAncestor(candidate, b); })) {
+                expected = candidate;
+            }
+        }
+
+        if (SceneGraphTable::lowestCommonAncestor(parents, depths, blocks) != expected) ++mismatches;
+    }
+    out << "Scene graph LCA check: " << trials << " random forests (up to 300 blocks, 120 bones), "
+        << mismatches << " mismatches against the ancestor walk\n";
+    return mismatches == 0;
+}
+
+}
@@ -0,0 +1,126 @@
+#include "Checks.h"
+#include "MemoryStream.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <NifFile.hpp>
+
+// This program's global operator new and delete keep a count of live heap bytes and their
+// peak, so the check below measures exactly what one parse allocates instead of sampling the
+// process's resident size. The array and nothrow forms call these.
+namespace {
+    // Each block starts with its size, padded so the returned pointer stays suitably aligned.
+    constexpr size_t kHeaderBytes = alignof(std::max_align_t);
+
+    std::atomic<size_t> liveHeapBytes{ 0 };
+    std::atomic<size_t> peakHeapBytes{ 0 };
+
+    // The most the live heap grew above its starting size while 'work' ran.
+    template <typename Work>
+    size_t PeakHeapGrowth(Work&& work) {
+        const size_t baseline = liveHeapBytes.load();
+        peakHeapBytes.store(baseline);
+        work();
+        return peakHeapBytes.load() - baseline;
+    }
+}
+
+void* operator new(std::size_t size) {
+    void* block = std::malloc(size + kHeaderBytes);
+    if (!block) throw std::bad_alloc();
+    *static_cast<size_t*>(block) = size;
+    const size_t live = liveHeapBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = peakHeapBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakHeapBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    return static_cast<char*>(block) + kHeaderBytes;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer) return;
+    void* block = static_cast<char*>(pointer) - kHeaderBytes;
+    liveHeapBytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    operator delete(pointer);
+}
+
+namespace Checks {
+
+bool parseMemoryCheck(std::ostream& out, const std::vector<std::string>& args) {
+    const size_t megabytes = args.empty() ? 50 : std::stoul(args[0]);
+
+    // One grid shape just under nifly's 16-bit triangle index limit, repeated until the file
+    // reaches the requested size.
+    const uint16_t side = 255;
+    std::vector<nifly::Vector3> vertices, normals;
+    std::vector<nifly::Vector2> uvs;
+    std::vector<nifly::Triangle> triangles;
+    for (uint16_t y = 0; y < side; ++y) {
+        for (uint16_t x = 0; x < side; ++x) {
+            vertices.emplace_back(float(x), float(y), 0.0f);
+            normals.emplace_back(0.0f, 0.0f, 1.0f);
+            uvs.emplace_back(float(x) / (side - 1), float(y) / (side - 1));
+        }
+    }
+    for (uint16_t y = 0; y + 1 < side; ++y) {
+        for (uint16_t x = 0; x + 1 < side; ++x) {
+            uint16_t i = static_cast<uint16_t>(y * side + x);
+            triangles.emplace_back(i, static_cast<uint16_t>(i + 1), static_cast<uint16_t>(i + side));
+            triangles.emplace_back(static_cast<uint16_t>(i + 1), static_cast<uint16_t>(i + side + 1), static_cast<uint16_t>(i + side));
+        }
+    }
+
+    std::vector<char> data;
+    size_t shapeCount = 0;
+    {
+        nifly::NifFile nif;
+        nif.Create(nifly::NiVersion::getSSE());
+        auto save = [&nif]() {
+            std::ostringstream stream(std::ios::binary);
+            nif.Save(stream);
+            return stream.str();
+        };
+        nif.CreateShapeFromData("Grid0", &vertices, &triangles, &uvs, &normals);
+        shapeCount = 1;
+        const size_t shapeBytes = std::max<size_t>(save().size(), 1);
+        for (; shapeCount * shapeBytes < (megabytes << 20); ++shapeCount) {
+            nif.CreateShapeFromData("Grid" + std::to_string(shapeCount), &vertices, &triangles, &uvs, &normals);
+        }
+        std::string saved = save();
+        data.assign(saved.begin(), saved.end());
+    }
+
+    // In place, as NifModel::parse reads a file, and through a std::stringstream copy as loads
+    // used to.
+    bool inPlaceParsed = false, copiedParsed = false;
+    const size_t inPlaceBytes = PeakHeapGrowth([&]() {
+        auto parsed = std::make_shared<nifly::NifFile>();
+        MemoryInputStream nifStream(data.data(), data.size());
+        inPlaceParsed = parsed->Load(nifStream) == 0 && parsed->GetShapes().size() == shapeCount;
+    });
+    const size_t copiedBytes = PeakHeapGrowth([&]() {
+        auto parsed = std::make_shared<nifly::NifFile>();
+        std::stringstream nifStream(std::string(data.begin(), data.end()));
+        copiedParsed = parsed->Load(nifStream) == 0 && parsed->GetShapes().size() == shapeCount;
+    });
+
+    auto toMB = [](size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+    out << std::fixed << std::setprecision(1)
+        << "NIF parse memory check: " << toMB(data.size()) << " MB NIF with " << shapeCount << " shapes\n"
+        << "  In place (MemoryInputStream): peak heap +" << toMB(inPlaceBytes) << " MB" << (inPlaceParsed ? "" : "  PARSE FAILED") << "\n"
+        << "  stringstream copy:            peak heap +" << toMB(copiedBytes) << " MB" << (copiedParsed ? "" : "  PARSE FAILED") << "\n";
+    return inPlaceParsed && copiedParsed && inPlaceBytes < copiedBytes;
+}
+
+}
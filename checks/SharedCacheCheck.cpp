@@ -0,0 +1,69 @@
+#include "Checks.h"
+#include "PathKey.h"
+#include "SharedAssetCache.h"
+#include <algorithm>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Checks {
+
+bool sharedCacheCheck(std::ostream& out, const std::vector<std::string>&) {
+    constexpr size_t kCapacityBytes = 64 << 20;
+    constexpr size_t kInsertsPerEntry = 20;
+
+    std::random_device seed;
+    const std::string name = "NPCPortraitCreatorCheck" + std::to_string(seed());
+    SharedAssetCache cache;
+    if (!cache.open(name, kCapacityBytes)) {
+        out << "Shared cache check: could not open a cache\n";
+        return false;
+    }
+    SharedAssetCache::remove(name); // The mapping stays valid until close().
+
+    // Single-page blobs keep the table as full as the pages allow, and inserting many times
+    // more of them than fit churns every slot through eviction repeatedly.
+    const uint32_t entryCount = cache.tableStats().entries;
+    const size_t insertCount = entryCount * kInsertsPerEntry;
+    auto pathOf = [](size_t i) { return PathKey("meshes\\check\\file" + std::to_string(i) + ".nif"); };
+    auto dataOf = [](size_t i) {
+        std::vector<char> data(512 + (i * 7919) % 8192);
+        for (size_t b = 0; b < data.size(); ++b) data[b] = static_cast<char>(i + b * 31);
+        return data;
+    };
+    std::mt19937 rng(99);
+    for (size_t i = 0; i < insertCount; ++i) {
+        cache.insert(i % 3, pathOf(i), dataOf(i));
+        // Re-read a few recent files so the clock sees some of them referenced.
+        if (i > 0 && rng() % 4 == 0) {
+            std::vector<char> recent;
+            const size_t back = rng() % std::min<size_t>(i, 256);
+            cache.lookup((i - back) % 3, pathOf(i - back), recent);
+        }
+    }
+
+    // Every live entry must still be reachable along its probe sequence, and must hold the
+    // data it was stored with.
+    const SharedAssetCache::TableStats stats = cache.tableStats();
+    size_t hits = 0, corrupt = 0;
+    std::vector<char> data;
+    for (size_t i = 0; i < insertCount; ++i) {
+        if (!cache.lookup(i % 3, pathOf(i), data)) continue;
+        ++hits;
+        if (data != dataOf(i)) ++corrupt;
+    }
+    cache.close();
+
+    // Live entries fill at most half the table, so without tombstones piling up the longest
+    // run stays a small fraction of it.
+    const bool shortProbes = stats.longestRun <= stats.entries / 8;
+    out << "Shared cache check: " << insertCount << " inserts into " << stats.entries << " slots; "
+        << stats.live << " live, " << stats.tombstones << " tombstones, longest probe run " << stats.longestRun
+        << (shortProbes ? "" : "  TOO LONG") << "\n"
+        << "  " << hits << " of the " << stats.live << " live entries found" << (hits == stats.live ? "" : "  UNREACHABLE ENTRIES")
+        << ", " << corrupt << " with wrong data\n";
+    return shortProbes && hits == stats.live && corrupt == 0;
+}
+
+}
@@ -0,0 +1,157 @@
+#include "Checks.h"
+#include "SkinningKernel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    using Skinning::Affine;
+    using Skinning::Backend;
+    using Skinning::PosedBounds;
+    using Skinning::Streams;
+
+    // What NifModel did before this kernel: blend the four bone matrices for every vertex, store
+    // the posed position, then take the bounds and the centroid in two more passes.
+    PosedBounds storedPoseBounds(const Streams& v, const Affine* bones, const Affine& toRoot) {
+        std::vector<float> posed;
+        posed.reserve(v.count * 3);
+        for (size_t i = 0; i < v.count; ++i) {
+            const float p[3] = { v.x[i], v.y[i], v.z[i] };
+            float skinned[3] = { p[0], p[1], p[2] };
+            float total = v.weights[0][i] + v.weights[1][i] + v.weights[2][i] + v.weights[3][i];
+            if (total > 0.0f) {
+                Affine blend = {};
+                for (int k = 0; k < 4; ++k) {
+                    const Affine& bone = bones[v.boneIds[k][i]];
+                    for (int r = 0; r < 3; ++r)
+                        for (int c = 0; c < 4; ++c) blend.m[r][c] += v.weights[k][i] * bone.m[r][c];
+                }
+                for (int r = 0; r < 3; ++r) {
+                    skinned[r] = (blend.m[r][0] * p[0] + blend.m[r][1] * p[1] + blend.m[r][2] * p[2] + blend.m[r][3]) / total;
+                }
+            }
+            for (int r = 0; r < 3; ++r) {
+                posed.push_back(toRoot.m[r][0] * skinned[0] + toRoot.m[r][1] * skinned[1] + toRoot.m[r][2] * skinned[2] + toRoot.m[r][3]);
+            }
+        }
+
+        PosedBounds bounds;
+        for (int c = 0; c < 3; ++c) {
+            bounds.min[c] = std::numeric_limits<float>::max();
+            bounds.max[c] = std::numeric_limits<float>::lowest();
+        }
+        for (size_t i = 0; i < posed.size(); i += 3) {
+            for (int c = 0; c < 3; ++c) {
+                bounds.min[c] = std::min(bounds.min[c], posed[i + c]);
+                bounds.max[c] = std::max(bounds.max[c], posed[i + c]);
+            }
+        }
+        float sum[3] = { 0.0f, 0.0f, 0.0f };
+        for (size_t i = 0; i < posed.size(); i += 3) {
+            for (int c = 0; c < 3; ++c) sum[c] += posed[i + c];
+        }
+        for (int c = 0; c < 3; ++c) bounds.centroid[c] = v.count ? sum[c] / static_cast<float>(v.count) : 0.0f;
+        return bounds;
+    }
+
+    Affine randomBone(std::mt19937& rng) {
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        // A random rotation from a normalised quaternion, plus a translation on the scale of a head.
+        float q[4] = { unit(rng), unit(rng), unit(rng), unit(rng) };
+        const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (float& component : q) component /= length;
+        const float w = q[0], x = q[1], y = q[2], z = q[3];
+        Affine bone = { {
+            { 1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y), unit(rng) * 10.0f },
+            { 2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x), unit(rng) * 10.0f },
+            { 2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y), 110.0f + unit(rng) * 10.0f },
+        } };
+        return bone;
+    }
+
+}
+
+namespace Checks {
+
+bool skinningBenchmark(std::ostream& out, const std::vector<std::string>& args) {
+    const size_t vertexCount = args.empty() ? 30000 : std::stoul(args[0]);
+    const size_t boneCount = 64;
+    const size_t iterations = std::max<size_t>(1, (size_t(200) << 20) / std::max<size_t>(1, vertexCount * 32));
+
+    // Positions around a head-sized box; one to four influences per vertex, with weights that
+    // don't always sum to one and the odd unweighted vertex.
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> coordinate(-12.0f, 12.0f);
+    std::uniform_real_distribution<float> weight(0.0f, 1.0f);
+    std::uniform_int_distribution<int32_t> bone(0, static_cast<int32_t>(boneCount) - 1);
+    std::uniform_int_distribution<int> influences(0, 4);
+
+    Skinning::StreamStorage storage;
+    storage.resize(vertexCount, true);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        storage.x[i] = coordinate(rng);
+        storage.y[i] = coordinate(rng);
+        storage.z[i] = coordinate(rng) * 1.5f;
+        const int used = (i % 97 == 0) ? 0 : std::max(1, influences(rng));
+        for (int k = 0; k < used; ++k) {
+            storage.boneIds[k][i] = bone(rng);
+            storage.weights[k][i] = weight(rng);
+        }
+    }
+    std::vector<Affine> bones;
+    for (size_t b = 0; b < boneCount; ++b) bones.push_back(randomBone(rng));
+    const Affine toRoot = randomBone(rng);
+    const Streams v = storage.view();
+
+    const Backend best = Skinning::bestBackend();
+    out << "Skinning bounds benchmark (" << vertexCount << " vertices, " << boneCount << " bones, best backend: " << Skinning::backendName(best) << ")\n";
+
+    auto throughput = [&](double seconds) {
+        return (iterations * vertexCount) / 1e6 / std::max(seconds, 1e-9);
+    };
+
+    PosedBounds stored;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < iterations; ++i) stored = storedPoseBounds(v, bones.data(), toRoot);
+    double storedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    out << "  stored posed vertices: " << throughput(storedSeconds) << " Mvert/s\n";
+
+    // The formulations round differently, so they're compared with a tolerance scaled to the
+    // model; every backend must produce the scalar kernel's bounds exactly.
+    float extent = 1.0f;
+    for (int c = 0; c < 3; ++c) extent = std::max({ extent, std::fabs(stored.min[c]), std::fabs(stored.max[c]) });
+    const float tolerance = extent * 1e-5f;
+    auto near = [tolerance](const float* a, const float* b) {
+        for (int c = 0; c < 3; ++c) if (std::fabs(a[c] - b[c]) > tolerance) return false;
+        return true;
+    };
+
+    bool allMatch = true;
+    PosedBounds scalar = Skinning::posedBounds(v, bones.data(), boneCount, toRoot, Backend::Scalar);
+    for (Backend backend : { Backend::Scalar, Backend::AVX2 }) {
+        if (static_cast<int>(backend) > static_cast<int>(best)) break;
+
+        PosedBounds bounds;
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < iterations; ++i) bounds = Skinning::posedBounds(v, bones.data(), boneCount, toRoot, backend);
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+        bool match = near(bounds.min, stored.min) && near(bounds.max, stored.max) && near(bounds.centroid, stored.centroid);
+        for (int c = 0; c < 3; ++c) {
+            match = match && bounds.min[c] == scalar.min[c] && bounds.max[c] == scalar.max[c];
+        }
+        match = match && near(bounds.centroid, scalar.centroid);
+        allMatch = allMatch && match;
+
+        out << "  " << Skinning::backendName(backend) << ": " << throughput(seconds) << " Mvert/s ("
+            << storedSeconds / std::max(seconds, 1e-9) << "x)" << (match ? "" : "  MISMATCH") << "\n";
+    }
+    return allMatch;
+}
+
+}
@@ -0,0 +1,44 @@
+#include "Checks.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+    struct Check {
+        const char* name;
+        const char* usage;
+        bool (*run)(std::ostream& out, const std::vector<std::string>& args);
+    };
+
+    const Check kChecks[] = {
+        { "extract-stress", "[archive directory...]", Checks::extractStress },
+        { "shared-cache", "", Checks::sharedCacheCheck },
+        { "bcn-benchmark", "[megabytes per format]", Checks::bcnBenchmark },
+        { "parse-memory", "[megabytes]", Checks::parseMemoryCheck },
+        { "skinning-benchmark", "[vertex count]", Checks::skinningBenchmark },
+        { "lca", "[trials]", Checks::lcaCheck },
+        { "index", "", Checks::indexCheck },
+    };
+
+    void PrintUsage(const char* program) {
+        std::cerr << "Usage: " << program << " <check> [arguments]\n\nChecks:\n";
+        for (const Check& check : kChecks) {
+            std::cerr << "  " << check.name << " " << check.usage << "\n";
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    for (const Check& check : kChecks) {
+        if (std::strcmp(argv[1], check.name) == 0) {
+            const std::vector<std::string> args(argv + 2, argv + argc);
+            return check.run(std::cout, args) ? 0 : 1;
+        }
+    }
+    std::cerr << "Error: unknown check '" << argv[1] << "'\n";
+    PrintUsage(argv[0]);
+    return 1;
+}
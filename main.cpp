@@ -46,6 +46,15 @@ int main(int argc, char** argv) {
         ("imgY", "Vertical resolution of the output PNG", cxxopts::value<int>())
         ("bgcolor", "Background R,G,B color (e.g. \"0.1,0.5,1.0\")", cxxopts::value<std::string>())
         ("fov", "Camera vertical Field of View in degrees", cxxopts::value<float>())
+        // Cross-process asset cache (opt-in)
+        ("shared-cache-mb", "Share extracted archive files with other running instances through a shared-memory cache of this size in MB", cxxopts::value<int>())
+        ("shared-cache-name", "Name of the shared-memory asset cache", cxxopts::value<std::string>()->default_value("NPCPortraitCreatorAssets"))
+        ("texture-cache-dir", "Keep ready-to-upload copies of textures in this folder so later runs skip extracting and parsing them", cxxopts::value<std::string>())
+        ("mesh-cache-dir", "Keep compiled copies of processed models in this folder so later loads skip parsing and preprocessing them", cxxopts::value<std::string>())
+        ("texture-budget-mb", "VRAM budget in MB for textures cached between model loads", cxxopts::value<int>())
+        ("stats", "In headless mode, write a JSON report of GPU memory use to this file (- for stdout)", cxxopts::value<std::string>())
+        ("warm-list", "Text file of texture paths (one per line) to preload and keep in VRAM for every portrait", cxxopts::value<std::string>())
+        ("warm-scan", "Before a batch export, preload and keep in VRAM the textures shared by its first N NIFs", cxxopts::value<int>())
         ("v,version", "Print the program version and exit")
         ("h,help", "Print usage");
     auto result = options.parse(argc, argv);
@@ -94,6 +103,25 @@ int main(int argc, char** argv) {
         if (result.count("fov")) {
             renderer.setFov(result["fov"].as<float>());
         }
+        if (result.count("texture-budget-mb")) {
+            renderer.setTextureBudgetMB(result["texture-budget-mb"].as<int>());
+        }
+        if (result.count("texture-cache-dir")) {
+            if (!renderer.enableTextureDiskCache(result["texture-cache-dir"].as<std::string>())) {
+                std::cerr << "Warning: Texture disk cache unavailable; continuing without it." << std::endl;
+            }
+        }
+        if (result.count("mesh-cache-dir")) {
+            if (!renderer.enableMeshCache(result["mesh-cache-dir"].as<std::string>())) {
+                std::cerr << "Warning: Mesh disk cache unavailable; continuing without it." << std::endl;
+            }
+        }
+        if (result.count("shared-cache-mb") && result["shared-cache-mb"].as<int>() > 0) {
+            if (!renderer.enableSharedAssetCache(result["shared-cache-name"].as<std::string>(),
+                static_cast<size_t>(result["shared-cache-mb"].as<int>()))) {
+                std::cerr << "Warning: Shared asset cache unavailable; continuing without it." << std::endl;
+            }
+        }
 
         // Always override camera if specified on command line
         if (result.count("camX") || result.count("camY") || result.count("camZ") || result.count("pitch") || result.count("yaw")) {
@@ -133,8 +161,21 @@ int main(int argc, char** argv) {
             renderer.setLightingProfile(result["lighting"].as<std::string>());
         }
 
+        if (result.count("stats")) {
+            renderer.setMeasureReleasedNifMemory(true);
+        }
         renderer.init(isHeadless);
 
+        if (result.count("warm-scan")) {
+            renderer.setWarmScanCount(result["warm-scan"].as<int>());
+        }
+        if (result.count("warm-list")) {
+            if (result.count("file")) {
+                renderer.addNifDataFolder(result["file"].as<std::string>());
+            }
+            renderer.warmTexturesFromList(result["warm-list"].as<std::string>());
+        }
+
         if (isHeadless) {
             if (!result.count("file") || !result.count("output")) {
                 std::cerr << "Error: In headless mode, --file and --output are required." << std::endl;
@@ -258,6 +299,10 @@ int main(int argc, char** argv) {
             renderer.saveToPNG(outputPath); // Save the contents of the back buffer.
 
             std::cout << "Image saved to " << outputPath << std::endl;
+
+            if (result.count("stats")) {
+                renderer.writeMemoryReport(result["stats"].as<std::string>());
+            }
         }
         else {
             renderer.run();
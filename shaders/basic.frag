@@ -23,41 +23,67 @@ struct Light {
     float intensity; };
 
 // --- TEXTURE SAMPLERS ---
-uniform sampler2D texture_diffuse1;
-uniform sampler2D texture_normal;
-uniform sampler2D texture_skin;
-uniform sampler2D texture_detail;
-uniform sampler2D texture_specular;
-uniform sampler2D texture_face_tint;
-uniform sampler2D texture_envmap_2d; // For 2D spherical maps
+// 2D textures live in texture arrays shared between shapes; the layer of each one comes from
+// the material block below.
+uniform sampler2DArray texture_diffuse1;
+uniform sampler2DArray texture_normal;
+uniform sampler2DArray texture_skin;
+uniform sampler2DArray texture_detail;
+uniform sampler2DArray texture_specular;
+uniform sampler2DArray texture_face_tint;
+uniform sampler2DArray texture_envmap_2d; // For 2D spherical maps
 uniform samplerCube texture_envmap_cube; // For cubemaps
-uniform sampler2D texture_envmask;
+uniform sampler2DArray texture_envmask;
 uniform sampler2D shadowMap;
 
-// --- MATERIAL FLAGS (from NIF file) ---
-uniform bool has_normal_map;
-uniform bool has_skin_map;
-uniform bool has_detail_map;
-uniform bool has_specular;
-uniform bool has_specular_map;
-uniform bool has_face_tint_map;
-uniform bool has_greyscale_to_palette;
-uniform bool has_environment_map;
-uniform bool has_eye_environment_map;
-uniform bool is_envmap_cube;
-uniform bool has_env_mask; // Environment map mask
-uniform bool has_tint_color;
-uniform bool has_emissive;
-uniform bool is_model_space; // For _msn.dds normal maps
-
-// --- NEW: Special lighting flags ---
-uniform bool has_hair_soft_lighting;
-uniform bool has_soft_lighting;
-
-// --- NEW: Compatibility Uniforms ---
+// --- MATERIAL (one range of the material buffer per shape) ---
+// Layout must match MaterialBlock in NifModel.cpp.
+layout(std140) uniform Material {
+    vec3 tint_color;
+    float greyscaleToPaletteScale;
+    vec3 emissiveColor;
+    float emissiveMultiple;
+    float materialGlossiness;
+    float materialSpecularStrength;
+    float rimlightPower;
+    float subsurfaceRolloff;
+    float envMapScale;
+    float eyeCubemapScale; // Separate scale for eyes
+    float alpha_threshold;
+
+    // Texture array layers
+    int layer_diffuse;
+    int layer_normal;
+    int layer_skin;
+    int layer_detail;
+    int layer_specular;
+    int layer_face_tint;
+    int layer_envmap;
+    int layer_envmask;
+
+    // Material flags (from NIF file)
+    bool is_eye;
+    bool is_model_space; // For _msn.dds normal maps
+    bool has_greyscale_to_palette;
+    bool has_tint_color;
+    bool has_emissive;
+    bool has_hair_soft_lighting;
+    bool has_soft_lighting;
+    bool has_vertex_colors;
+    bool has_normal_map;
+    bool has_skin_map;
+    bool has_detail_map;
+    bool has_specular;
+    bool has_specular_map;
+    bool has_face_tint_map;
+    bool has_environment_map;
+    bool has_eye_environment_map;
+    bool is_envmap_cube;
+    bool has_env_mask; // Environment map mask
+};
+
+// --- Compatibility Uniforms ---
 uniform bool u_suppressSpecularOnVertexColor;
-uniform bool has_vertex_colors;
-
 
 // --- RENDERER TOGGLES (from UI) ---
 uniform bool use_alpha_test;
@@ -70,23 +96,7 @@ uniform bool u_useFaceTintMap;
 uniform bool u_useEnvironmentMap;
 uniform bool u_useEmissive;
 
-// --- MATERIAL PROPERTIES ---
-uniform float alpha_threshold;
-uniform float envMapScale;
-uniform float eyeCubemapScale; // NEW: Separate scale for eyes
-uniform float greyscaleToPaletteScale;
-uniform vec3 tint_color;
-uniform vec3 emissiveColor;
-uniform float emissiveMultiple;
-uniform float materialGlossiness;
-uniform float materialSpecularStrength;
-
-// --- NEW: Advanced Lighting Uniforms ---
-uniform float rimlightPower;
-uniform float subsurfaceRolloff;
-
 // --- EYE SHADER PROPERTIES ---
-uniform bool is_eye;
 uniform float eye_fresnel_strength;
 uniform float eye_spec_power;
 
@@ -125,7 +135,7 @@ void main()
     // --- 1. BASE COLOR & ALPHA TEST ---
     vec4 baseColor = vec4(1.0);
 if (u_useDiffuseMap) {
-        baseColor = texture(texture_diffuse1, TexCoords); }
+        baseColor = texture(texture_diffuse1, vec3(TexCoords, layer_diffuse)); }
     baseColor.rgb *= vertexColor.rgb;
     baseColor.a *= vertexColor.a;
 if (use_alpha_test && baseColor.a < alpha_threshold) {
@@ -143,7 +153,7 @@ if (use_alpha_test && baseColor.a < alpha_threshold) {
     }
 
     if (has_face_tint_map && u_useFaceTintMap) {
-        vec4 tintSample = texture(texture_face_tint, TexCoords);
+        vec4 tintSample = texture(texture_face_tint, vec3(TexCoords, layer_face_tint));
         // Mix the base color with the tint color based on the tint mask's alpha channel.
 baseColor.rgb = mix(baseColor.rgb, tintSample.rgb, tintSample.a);
     }
@@ -153,7 +163,7 @@ baseColor.rgb = mix(baseColor.rgb, tintSample.rgb, tintSample.a);
     vec3 normal_viewSpace;
 if (has_normal_map && u_useNormalMap) {
         // Sample the normal from the texture. It's stored in Tangent Space.
-vec3 normal_tangentSpace = texture(texture_normal, TexCoords).rgb;
+vec3 normal_tangentSpace = texture(texture_normal, vec3(TexCoords, layer_normal)).rgb;
         
         // For Skyrim's DirectX-style normal maps, the green channel must be inverted for OpenGL.
 normal_tangentSpace.g = 1.0 - normal_tangentSpace.g;
@@ -211,7 +221,7 @@ if (is_eye) {
                 float specularStrength = 1.0;
                 if (has_specular_map) {
                     // The specular map's red channel acts as a per-pixel mask or intensity scalar.
-                    specularStrength = texture(texture_specular, TexCoords).r;
+                    specularStrength = texture(texture_specular, vec3(TexCoords, layer_specular)).r;
                 }
             
                 // In View Space, the view direction is simply the vector from the fragment position to the origin.
@@ -250,7 +260,7 @@ if (is_eye) {
                 // penetrating a surface (like skin), scattering internally, and exiting, which creates
                 // a characteristic soft, "glowing" look.
                 
-                float sss_mask = texture(texture_skin, TexCoords).r;
+                float sss_mask = texture(texture_skin, vec3(TexCoords, layer_skin)).r;
                 vec3 sss_color = vec3(1.0, 0.3, 0.2); 
                 float wrap = (dot(normal_viewSpace, lightDir_viewSpace) * 0.5 + 0.5);
 
@@ -268,12 +278,12 @@ if (is_eye) {
     // --- 4. POST-LIGHTING EFFECTS ---
     vec3 subsurfaceColor = vec3(0.0);
 if (has_skin_map && u_useSkinMap) {
-        subsurfaceColor = texture(texture_skin, TexCoords).r * vec3(1.0, 0.3, 0.2); // Reddish tint
+        subsurfaceColor = texture(texture_skin, vec3(TexCoords, layer_skin)).r * vec3(1.0, 0.3, 0.2); // Reddish tint
 finalColor += subsurfaceColor * baseColor.rgb;
     }
     
     if (has_detail_map && u_useDetailMap) {
-        vec3 detailColor = texture(texture_detail, TexCoords).rgb;
+        vec3 detailColor = texture(texture_detail, vec3(TexCoords, layer_detail)).rgb;
         // Mix the detail map over the existing color.
 finalColor = mix(finalColor, detailColor, 0.3);
     }
@@ -304,7 +314,7 @@ finalColor = mix(finalColor, detailColor, 0.3);
             } else { 
                 // For 2D spherical maps, calculate 2D texture coordinates from the reflection vector.
                 vec2 envCoords = normalize(reflectDir_viewSpace.xy) * 0.5 + 0.5; 
-                envColor = texture(texture_envmap_2d, envCoords).rgb; 
+                envColor = texture(texture_envmap_2d, vec3(envCoords, layer_envmap)).rgb; 
             }
 
             // --- NEW/CORRECTED LOGIC: Environment Reflection Strength ---
@@ -316,14 +326,14 @@ finalColor = mix(finalColor, detailColor, 0.3);
             if (has_env_mask) {
                 // If a mask texture is present, its red channel determines the reflection intensity.
                 // This gives artists the most direct control over reflections.
-                reflectionStrength = texture(texture_envmask, TexCoords).r;
+                reflectionStrength = texture(texture_envmask, vec3(TexCoords, layer_envmask)).r;
             } 
             // 2. Fallback Check: The specular map from slot 7.
             else if (has_specular_map) {
                 // If no dedicated mask exists, fall back to using the specular map's red channel.
                 // This is a very common pattern in Skyrim/Fallout materials where one texture
                 // controls both specular highlights and environmental reflections.
-                reflectionStrength = texture(texture_specular, TexCoords).r;
+                reflectionStrength = texture(texture_specular, vec3(TexCoords, layer_specular)).r;
             }
             
             // Add the final reflection to the color, scaling it by the determined mask value 
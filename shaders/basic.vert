@@ -3,13 +3,15 @@
 // === INPUTS (Per-Vertex Data) ===
 // All input attributes are in the mesh's local Model Space.
 layout (location = 0) in vec3 aPos_modelSpace;
+// Normals and tangents arrive as snorm 10_10_10_2, UVs as halves, colours and weights as
+// unorm; the GL converts them all to floats. See PackedVertexLayout in NifModel.cpp.
 layout (location = 1) in vec3 aNormal_modelSpace;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec4 aColor;
-layout (location = 4) in ivec4 aBoneIDs;
+layout (location = 3) in vec4 aColor; // Constant white for shapes without vertex colours.
+layout (location = 4) in uvec4 aBoneIDs;
 layout (location = 5) in vec4 aWeights;
-layout (location = 6) in vec3 aTangent_modelSpace;
-layout (location = 7) in vec3 aBitangent_modelSpace;
+// xyz is the tangent; w is +1 or -1, the handedness of the bitangent.
+layout (location = 6) in vec4 aTangent_modelSpace;
 
 // === OUTPUTS (Varyings to Fragment Shader) ===
 // The fragment's position in camera View Space (Y-up).
@@ -83,8 +85,10 @@ void main()
     mat3 normalMatrix_modelToView_yUp = mat3(u_view_worldToView) * normalMatrix_modelToWorld_yUp;
     v_modelToViewNormalMatrix = normalMatrix_modelToView_yUp;
     
-    vec3 T_viewSpace = normalize(normalMatrix_modelToView_yUp * aTangent_modelSpace);
-    vec3 B_viewSpace = normalize(normalMatrix_modelToView_yUp * aBitangent_modelSpace);
+    // The bitangent is not stored; rebuild it from the normal, tangent and handedness.
+    vec3 bitangent_modelSpace = cross(aNormal_modelSpace, aTangent_modelSpace.xyz) * aTangent_modelSpace.w;
+    vec3 T_viewSpace = normalize(normalMatrix_modelToView_yUp * aTangent_modelSpace.xyz);
+    vec3 B_viewSpace = normalize(normalMatrix_modelToView_yUp * bitangent_modelSpace);
     vec3 N_viewSpace = normalize(normalMatrix_modelToView_yUp * aNormal_modelSpace);
     v_tangentToViewMatrix = mat3(T_viewSpace, B_viewSpace, N_viewSpace);
 
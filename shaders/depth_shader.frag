@@ -6,7 +6,8 @@
 in vec2 v_TexCoords;
 
 // === UNIFORMS ===
-uniform sampler2D texture_diffuse1;
+uniform sampler2DArray texture_diffuse1;
+uniform int layer_diffuse;
 uniform float alpha_threshold;
 uniform bool use_alpha_test;
 
@@ -18,7 +19,7 @@ void main()
 
     if (use_alpha_test) {
         // Sample the diffuse texture to get the alpha value.
-        vec4 albedo = texture(texture_diffuse1, v_TexCoords);
+        vec4 albedo = texture(texture_diffuse1, vec3(v_TexCoords, layer_diffuse));
 
         // If the alpha is below the threshold, discard the fragment entirely.
         // It will not be written to the depth buffer.
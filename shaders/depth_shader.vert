@@ -6,7 +6,7 @@
 // Vertex attributes are in the mesh's local Model Space, which uses a Z-up axis convention.
 layout (location = 0) in vec3 aPos_modelSpace_zUp;
 layout (location = 2) in vec2 aTexCoords; // ADDED: Texture coordinates
-layout (location = 4) in ivec4 aBoneIDs;
+layout (location = 4) in uvec4 aBoneIDs;
 layout (location = 5) in vec4 aWeights;
 
 // === OUTPUTS (Varyings) ===